@@ -89,6 +89,82 @@ void test_foxcog()
     printf("\n\n");
 }
 
+void test_chunked()
+{
+    struct md4 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of md4_update.
+    memset(buffer, 'a', sizeof(buffer));
+    md4_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        md4_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    md4_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: bbce80cc6bb65e5c6745e30d4eeca9a4\nResult:   ");
+
+    for (int i = 0; i < 16; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_chunked_padding()
+{
+    struct md4 m;
+    char buffer[256];
+    size_t lengths[4] = { 247, 248, 255, 256 };
+    size_t sizes[3] = { 1, 63, 65 };
+    const char* expected[4] = {
+        "a92a1d43452bc8f7f044b21fccc021ab",
+        "2a4d8f20faa07098246fa29a286b443f",
+        "fed1c7a700c826ab15182a34469948c0",
+        "86265cb4b38a4d619a24eba7964be91d"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 55, 56, 63 and 64
+    // bytes: from 56 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        md4_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            md4_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        md4_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 16; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+
 time_t benchmark_driver(int size)
 {
     struct md4 m;
@@ -146,5 +222,7 @@ int main()
     test_abc();
     test_foxdog();
     test_foxcog();
+    test_chunked();
+    test_chunked_padding();
     benchmark();
 }
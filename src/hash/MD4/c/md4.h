@@ -108,10 +108,10 @@ extern inline uint32_t md4_rotl32(uint32_t data, uint32_t count)
 }
 
 /*
- * md4 md4_core
+ * md4 md4_core_blocks
  *
- * Core of md4 hash function; operates on a single round from m->partial
- * and updates hash state in m->s.
+ * Core of md4 hash function; operates on nblocks consecutive 64-byte blocks
+ * at data and updates the hash state in state.
  *
  * Do the following:
  *
@@ -212,86 +212,101 @@ extern inline uint32_t md4_rotl32(uint32_t data, uint32_t count)
  *      the value it had before this block was started.)
  * end * end of loop on i *
 */
-extern inline void md4_core(struct md4* m)
+extern inline void md4_core_blocks(uint32_t* state, const uint8_t* data,
+                                   size_t nblocks)
 {
     size_t i = 0;
     uint32_t x[16];
     uint32_t s[4];
+    size_t block = 0;
+
+    for (block = 0; block < nblocks; block++) {
+        // Message has to be processed as a little endian integer
+        for (i = 0; i < 16; i++) {
+            x[i] = ((uint32_t) data[i * 4 + 3] << 24) |
+                   ((uint32_t) data[i * 4 + 2] << 16) |
+                   ((uint32_t) data[i * 4 + 1] << 8) |
+                   ((uint32_t) data[i * 4 + 0] << 0);
+        }
 
-    // Message has to be processed as a little endian integer
-    for (i = 0; i < 16; i++) {
-        x[i] = (((
-                     uint32_t) m->partial[i * 4 + 3]) << 24) | (((
-                                 uint32_t) m->partial[i * 4 + 2]) << 16) | (((
-                                             uint32_t) m->partial[i * 4 + 1]) << 8) | (((
-                                                     uint32_t) m->partial[i * 4 + 0]) << 0);
+        // Duplicate state into temporary variables
+        s[0] = state[0];
+        s[1] = state[1];
+        s[2] = state[2];
+        s[3] = state[3];
+
+        // Round 1
+        s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[ 0],  3);
+        s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[ 1],  7);
+        s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[ 2], 11);
+        s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[ 3], 19);
+        s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[ 4],  3);
+        s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[ 5],  7);
+        s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[ 6], 11);
+        s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[ 7], 19);
+        s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[ 8],  3);
+        s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[ 9],  7);
+        s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[10], 11);
+        s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[11], 19);
+        s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[12],  3);
+        s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[13],  7);
+        s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[14], 11);
+        s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[15], 19);
+
+        // Round 2
+        s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 0] + 0x5A827999,  3);
+        s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 4] + 0x5A827999,  5);
+        s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[ 8] + 0x5A827999,  9);
+        s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[12] + 0x5A827999, 13);
+        s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 1] + 0x5A827999,  3);
+        s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 5] + 0x5A827999,  5);
+        s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[ 9] + 0x5A827999,  9);
+        s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[13] + 0x5A827999, 13);
+        s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 2] + 0x5A827999,  3);
+        s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 6] + 0x5A827999,  5);
+        s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[10] + 0x5A827999,  9);
+        s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[14] + 0x5A827999, 13);
+        s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 3] + 0x5A827999,  3);
+        s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 7] + 0x5A827999,  5);
+        s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[11] + 0x5A827999,  9);
+        s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[15] + 0x5A827999, 13);
+
+        // Round 3
+        s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 0] + 0x6ED9EBA1,  3);
+        s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[ 8] + 0x6ED9EBA1,  9);
+        s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 4] + 0x6ED9EBA1, 11);
+        s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[12] + 0x6ED9EBA1, 15);
+        s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 2] + 0x6ED9EBA1,  3);
+        s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[10] + 0x6ED9EBA1,  9);
+        s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 6] + 0x6ED9EBA1, 11);
+        s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[14] + 0x6ED9EBA1, 15);
+        s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 1] + 0x6ED9EBA1,  3);
+        s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[ 9] + 0x6ED9EBA1,  9);
+        s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 5] + 0x6ED9EBA1, 11);
+        s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[13] + 0x6ED9EBA1, 15);
+        s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 3] + 0x6ED9EBA1,  3);
+        s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[11] + 0x6ED9EBA1,  9);
+        s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 7] + 0x6ED9EBA1, 11);
+        s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[15] + 0x6ED9EBA1, 15);
+
+        // Add temporary variables back into state.
+        state[0] += s[0];
+        state[1] += s[1];
+        state[2] += s[2];
+        state[3] += s[3];
+
+        data += 64;
     }
+}
 
-    // Duplicate state into temporary variables
-    s[0] = m->s[0];
-    s[1] = m->s[1];
-    s[2] = m->s[2];
-    s[3] = m->s[3];
-
-    // Round 1
-    s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[ 0],  3);
-    s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[ 1],  7);
-    s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[ 2], 11);
-    s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[ 3], 19);
-    s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[ 4],  3);
-    s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[ 5],  7);
-    s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[ 6], 11);
-    s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[ 7], 19);
-    s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[ 8],  3);
-    s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[ 9],  7);
-    s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[10], 11);
-    s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[11], 19);
-    s[0] = md4_rotl32(s[0] + md4_f(s[1], s[2], s[3]) + x[12],  3);
-    s[3] = md4_rotl32(s[3] + md4_f(s[0], s[1], s[2]) + x[13],  7);
-    s[2] = md4_rotl32(s[2] + md4_f(s[3], s[0], s[1]) + x[14], 11);
-    s[1] = md4_rotl32(s[1] + md4_f(s[2], s[3], s[0]) + x[15], 19);
-
-    // Round 2
-    s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 0] + 0x5A827999,  3);
-    s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 4] + 0x5A827999,  5);
-    s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[ 8] + 0x5A827999,  9);
-    s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[12] + 0x5A827999, 13);
-    s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 1] + 0x5A827999,  3);
-    s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 5] + 0x5A827999,  5);
-    s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[ 9] + 0x5A827999,  9);
-    s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[13] + 0x5A827999, 13);
-    s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 2] + 0x5A827999,  3);
-    s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 6] + 0x5A827999,  5);
-    s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[10] + 0x5A827999,  9);
-    s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[14] + 0x5A827999, 13);
-    s[0] = md4_rotl32(s[0] + md4_g(s[1], s[2], s[3]) + x[ 3] + 0x5A827999,  3);
-    s[3] = md4_rotl32(s[3] + md4_g(s[0], s[1], s[2]) + x[ 7] + 0x5A827999,  5);
-    s[2] = md4_rotl32(s[2] + md4_g(s[3], s[0], s[1]) + x[11] + 0x5A827999,  9);
-    s[1] = md4_rotl32(s[1] + md4_g(s[2], s[3], s[0]) + x[15] + 0x5A827999, 13);
-
-    // Round 3
-    s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 0] + 0x6ED9EBA1,  3);
-    s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[ 8] + 0x6ED9EBA1,  9);
-    s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 4] + 0x6ED9EBA1, 11);
-    s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[12] + 0x6ED9EBA1, 15);
-    s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 2] + 0x6ED9EBA1,  3);
-    s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[10] + 0x6ED9EBA1,  9);
-    s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 6] + 0x6ED9EBA1, 11);
-    s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[14] + 0x6ED9EBA1, 15);
-    s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 1] + 0x6ED9EBA1,  3);
-    s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[ 9] + 0x6ED9EBA1,  9);
-    s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 5] + 0x6ED9EBA1, 11);
-    s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[13] + 0x6ED9EBA1, 15);
-    s[0] = md4_rotl32(s[0] + md4_h(s[1], s[2], s[3]) + x[ 3] + 0x6ED9EBA1,  3);
-    s[3] = md4_rotl32(s[3] + md4_h(s[0], s[1], s[2]) + x[11] + 0x6ED9EBA1,  9);
-    s[2] = md4_rotl32(s[2] + md4_h(s[3], s[0], s[1]) + x[ 7] + 0x6ED9EBA1, 11);
-    s[1] = md4_rotl32(s[1] + md4_h(s[2], s[3], s[0]) + x[15] + 0x6ED9EBA1, 15);
-
-    // Add temporary variables back into state.
-    m->s[0] += s[0];
-    m->s[1] += s[1];
-    m->s[2] += s[2];
-    m->s[3] += s[3];
+/*
+ * md4 md4_core
+ *
+ * Runs md4_core_blocks on the buffered block in m->partial.
+*/
+extern inline void md4_core(struct md4* m)
+{
+    md4_core_blocks(m->s, m->partial, 1);
 }
 
 /*
@@ -336,21 +351,41 @@ extern inline void md4_init(struct md4* m)
 */
 extern inline void md4_update(struct md4* m, char* msg, uint64_t len)
 {
-    size_t i = 0;
+    const uint8_t* data = (const uint8_t*) msg;
+    size_t fill = 0;
+    size_t nblocks = 0;
 
     m->len += len;
-    for (i = 0; i < len; i++) {
-        if (m->p_len == 64) {
-            m->p_len = 0;
 
-            // Once we finish a buffer, call the core md4 function to update
-            // state and recompute the current hash value.
+    // Complete a partially filled block first.
+    if (m->p_len > 0) {
+        fill = 64 - m->p_len;
+        if (fill > len) {
+            fill = (size_t) len;
+        }
+
+        memcpy(m->partial + m->p_len, data, fill);
+        m->p_len += fill;
+        data += fill;
+        len -= fill;
+
+        if (m->p_len == 64) {
             md4_core(m);
+            m->p_len = 0;
         }
+    }
 
-        m->partial[m->p_len] = (uint8_t)((unsigned char) msg[i]);
-        m->p_len += 1;
+    // Whole blocks are hashed directly from the caller's buffer.
+    nblocks = len / 64;
+    if (nblocks > 0) {
+        md4_core_blocks(m->s, data, nblocks);
+        data += nblocks * 64;
+        len -= nblocks * 64;
     }
+
+    // Buffer the tail for the next update or finalize.
+    memcpy(m->partial + m->p_len, data, (size_t) len);
+    m->p_len += (size_t) len;
 }
 
 /*
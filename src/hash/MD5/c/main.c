@@ -5,6 +5,7 @@
 **/
 
 #include "md5.h"
+#include "md5_mb.h"
 #include "stdio.h"
 #include "strings.h"
 #include "time.h"
@@ -57,6 +58,161 @@ void test_foxdogperiod()
     printf("\n\n");
 }
 
+void test_chunked()
+{
+    struct md5 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of md5_update.
+    memset(buffer, 'a', sizeof(buffer));
+    md5_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        md5_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    md5_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: 7707d6ae4e027c70eea2a935c2296f21\nResult:   ");
+
+    for (int i = 0; i < 16; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_chunked_padding()
+{
+    struct md5 m;
+    char buffer[256];
+    size_t lengths[4] = { 247, 248, 255, 256 };
+    size_t sizes[3] = { 1, 63, 65 };
+    const char* expected[4] = {
+        "93f4621c0b88499297ec3f8fbb3fb9c4",
+        "6af3d61e2e3ef8e189cffbea802c7e69",
+        "46bc249a5a8fc5d622cf12c42c463ae0",
+        "81109eec5aa1a284fb5327b10e9c16b9"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 55, 56, 63 and 64
+    // bytes: from 56 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        md5_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            md5_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        md5_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 16; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+
+void test_md5_mb()
+{
+    static uint8_t data[4096 + 37];
+    const size_t sizes[37] = { 43, 0, 1, 55, 56, 57, 63, 64, 65, 119, 120,
+                               127, 128, 129, 200, 1000, 1001, 4000, 4096,
+                               3, 17, 31, 47, 100, 150, 191, 192, 193, 255,
+                               256, 257, 300, 511, 512, 513, 777, 2048
+                             };
+    const uint8_t* msg[37];
+    size_t len[37];
+    uint8_t digests[37 * 16];
+    struct md5 m;
+    size_t widths[4] = { 1, 4, 8, 16 };
+    size_t matches = 0;
+
+    printf("Multi-buffer lanes supported: %zu\n", md5_mb_width());
+
+    for (int i = 0; i < 4096 + 37; i++) {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    msg[0] = (const uint8_t*) "The quick brown fox jumps over the lazy dog";
+    len[0] = sizes[0];
+    for (int i = 1; i < 37; i++) {
+        msg[i] = data + i;
+        len[i] = sizes[i];
+    }
+
+    md5_mb_batch(msg, len, digests, 37);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog\nExpected: 9e107d9d372bb6826bd81d3542a419d6\nResult:   ");
+
+    for (int i = 0; i < 16; i ++) {
+        printf("%02x", digests[i]);
+    }
+
+    printf("\n");
+
+    for (int w = 0; w < 4 && widths[w] <= md5_mb_width(); w++) {
+        memset(digests, 0, sizeof(digests));
+        md5_mb_batch_width(msg, len, digests, 37, widths[w]);
+
+        matches = 0;
+        for (int i = 0; i < 37; i++) {
+            md5_init(&m);
+            md5_update(&m, (char*) msg[i], len[i]);
+            md5_finalize(&m);
+            matches += memcmp(m.digest, digests + 16 * i, 16) == 0;
+        }
+
+        printf("%2zu lanes Actual:   %zu digests match\n", widths[w],
+               matches);
+        printf("%2zu lanes Expected: 37 digests match\n", widths[w]);
+    }
+
+    printf("\n");
+}
+
+void benchmark_md5_mb()
+{
+    static uint8_t data[4096 * 1024];
+    static uint8_t digests[4096 * 16];
+    const uint8_t* msg[4096];
+    size_t len[4096];
+    size_t widths[4] = { 1, 4, 8, 16 };
+    clock_t start;
+
+    for (int i = 0; i < 4096; i++) {
+        msg[i] = data + 1024 * i;
+        len[i] = 1024;
+    }
+
+    for (int w = 0; w < 4 && widths[w] <= md5_mb_width(); w++) {
+        start = clock();
+        md5_mb_batch_width(msg, len, digests, 4096, widths[w]);
+        printf("Benchmark: 4096 x 1KB md5_mb_batch_width(%zu): %f seconds\n",
+               widths[w], (double) (clock() - start) / CLOCKS_PER_SEC);
+    }
+}
 
 time_t benchmark_driver(int size)
 {
@@ -108,10 +264,52 @@ void benchmark()
            benchmark_driver(8 * 1024 * 1024));
 }
 
+void test_export()
+{
+    char msg[] = "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog";
+    uint8_t state[MD5_STATE_SIZE];
+    struct md5 m;
+    struct md5 resumed;
+    const struct md5* frozen = &m;
+
+    // Checkpoint mid-message through a const pointer and resume in a
+    // separate struct.
+    md5_init(&m);
+    md5_update(&m, msg, 86);
+    md5_export(frozen, state);
+
+    memset(&resumed, 0xff, sizeof(resumed));
+    printf("Message:  import of md5_export\nExpected: 1\nResult:   %d\n\n",
+           md5_import(&resumed, state, sizeof(state)));
+
+    md5_update(&resumed, msg + 86, 43);
+    md5_finalize(&resumed);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog (x3), resumed\nExpected: 4e67db4a7a406b0cfdadd887cde7888e\nResult:   ");
+
+    for (int i = 0; i < 16; i ++) {
+        printf("%02x", resumed.digest[i]);
+    }
+
+    printf("\n\n");
+
+    // A state from another version is rejected.
+    state[2]++;
+    printf("Message:  import of another version\nExpected: 0\nResult:   %d\n\n",
+           md5_import(&resumed, state, sizeof(state)));
+}
+
 int main()
 {
     test_null();
     test_foxdog();
     test_foxdogperiod();
+    test_chunked();
+    test_chunked_padding();
+    test_export();
+    test_md5_mb();
+    benchmark_md5_mb();
     benchmark();
 }
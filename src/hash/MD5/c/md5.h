@@ -28,6 +28,10 @@
 #include "stdint.h"
 #include "string.h"
 
+#define MD5_STATE_VERSION 1
+#define MD5_STATE_ID 1
+#define MD5_STATE_SIZE 93
+
 /*
  * struct md5
  *
@@ -130,10 +134,10 @@ extern inline uint32_t md5_rotl32(uint32_t data, uint32_t count)
 }
 
 /*
- * md5 md5_core
+ * md5 md5_core_blocks
  *
- * Core of md5 hash function; operates on a single round from m->partial
- * and updates hash state in m->s.
+ * Core of md5 hash function; operates on nblocks consecutive 64-byte blocks
+ * at data and updates the hash state in state.
  *
  *    Do the following:
  *
@@ -197,168 +201,183 @@ extern inline uint32_t md5_rotl32(uint32_t data, uint32_t count)
  *
  *    end # of loop on i
 */
-extern inline void md5_core(struct md5* m)
+extern inline void md5_core_blocks(uint32_t* state, const uint8_t* data,
+                                   size_t nblocks)
 {
     size_t i = 0;
     uint32_t x[16];
     uint32_t s[4];
+    size_t block = 0;
+
+    for (block = 0; block < nblocks; block++) {
+        // Message has to be processed as a little endian integer
+        for (i = 0; i < 16; i++) {
+            x[i] = ((uint32_t) data[i * 4 + 3] << 24) |
+                   ((uint32_t) data[i * 4 + 2] << 16) |
+                   ((uint32_t) data[i * 4 + 1] << 8) |
+                   ((uint32_t) data[i * 4 + 0] << 0);
+        }
 
-    // Message has to be processed as a little endian integer
-    for (i = 0; i < 16; i++) {
-        x[i] = (((
-                     uint32_t) m->partial[i * 4 + 3]) << 24) | (((
-                                 uint32_t) m->partial[i * 4 + 2]) << 16) | (((
-                                             uint32_t) m->partial[i * 4 + 1]) << 8) | (((
-                                                     uint32_t) m->partial[i * 4 + 0]) << 0);
+        // Duplicate state into temporary variables
+        s[0] = state[0];
+        s[1] = state[1];
+        s[2] = state[2];
+        s[3] = state[3];
+
+        // Round 1
+        s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[ 0] + 0xd76aa478,
+                                 7);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[ 1] + 0xe8c7b756,
+                                 12);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[ 2] + 0x242070db,
+                                 17);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[ 3] + 0xc1bdceee,
+                                 22);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[ 4] + 0xf57c0faf,
+                                 7);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[ 5] + 0x4787c62a,
+                                 12);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[ 6] + 0xa8304613,
+                                 17);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[ 7] + 0xfd469501,
+                                 22);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[ 8] + 0x698098d8,
+                                 7);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[ 9] + 0x8b44f7af,
+                                 12);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[10] + 0xffff5bb1,
+                                 17);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[11] + 0x895cd7be,
+                                 22);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[12] + 0x6b901122,
+                                 7);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[13] + 0xfd987193,
+                                 12);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[14] + 0xa679438e,
+                                 17);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[15] + 0x49b40821,
+                                 22);
+
+        // Round 2
+        s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[ 1] + 0xf61e2562,
+                                 5);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[ 6] + 0xc040b340,
+                                 9);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[11] + 0x265e5a51,
+                                 14);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[ 0] + 0xe9b6c7aa,
+                                 20);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[ 5] + 0xd62f105d,
+                                 5);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[10] + 0x02441453,
+                                 9);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[15] + 0xd8a1e681,
+                                 14);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[ 4] + 0xe7d3fbc8,
+                                 20);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[ 9] + 0x21e1cde6,
+                                 5);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[14] + 0xc33707d6,
+                                 9);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[ 3] + 0xf4d50d87,
+                                 14);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[ 8] + 0x455a14ed,
+                                 20);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[13] + 0xa9e3e905,
+                                 5);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[ 2] + 0xfcefa3f8,
+                                 9);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[ 7] + 0x676f02d9,
+                                 14);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[12] + 0x8d2a4c8a,
+                                 20);
+
+        // Round 3
+        s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[ 5] + 0xfffa3942,
+                                 4);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[ 8] + 0x8771f681,
+                                 11);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[11] + 0x6d9d6122,
+                                 16);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[14] + 0xfde5380c,
+                                 23);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[ 1] + 0xa4beea44,
+                                 4);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[ 4] + 0x4bdecfa9,
+                                 11);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[ 7] + 0xf6bb4b60,
+                                 16);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[10] + 0xbebfbc70,
+                                 23);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[13] + 0x289b7ec6,
+                                 4);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[ 0] + 0xeaa127fa,
+                                 11);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[ 3] + 0xd4ef3085,
+                                 16);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[ 6] + 0x04881d05,
+                                 23);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[ 9] + 0xd9d4d039,
+                                 4);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[12] + 0xe6db99e5,
+                                 11);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[15] + 0x1fa27cf8,
+                                 16);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[ 2] + 0xc4ac5665,
+                                 23);
+
+        // Round 4
+        s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[ 0] + 0xf4292244,
+                                 6);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[ 7] + 0x432aff97,
+                                 10);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[14] + 0xab9423a7,
+                                 15);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[ 5] + 0xfc93a039,
+                                 21);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[12] + 0x655b59c3,
+                                 6);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[ 3] + 0x8f0ccc92,
+                                 10);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[10] + 0xffeff47d,
+                                 15);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[ 1] + 0x85845dd1,
+                                 21);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[ 8] + 0x6fa87e4f,
+                                 6);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[15] + 0xfe2ce6e0,
+                                 10);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[ 6] + 0xa3014314,
+                                 15);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[13] + 0x4e0811a1,
+                                 21);
+        s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[ 4] + 0xf7537e82,
+                                 6);
+        s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[11] + 0xbd3af235,
+                                 10);
+        s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[ 2] + 0x2ad7d2bb,
+                                 15);
+        s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[ 9] + 0xeb86d391,
+                                 21);
+
+        // Add temporary variables back into state.
+        state[0] += s[0];
+        state[1] += s[1];
+        state[2] += s[2];
+        state[3] += s[3];
+
+        data += 64;
     }
+}
 
-    // Duplicate state into temporary variables
-    s[0] = m->s[0];
-    s[1] = m->s[1];
-    s[2] = m->s[2];
-    s[3] = m->s[3];
-
-    // Round 1
-    s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[ 0] + 0xd76aa478,
-                             7);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[ 1] + 0xe8c7b756,
-                             12);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[ 2] + 0x242070db,
-                             17);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[ 3] + 0xc1bdceee,
-                             22);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[ 4] + 0xf57c0faf,
-                             7);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[ 5] + 0x4787c62a,
-                             12);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[ 6] + 0xa8304613,
-                             17);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[ 7] + 0xfd469501,
-                             22);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[ 8] + 0x698098d8,
-                             7);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[ 9] + 0x8b44f7af,
-                             12);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[10] + 0xffff5bb1,
-                             17);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[11] + 0x895cd7be,
-                             22);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_f(s[1], s[2], s[3]) + x[12] + 0x6b901122,
-                             7);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_f(s[0], s[1], s[2]) + x[13] + 0xfd987193,
-                             12);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_f(s[3], s[0], s[1]) + x[14] + 0xa679438e,
-                             17);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_f(s[2], s[3], s[0]) + x[15] + 0x49b40821,
-                             22);
-
-    // Round 2
-    s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[ 1] + 0xf61e2562,
-                             5);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[ 6] + 0xc040b340,
-                             9);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[11] + 0x265e5a51,
-                             14);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[ 0] + 0xe9b6c7aa,
-                             20);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[ 5] + 0xd62f105d,
-                             5);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[10] + 0x02441453,
-                             9);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[15] + 0xd8a1e681,
-                             14);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[ 4] + 0xe7d3fbc8,
-                             20);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[ 9] + 0x21e1cde6,
-                             5);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[14] + 0xc33707d6,
-                             9);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[ 3] + 0xf4d50d87,
-                             14);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[ 8] + 0x455a14ed,
-                             20);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_g(s[1], s[2], s[3]) + x[13] + 0xa9e3e905,
-                             5);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_g(s[0], s[1], s[2]) + x[ 2] + 0xfcefa3f8,
-                             9);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_g(s[3], s[0], s[1]) + x[ 7] + 0x676f02d9,
-                             14);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_g(s[2], s[3], s[0]) + x[12] + 0x8d2a4c8a,
-                             20);
-
-    // Round 3
-    s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[ 5] + 0xfffa3942,
-                             4);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[ 8] + 0x8771f681,
-                             11);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[11] + 0x6d9d6122,
-                             16);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[14] + 0xfde5380c,
-                             23);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[ 1] + 0xa4beea44,
-                             4);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[ 4] + 0x4bdecfa9,
-                             11);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[ 7] + 0xf6bb4b60,
-                             16);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[10] + 0xbebfbc70,
-                             23);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[13] + 0x289b7ec6,
-                             4);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[ 0] + 0xeaa127fa,
-                             11);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[ 3] + 0xd4ef3085,
-                             16);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[ 6] + 0x04881d05,
-                             23);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_h(s[1], s[2], s[3]) + x[ 9] + 0xd9d4d039,
-                             4);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_h(s[0], s[1], s[2]) + x[12] + 0xe6db99e5,
-                             11);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_h(s[3], s[0], s[1]) + x[15] + 0x1fa27cf8,
-                             16);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_h(s[2], s[3], s[0]) + x[ 2] + 0xc4ac5665,
-                             23);
-
-    // Round 4
-    s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[ 0] + 0xf4292244,
-                             6);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[ 7] + 0x432aff97,
-                             10);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[14] + 0xab9423a7,
-                             15);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[ 5] + 0xfc93a039,
-                             21);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[12] + 0x655b59c3,
-                             6);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[ 3] + 0x8f0ccc92,
-                             10);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[10] + 0xffeff47d,
-                             15);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[ 1] + 0x85845dd1,
-                             21);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[ 8] + 0x6fa87e4f,
-                             6);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[15] + 0xfe2ce6e0,
-                             10);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[ 6] + 0xa3014314,
-                             15);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[13] + 0x4e0811a1,
-                             21);
-    s[0] = s[1] + md5_rotl32(s[0] + md5_i(s[1], s[2], s[3]) + x[ 4] + 0xf7537e82,
-                             6);
-    s[3] = s[0] + md5_rotl32(s[3] + md5_i(s[0], s[1], s[2]) + x[11] + 0xbd3af235,
-                             10);
-    s[2] = s[3] + md5_rotl32(s[2] + md5_i(s[3], s[0], s[1]) + x[ 2] + 0x2ad7d2bb,
-                             15);
-    s[1] = s[2] + md5_rotl32(s[1] + md5_i(s[2], s[3], s[0]) + x[ 9] + 0xeb86d391,
-                             21);
-
-    // Add temporary variables back into state.
-    m->s[0] += s[0];
-    m->s[1] += s[1];
-    m->s[2] += s[2];
-    m->s[3] += s[3];
+/*
+ * md5 md5_core
+ *
+ * Runs md5_core_blocks on the buffered block in m->partial.
+*/
+extern inline void md5_core(struct md5* m)
+{
+    md5_core_blocks(m->s, m->partial, 1);
 }
 
 /*
@@ -402,21 +421,41 @@ extern inline void md5_init(struct md5* m)
 */
 extern inline void md5_update(struct md5* m, char* msg, uint64_t len)
 {
-    size_t i = 0;
+    const uint8_t* data = (const uint8_t*) msg;
+    size_t fill = 0;
+    size_t nblocks = 0;
 
     m->len += len;
-    for (i = 0; i < len; i++) {
-        if (m->p_len == 64) {
-            m->p_len = 0;
 
-            // Once we finish a buffer, call the core md5 function to update
-            // state and recompute the current hash value.
+    // Complete a partially filled block first.
+    if (m->p_len > 0) {
+        fill = 64 - m->p_len;
+        if (fill > len) {
+            fill = (size_t) len;
+        }
+
+        memcpy(m->partial + m->p_len, data, fill);
+        m->p_len += fill;
+        data += fill;
+        len -= fill;
+
+        if (m->p_len == 64) {
             md5_core(m);
+            m->p_len = 0;
         }
+    }
 
-        m->partial[m->p_len] = (uint8_t)((unsigned char) msg[i]);
-        m->p_len += 1;
+    // Whole blocks are hashed directly from the caller's buffer.
+    nblocks = len / 64;
+    if (nblocks > 0) {
+        md5_core_blocks(m->s, data, nblocks);
+        data += nblocks * 64;
+        len -= nblocks * 64;
     }
+
+    // Buffer the tail for the next update or finalize.
+    memcpy(m->partial + m->p_len, data, (size_t) len);
+    m->p_len += (size_t) len;
 }
 
 
@@ -518,4 +557,105 @@ extern inline uint8_t* md5_sum(struct md5* m, char* msg)
     return m->digest;
 }
 
+/*
+ * md5 md5_store_be
+ *
+ * Writes the low count bytes of value to out, most significant first.
+*/
+extern inline void md5_store_be(uint8_t* out, uint64_t value, size_t count)
+{
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        out[i] = (uint8_t) (value >> (8 * (count - 1 - i)));
+    }
+}
+
+/*
+ * md5 md5_load_be
+ *
+ * Reads count bytes at in as a big endian integer.
+*/
+extern inline uint64_t md5_load_be(const uint8_t* in, size_t count)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+/*
+ * md5 md5_export
+ *
+ * Serializes the in-progress state of m into the MD5_STATE_SIZE bytes at
+ * out, so that hashing can resume later with md5_import, in this process
+ * or another one. The layout is stable for a given MD5_STATE_VERSION, and
+ * all integers are big endian:
+ *
+ *     4 bytes   -- "cc", MD5_STATE_VERSION, MD5_STATE_ID
+ *     16 bytes  -- s[0] through s[3]
+ *     8 bytes   -- len
+ *     1 byte    -- p_len
+ *     64 bytes  -- partial; bytes past p_len are zero
+*/
+extern inline void md5_export(const struct md5* m, uint8_t* out)
+{
+    size_t i = 0;
+
+    memset(out, 0, MD5_STATE_SIZE);
+    out[0] = 'c';
+    out[1] = 'c';
+    out[2] = MD5_STATE_VERSION;
+    out[3] = MD5_STATE_ID;
+
+    for (i = 0; i < 4; i++) {
+        md5_store_be(out + 4 + 4 * i, m->s[i], 4);
+    }
+
+    md5_store_be(out + 20, m->len, 8);
+    out[28] = (uint8_t) m->p_len;
+    memcpy(out + 29, m->partial, m->p_len);
+}
+
+/*
+ * md5 md5_import
+ *
+ * Restores a state written by md5_export into m; md5_update and
+ * md5_finalize then continue as if hashing had never stopped. Returns 1 on
+ * success. Returns 0 and leaves m untouched if the len bytes at in are not
+ * a md5 state of this version.
+*/
+extern inline int md5_import(struct md5* m, const uint8_t* in, size_t len)
+{
+    size_t i = 0;
+    size_t p_len = 0;
+
+    if (len != MD5_STATE_SIZE || in[0] != 'c' || in[1] != 'c' ||
+            in[2] != MD5_STATE_VERSION || in[3] != MD5_STATE_ID) {
+        return 0;
+    }
+
+    // The partial block always holds the input past the last whole block.
+    p_len = in[28];
+    if (p_len != (size_t) (md5_load_be(in + 20, 8) % 64)) {
+        return 0;
+    }
+
+    memset(m->digest, 0, sizeof(m->digest));
+    for (i = 0; i < 4; i++) {
+        m->s[i] = (uint32_t) md5_load_be(in + 4 + 4 * i, 4);
+    }
+
+    m->len = md5_load_be(in + 20, 8);
+    m->p_len = p_len;
+    memset(m->partial, 0, sizeof(m->partial));
+    memcpy(m->partial, in + 29, p_len);
+
+    return 1;
+}
+
 #endif // CC_MD5_H
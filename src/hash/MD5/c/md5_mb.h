@@ -0,0 +1,672 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Multi-buffer implementation of the md5 hash algorithm, hashing 4 (SSE2),
+ * 8 (AVX2) or 16 (AVX-512) independent messages at once.
+ *
+ * Every md5 step depends on the one before it, so a single message cannot
+ * use more than one lane. Here each 128, 256 or 512-bit register holds one
+ * state word (or message word) of that many messages instead, and one pass
+ * of the 64 steps advances all of them by a block. Messages of different
+ * lengths share a pass until the shorter ones run out of blocks: a lane
+ * with nothing left to hash is masked and keeps its state. Once fewer than
+ * half the lanes are still busy, the rest of each message is finished with
+ * the scalar md5_core_blocks instead.
+ *
+ * Usage:
+ *
+ *     const uint8_t* msg[3] = { a, b, c };
+ *     size_t len[3] = { a_len, b_len, c_len };
+ *     uint8_t digests[3 * 16];
+ *     md5_mb_batch(msg, len, digests, 3);
+ *     // digests + 16 * i holds the md5 digest of msg[i]
+ *
+ * md5_mb_batch picks the widest kernel the host supports and can be called
+ * on any host; without SIMD support every message goes through
+ * md5_core_blocks. CC_MD5_MB is defined when the SIMD kernels are built
+ * (x86 with GCC or Clang).
+*/
+
+#pragma once
+#ifndef CC_MD5_MB_H
+#define CC_MD5_MB_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "md5.h"
+
+/*
+ * struct md5_mb_lane
+ *
+ * uint32_t s[4]         -- internal; hash state of the message
+ * const uint8_t* data   -- internal; next whole block of the message
+ * size_t blocks         -- internal; whole blocks left at data
+ * uint8_t tail[128]     -- internal; last partial block and padding
+ * const uint8_t* t_data -- internal; next block in tail
+ * size_t t_blocks       -- internal; blocks left at t_data
+*/
+struct md5_mb_lane {
+    uint32_t s[4];
+
+    const uint8_t* data;
+    size_t blocks;
+
+    uint8_t tail[128];
+    const uint8_t* t_data;
+    size_t t_blocks;
+};
+
+/*
+ * md5_mb md5_mb_lane_init
+ *
+ * Sets up lane to hash the len bytes at msg: the whole blocks are read in
+ * place and the rest, with the md5 padding, is copied into lane->tail.
+*/
+extern inline void md5_mb_lane_init(struct md5_mb_lane* lane,
+                                    const uint8_t* msg, size_t len)
+{
+    struct md5 m;
+    size_t rest = len % 64;
+    uint64_t bits = (uint64_t) len * 8;
+    size_t end = 0;
+    size_t i = 0;
+
+    md5_init(&m);
+    memcpy(lane->s, m.s, sizeof(lane->s));
+
+    lane->data = msg;
+    lane->blocks = len / 64;
+
+    // The 0x80 byte and the 64-bit length need nine bytes after the message.
+    lane->t_blocks = rest < 56 ? 1 : 2;
+    end = lane->t_blocks * 64;
+
+    memset(lane->tail, 0, sizeof(lane->tail));
+    if (rest > 0) {
+        memcpy(lane->tail, msg + len - rest, rest);
+    }
+    lane->tail[rest] = 0x80;
+    for (i = 0; i < 8; i++) {
+        lane->tail[end - 8 + i] = (uint8_t) (bits >> (8 * i));
+    }
+    lane->t_data = lane->tail;
+}
+
+/*
+ * md5_mb md5_mb_lane_next
+ *
+ * Returns the next block of the lane and moves past it, or NULL once the
+ * lane is finished.
+*/
+extern inline const uint8_t* md5_mb_lane_next(struct md5_mb_lane* lane)
+{
+    const uint8_t* block = NULL;
+
+    if (lane->blocks > 0) {
+        block = lane->data;
+        lane->data += 64;
+        lane->blocks -= 1;
+    } else if (lane->t_blocks > 0) {
+        block = lane->t_data;
+        lane->t_data += 64;
+        lane->t_blocks -= 1;
+    }
+
+    return block;
+}
+
+/*
+ * md5_mb md5_mb_lane_busy
+ *
+ * Returns the number of the first count lanes that still have blocks left.
+*/
+extern inline size_t md5_mb_lane_busy(const struct md5_mb_lane* lanes,
+                                      size_t count)
+{
+    size_t busy = 0;
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        busy += lanes[i].blocks + lanes[i].t_blocks > 0;
+    }
+
+    return busy;
+}
+
+/*
+ * md5_mb md5_mb_lane_finish
+ *
+ * Hashes whatever is left of the lane with md5_core_blocks and writes the
+ * little-endian digest to the 16 bytes at digest.
+*/
+extern inline void md5_mb_lane_finish(struct md5_mb_lane* lane,
+                                      uint8_t* digest)
+{
+    size_t i = 0;
+
+    md5_core_blocks(lane->s, lane->data, lane->blocks);
+    md5_core_blocks(lane->s, lane->t_data, lane->t_blocks);
+    lane->blocks = 0;
+    lane->t_blocks = 0;
+
+    for (i = 0; i < 4; i++) {
+        digest[i * 4 + 0] = (uint8_t) (lane->s[i] >> 0);
+        digest[i * 4 + 1] = (uint8_t) (lane->s[i] >> 8);
+        digest[i * 4 + 2] = (uint8_t) (lane->s[i] >> 16);
+        digest[i * 4 + 3] = (uint8_t) (lane->s[i] >> 24);
+    }
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_MD5_MB 1
+
+#include "immintrin.h"
+
+/*
+ * Per-step constants, rotation counts and message word indices of the 64
+ * steps of md5_core_blocks, in order.
+*/
+const uint32_t md5_mb_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+const uint8_t md5_mb_r[64] = {
+     7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
+     5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
+     4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
+     6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21
+};
+
+const uint8_t md5_mb_g[64] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+     1,  6, 11,  0,  5, 10, 15,  4,  9, 14,  3,  8, 13,  2,  7, 12,
+     5,  8, 11, 14,  1,  4,  7, 10, 13,  0,  3,  6,  9, 12, 15,  2,
+     0,  7, 14,  5, 12,  3, 10,  1,  8, 15,  6, 13,  4, 11,  2,  9
+};
+
+/*
+ * md5_mb md5_mb_sse2_compress
+ *
+ * Runs the 64 steps on one block per lane, blocks[i] for lane i, updating
+ * the transposed state s (s[j] holds word j of the four lanes). Lanes whose
+ * word in active is zero keep their state; their block pointer must still
+ * be readable.
+*/
+__attribute__((target("sse2")))
+extern inline void md5_mb_sse2_compress(__m128i* s, const uint8_t** blocks,
+                                        __m128i active)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i x[16];
+    __m128i r[4];
+    __m128i t[4];
+    __m128i a = s[0];
+    __m128i b = s[1];
+    __m128i c = s[2];
+    __m128i d = s[3];
+    __m128i f;
+    size_t i = 0;
+    size_t k = 0;
+
+    // Transpose the blocks in 4x4 tiles so x[j] holds word j of each lane.
+    for (k = 0; k < 16; k += 4) {
+        for (i = 0; i < 4; i++) {
+            r[i] = _mm_loadu_si128((const __m128i*) (blocks[i] + 4 * k));
+        }
+
+        t[0] = _mm_unpacklo_epi32(r[0], r[1]);
+        t[1] = _mm_unpacklo_epi32(r[2], r[3]);
+        t[2] = _mm_unpackhi_epi32(r[0], r[1]);
+        t[3] = _mm_unpackhi_epi32(r[2], r[3]);
+        x[k + 0] = _mm_unpacklo_epi64(t[0], t[1]);
+        x[k + 1] = _mm_unpackhi_epi64(t[0], t[1]);
+        x[k + 2] = _mm_unpacklo_epi64(t[2], t[3]);
+        x[k + 3] = _mm_unpackhi_epi64(t[2], t[3]);
+    }
+
+    for (i = 0; i < 64; i++) {
+        if (i < 16) {
+            f = _mm_or_si128(_mm_and_si128(b, c), _mm_andnot_si128(b, d));
+        } else if (i < 32) {
+            f = _mm_or_si128(_mm_and_si128(d, b), _mm_andnot_si128(d, c));
+        } else if (i < 48) {
+            f = _mm_xor_si128(_mm_xor_si128(b, c), d);
+        } else {
+            f = _mm_xor_si128(c, _mm_or_si128(b, _mm_xor_si128(d, ones)));
+        }
+
+        f = _mm_add_epi32(_mm_add_epi32(f, a), x[md5_mb_g[i]]);
+        f = _mm_add_epi32(f, _mm_set1_epi32((int) md5_mb_k[i]));
+        f = _mm_or_si128(_mm_slli_epi32(f, md5_mb_r[i]),
+                         _mm_srli_epi32(f, 32 - md5_mb_r[i]));
+
+        a = d;
+        d = c;
+        c = b;
+        b = _mm_add_epi32(b, f);
+    }
+
+    // Add temporary variables back into the state of the active lanes.
+    s[0] = _mm_add_epi32(s[0], _mm_and_si128(a, active));
+    s[1] = _mm_add_epi32(s[1], _mm_and_si128(b, active));
+    s[2] = _mm_add_epi32(s[2], _mm_and_si128(c, active));
+    s[3] = _mm_add_epi32(s[3], _mm_and_si128(d, active));
+}
+
+/*
+ * md5_mb md5_mb_avx2_transpose
+ *
+ * Transposes the 8x8 matrix of 32-bit words in r, so that word j of row i
+ * becomes word i of row j.
+*/
+__attribute__((target("avx2")))
+extern inline void md5_mb_avx2_transpose(__m256i* r)
+{
+    __m256i t[8];
+    __m256i u[8];
+    size_t i = 0;
+
+    for (i = 0; i < 8; i += 2) {
+        t[i + 0] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+
+    for (i = 0; i < 8; i += 4) {
+        u[i + 0] = _mm256_unpacklo_epi64(t[i + 0], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i + 0], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    for (i = 0; i < 4; i++) {
+        r[i + 0] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+/*
+ * md5_mb md5_mb_avx2_compress
+ *
+ * md5_mb_sse2_compress on eight lanes.
+*/
+__attribute__((target("avx2")))
+extern inline void md5_mb_avx2_compress(__m256i* s, const uint8_t** blocks,
+                                        __m256i active)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i x[16];
+    __m256i a = s[0];
+    __m256i b = s[1];
+    __m256i c = s[2];
+    __m256i d = s[3];
+    __m256i f;
+    size_t i = 0;
+
+    for (i = 0; i < 8; i++) {
+        x[i] = _mm256_loadu_si256((const __m256i*) blocks[i]);
+        x[i + 8] = _mm256_loadu_si256((const __m256i*) (blocks[i] + 32));
+    }
+    md5_mb_avx2_transpose(x);
+    md5_mb_avx2_transpose(x + 8);
+
+    for (i = 0; i < 64; i++) {
+        if (i < 16) {
+            f = _mm256_or_si256(_mm256_and_si256(b, c),
+                                _mm256_andnot_si256(b, d));
+        } else if (i < 32) {
+            f = _mm256_or_si256(_mm256_and_si256(d, b),
+                                _mm256_andnot_si256(d, c));
+        } else if (i < 48) {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+        } else {
+            f = _mm256_xor_si256(c, _mm256_or_si256(b,
+                                 _mm256_xor_si256(d, ones)));
+        }
+
+        f = _mm256_add_epi32(_mm256_add_epi32(f, a), x[md5_mb_g[i]]);
+        f = _mm256_add_epi32(f, _mm256_set1_epi32((int) md5_mb_k[i]));
+        f = _mm256_or_si256(_mm256_slli_epi32(f, md5_mb_r[i]),
+                            _mm256_srli_epi32(f, 32 - md5_mb_r[i]));
+
+        a = d;
+        d = c;
+        c = b;
+        b = _mm256_add_epi32(b, f);
+    }
+
+    s[0] = _mm256_add_epi32(s[0], _mm256_and_si256(a, active));
+    s[1] = _mm256_add_epi32(s[1], _mm256_and_si256(b, active));
+    s[2] = _mm256_add_epi32(s[2], _mm256_and_si256(c, active));
+    s[3] = _mm256_add_epi32(s[3], _mm256_and_si256(d, active));
+}
+
+/*
+ * md5_mb md5_mb_avx512_transpose
+ *
+ * Transposes the 16x16 matrix of 32-bit words in r, so that word j of row i
+ * becomes word i of row j.
+*/
+__attribute__((target("avx512f")))
+extern inline void md5_mb_avx512_transpose(__m512i* r)
+{
+    __m512i t[16];
+    __m512i u[4];
+    size_t i = 0;
+
+    // Within each 128-bit lane: 4x4 tiles of rows 4k..4k+3.
+    for (i = 0; i < 16; i += 2) {
+        t[i + 0] = _mm512_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm512_unpackhi_epi32(r[i], r[i + 1]);
+    }
+
+    for (i = 0; i < 16; i += 4) {
+        r[i + 0] = _mm512_unpacklo_epi64(t[i + 0], t[i + 2]);
+        r[i + 1] = _mm512_unpackhi_epi64(t[i + 0], t[i + 2]);
+        r[i + 2] = _mm512_unpacklo_epi64(t[i + 1], t[i + 3]);
+        r[i + 3] = _mm512_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    // Then transpose the 4x4 matrix of 128-bit lanes.
+    for (i = 0; i < 4; i++) {
+        u[0] = _mm512_shuffle_i32x4(r[i], r[i + 4], 0x44);
+        u[1] = _mm512_shuffle_i32x4(r[i], r[i + 4], 0xEE);
+        u[2] = _mm512_shuffle_i32x4(r[i + 8], r[i + 12], 0x44);
+        u[3] = _mm512_shuffle_i32x4(r[i + 8], r[i + 12], 0xEE);
+
+        t[i + 0] = _mm512_shuffle_i32x4(u[0], u[2], 0x88);
+        t[i + 4] = _mm512_shuffle_i32x4(u[0], u[2], 0xDD);
+        t[i + 8] = _mm512_shuffle_i32x4(u[1], u[3], 0x88);
+        t[i + 12] = _mm512_shuffle_i32x4(u[1], u[3], 0xDD);
+    }
+
+    for (i = 0; i < 16; i++) {
+        r[i] = t[i];
+    }
+}
+
+/*
+ * md5_mb md5_mb_avx512_compress
+ *
+ * md5_mb_sse2_compress on sixteen lanes, with the lanes to update given as
+ * a mask. The four boolean functions are each a single VPTERNLOGD.
+*/
+__attribute__((target("avx512f")))
+extern inline void md5_mb_avx512_compress(__m512i* s, const uint8_t** blocks,
+        __mmask16 active)
+{
+    __m512i x[16];
+    __m512i a = s[0];
+    __m512i b = s[1];
+    __m512i c = s[2];
+    __m512i d = s[3];
+    __m512i f;
+    size_t i = 0;
+
+    for (i = 0; i < 16; i++) {
+        x[i] = _mm512_loadu_si512((const void*) blocks[i]);
+    }
+    md5_mb_avx512_transpose(x);
+
+    for (i = 0; i < 64; i++) {
+        if (i < 16) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0xCA);
+        } else if (i < 32) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0xE4);
+        } else if (i < 48) {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0x96);
+        } else {
+            f = _mm512_ternarylogic_epi32(b, c, d, 0x39);
+        }
+
+        f = _mm512_add_epi32(_mm512_add_epi32(f, a), x[md5_mb_g[i]]);
+        f = _mm512_add_epi32(f, _mm512_set1_epi32((int) md5_mb_k[i]));
+        f = _mm512_rolv_epi32(f, _mm512_set1_epi32(md5_mb_r[i]));
+
+        a = d;
+        d = c;
+        c = b;
+        b = _mm512_add_epi32(b, f);
+    }
+
+    s[0] = _mm512_mask_add_epi32(s[0], active, s[0], a);
+    s[1] = _mm512_mask_add_epi32(s[1], active, s[1], b);
+    s[2] = _mm512_mask_add_epi32(s[2], active, s[2], c);
+    s[3] = _mm512_mask_add_epi32(s[3], active, s[3], d);
+}
+
+/*
+ * md5_mb md5_mb_lane_blocks
+ *
+ * Fetches the next block of each of the count lanes into blocks and sets
+ * active[i] to -1 for the lanes that had one. Finished lanes get their
+ * (readable, ignored) tail buffer instead.
+*/
+extern inline void md5_mb_lane_blocks(struct md5_mb_lane* lanes,
+                                      size_t count, const uint8_t** blocks,
+                                      int32_t* active)
+{
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        blocks[i] = md5_mb_lane_next(&lanes[i]);
+        active[i] = blocks[i] != NULL ? -1 : 0;
+        if (blocks[i] == NULL) {
+            blocks[i] = lanes[i].tail;
+        }
+    }
+}
+
+/*
+ * md5_mb md5_mb_sse2_run
+ *
+ * Hashes blocks of the first four lanes together while at least two of them
+ * have blocks left.
+*/
+__attribute__((target("sse2")))
+extern inline void md5_mb_sse2_run(struct md5_mb_lane* lanes)
+{
+    const uint8_t* blocks[4];
+    int32_t active[4];
+    __m128i s[4];
+    size_t i = 0;
+
+    for (i = 0; i < 4; i++) {
+        s[i] = _mm_set_epi32((int) lanes[3].s[i], (int) lanes[2].s[i],
+                             (int) lanes[1].s[i], (int) lanes[0].s[i]);
+    }
+
+    while (md5_mb_lane_busy(lanes, 4) >= 2) {
+        md5_mb_lane_blocks(lanes, 4, blocks, active);
+        md5_mb_sse2_compress(s, blocks,
+                             _mm_loadu_si128((const __m128i*) active));
+    }
+
+    for (i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i*) active, s[i]);
+        lanes[0].s[i] = (uint32_t) active[0];
+        lanes[1].s[i] = (uint32_t) active[1];
+        lanes[2].s[i] = (uint32_t) active[2];
+        lanes[3].s[i] = (uint32_t) active[3];
+    }
+}
+
+/*
+ * md5_mb md5_mb_avx2_run
+ *
+ * md5_mb_sse2_run on eight lanes.
+*/
+__attribute__((target("avx2")))
+extern inline void md5_mb_avx2_run(struct md5_mb_lane* lanes)
+{
+    const uint8_t* blocks[8];
+    int32_t active[8];
+    uint32_t words[8];
+    __m256i s[4];
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 8; j++) {
+            words[j] = lanes[j].s[i];
+        }
+        s[i] = _mm256_loadu_si256((const __m256i*) words);
+    }
+
+    while (md5_mb_lane_busy(lanes, 8) >= 4) {
+        md5_mb_lane_blocks(lanes, 8, blocks, active);
+        md5_mb_avx2_compress(s, blocks,
+                             _mm256_loadu_si256((const __m256i*) active));
+    }
+
+    for (i = 0; i < 4; i++) {
+        _mm256_storeu_si256((__m256i*) words, s[i]);
+        for (j = 0; j < 8; j++) {
+            lanes[j].s[i] = words[j];
+        }
+    }
+}
+
+/*
+ * md5_mb md5_mb_avx512_run
+ *
+ * md5_mb_sse2_run on sixteen lanes.
+*/
+__attribute__((target("avx512f")))
+extern inline void md5_mb_avx512_run(struct md5_mb_lane* lanes)
+{
+    const uint8_t* blocks[16];
+    int32_t active[16];
+    uint32_t words[16];
+    __m512i s[4];
+    __mmask16 mask = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 16; j++) {
+            words[j] = lanes[j].s[i];
+        }
+        s[i] = _mm512_loadu_si512((const void*) words);
+    }
+
+    while (md5_mb_lane_busy(lanes, 16) >= 8) {
+        md5_mb_lane_blocks(lanes, 16, blocks, active);
+        mask = 0;
+        for (j = 0; j < 16; j++) {
+            mask |= (__mmask16) ((active[j] != 0) << j);
+        }
+        md5_mb_avx512_compress(s, blocks, mask);
+    }
+
+    for (i = 0; i < 4; i++) {
+        _mm512_storeu_si512((void*) words, s[i]);
+        for (j = 0; j < 16; j++) {
+            lanes[j].s[i] = words[j];
+        }
+    }
+}
+
+/*
+ * md5_mb md5_mb_width
+ *
+ * Returns the number of lanes of the widest kernel the host supports: 16
+ * (AVX-512), 8 (AVX2), 4 (SSE2) or 1 (scalar only).
+*/
+extern inline size_t md5_mb_width()
+{
+    if (__builtin_cpu_supports("avx512f")) {
+        return 16;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return 8;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return 4;
+    }
+    return 1;
+}
+
+#else
+
+extern inline size_t md5_mb_width()
+{
+    return 1;
+}
+
+#endif
+
+/*
+ * md5_mb md5_mb_batch_width
+ *
+ * Computes the md5 digests of count messages, msg[i] of len[i] bytes, width
+ * at a time with the kernel of that many lanes, and writes digest i to the
+ * 16 bytes at digests + 16 * i. width must be 1, 4, 8 or 16 and no more
+ * than md5_mb_width(); 1 hashes every message with md5_core_blocks.
+*/
+extern inline void md5_mb_batch_width(const uint8_t* const* msg,
+                                      const size_t* len, uint8_t* digests,
+                                      size_t count, size_t width)
+{
+    struct md5_mb_lane lanes[16];
+    size_t group = 0;
+    size_t n = 0;
+    size_t i = 0;
+
+    for (group = 0; group < count; group += width) {
+        n = count - group < width ? count - group : width;
+
+        for (i = 0; i < width; i++) {
+            if (i < n) {
+                md5_mb_lane_init(&lanes[i], msg[group + i], len[group + i]);
+            } else {
+                // Idle lanes have nothing to hash.
+                md5_mb_lane_init(&lanes[i], NULL, 0);
+                lanes[i].t_blocks = 0;
+            }
+        }
+
+#ifdef CC_MD5_MB
+        if (width == 16) {
+            md5_mb_avx512_run(lanes);
+        } else if (width == 8) {
+            md5_mb_avx2_run(lanes);
+        } else if (width == 4) {
+            md5_mb_sse2_run(lanes);
+        }
+#endif
+
+        for (i = 0; i < n; i++) {
+            md5_mb_lane_finish(&lanes[i], digests + 16 * (group + i));
+        }
+    }
+}
+
+/*
+ * md5_mb md5_mb_batch
+ *
+ * md5_mb_batch_width with the widest kernel the host supports.
+*/
+extern inline void md5_mb_batch(const uint8_t* const* msg,
+                                const size_t* len, uint8_t* digests,
+                                size_t count)
+{
+    md5_mb_batch_width(msg, len, digests, count, md5_mb_width());
+}
+
+#endif
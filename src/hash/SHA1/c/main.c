@@ -7,6 +7,7 @@
 #include "sha1.h"
 #include "stdio.h"
 #include "strings.h"
+#include "time.h"
 
 void test_null()
 {
@@ -56,9 +57,187 @@ void test_foxdogperiod()
     printf("\n\n");
 }
 
+void test_chunked()
+{
+    struct sha1 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of sha1_update.
+    memset(buffer, 'a', sizeof(buffer));
+    sha1_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        sha1_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    sha1_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: 34aa973cd4c4daa4f61eeb2bdbad27316534016f\nResult:   ");
+
+    for (int i = 0; i < 20; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_chunked_padding()
+{
+    struct sha1 m;
+    char buffer[256];
+    size_t lengths[4] = { 247, 248, 255, 256 };
+    size_t sizes[3] = { 1, 63, 65 };
+    const char* expected[4] = {
+        "4f29a70ace594ef0853c89c7c7522cdf8c156b92",
+        "d1d8b02edb3538460a99c23d618365b0d6d79ce3",
+        "5afd9729928ad946eee5610434e66b5f95accbaf",
+        "9c78512ad150c8b5d8918395ad0e5169397d2b62"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 55, 56, 63 and 64
+    // bytes: from 56 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        sha1_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            sha1_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        sha1_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 20; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_shani()
+{
+    static uint8_t data[64 * 37];
+    struct sha1 portable;
+    struct sha1 shani;
+
+    printf("SHA extensions supported: %d\n", sha1_shani_supported());
+
+    for (int i = 0; i < 64 * 37; i++) {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    sha1_init(&portable);
+    sha1_portable_core_blocks(portable.h, data, 37);
+    printf("Expected: ");
+    for (int i = 0; i < 5; i++) {
+        printf("%08x", portable.h[i]);
+    }
+    printf("\n");
+
+#ifdef CC_SHA1_SHANI
+    if (sha1_shani_supported()) {
+        sha1_init(&shani);
+        sha1_shani_core_blocks(shani.h, data, 37);
+        printf("Result:   ");
+        for (int i = 0; i < 5; i++) {
+            printf("%08x", shani.h[i]);
+        }
+        printf("\n");
+    }
+#endif
+
+    printf("\n");
+}
+
+void benchmark_shani()
+{
+    static uint8_t data[1048576];
+    struct sha1 m;
+    clock_t start;
+
+    sha1_init(&m);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha1_portable_core_blocks(m.h, data, sizeof(data) / 64);
+    }
+    printf("Benchmark: 64MB sha1_portable_core_blocks: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+#ifdef CC_SHA1_SHANI
+    if (sha1_shani_supported()) {
+        start = clock();
+        for (int i = 0; i < 64; i++) {
+            sha1_shani_core_blocks(m.h, data, sizeof(data) / 64);
+        }
+        printf("Benchmark: 64MB sha1_shani_core_blocks: %f seconds\n",
+               (double) (clock() - start) / CLOCKS_PER_SEC);
+    }
+#endif
+}
+
+void test_export()
+{
+    char msg[] = "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog";
+    uint8_t state[SHA1_STATE_SIZE];
+    struct sha1 m;
+    struct sha1 resumed;
+    const struct sha1* frozen = &m;
+
+    // Checkpoint mid-message through a const pointer and resume in a
+    // separate struct.
+    sha1_init(&m);
+    sha1_update(&m, msg, 86);
+    sha1_export(frozen, state);
+
+    memset(&resumed, 0xff, sizeof(resumed));
+    printf("Message:  import of sha1_export\nExpected: 1\nResult:   %d\n\n",
+           sha1_import(&resumed, state, sizeof(state)));
+
+    sha1_update(&resumed, msg + 86, 43);
+    sha1_finalize(&resumed);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog (x3), resumed\nExpected: d42f858ad812fd986fd8dc7216af5f88bcaa1463\nResult:   ");
+
+    for (int i = 0; i < 20; i ++) {
+        printf("%02x", resumed.digest[i]);
+    }
+
+    printf("\n\n");
+
+    // A state from another version is rejected.
+    state[2]++;
+    printf("Message:  import of another version\nExpected: 0\nResult:   %d\n\n",
+           sha1_import(&resumed, state, sizeof(state)));
+}
+
 int main()
 {
     test_null();
     test_foxdog();
     test_foxdogperiod();
+    test_chunked();
+    test_chunked_padding();
+    test_export();
+    test_shani();
+    benchmark_shani();
 }
@@ -27,6 +27,11 @@
 
 #include "stdint.h"
 #include "string.h"
+#include "sha1_shani.h"
+
+#define SHA1_STATE_VERSION 1
+#define SHA1_STATE_ID 2
+#define SHA1_STATE_SIZE 97
 
 /*
  * struct sha1
@@ -122,10 +127,62 @@ extern inline uint32_t sha1_rotl32(uint32_t data, uint32_t count)
 }
 
 /*
- * sha1 sha1_core
+ * sha1 sha1_schedule
+ *
+ * Computes W(t) for t >= 16 into the 16-word circular buffer w, where it
+ * replaces W(t-16), and returns it.
+*/
+extern inline uint32_t sha1_schedule(uint32_t* w, size_t t)
+{
+    w[t & 15] = sha1_rotl32(w[(t - 3) & 15] ^ w[(t - 8) & 15] ^
+                            w[(t - 14) & 15] ^ w[t & 15], 1);
+    return w[t & 15];
+}
+
+/*
+ * sha1 sha1_round_ch
  *
- * Core of sha1 hash function; operates on a single round from m->partial
- * and updates hash state in m->h.
+ * One round of rounds 0 to 19: e becomes TEMP and b becomes S^30(B). The
+ * caller renames the variables for the next round instead of moving them.
+*/
+extern inline void sha1_round_ch(uint32_t a, uint32_t* b, uint32_t c,
+                                 uint32_t d, uint32_t* e, uint32_t w)
+{
+    *e += sha1_rotl32(a, 5) + (d ^ (*b & (c ^ d))) + w + 0x5A827999;
+    *b = sha1_rotl32(*b, 30);
+}
+
+/*
+ * sha1 sha1_round_parity
+ *
+ * One round of rounds 20 to 39 (k = 0x6ED9EBA1) or 60 to 79
+ * (k = 0xCA62C1D6), as sha1_round_ch.
+*/
+extern inline void sha1_round_parity(uint32_t a, uint32_t* b, uint32_t c,
+                                     uint32_t d, uint32_t* e, uint32_t w,
+                                     uint32_t k)
+{
+    *e += sha1_rotl32(a, 5) + (*b ^ c ^ d) + w + k;
+    *b = sha1_rotl32(*b, 30);
+}
+
+/*
+ * sha1 sha1_round_maj
+ *
+ * One round of rounds 40 to 59, as sha1_round_ch.
+*/
+extern inline void sha1_round_maj(uint32_t a, uint32_t* b, uint32_t c,
+                                  uint32_t d, uint32_t* e, uint32_t w)
+{
+    *e += sha1_rotl32(a, 5) + ((*b & c) | (d & (*b | c))) + w + 0x8F1BBCDC;
+    *b = sha1_rotl32(*b, 30);
+}
+
+/*
+ * sha1 sha1_portable_core_blocks
+ *
+ * Portable core of sha1 hash function; operates on nblocks consecutive
+ * 64-byte blocks at data and updates the hash state in state.
  *
  * Now M(1), M(2), ... , M(n) are processed.  To process M(i), we
  * proceed as follows:
@@ -143,50 +200,134 @@ extern inline uint32_t sha1_rotl32(uint32_t data, uint32_t count)
  *
  *    e. Let H0 = H0 + A, H1 = H1 + B, H2 = H2 + C, H3 = H3 + D, H4 = H4
  *       + E.
+ *
+ * Here the rounds are written out in four groups of twenty with f and K
+ * fixed for each group, A to E are renamed from round to round rather than
+ * moved, and W is kept in a 16-word circular buffer (see sha1_schedule).
 */
-extern inline void sha1_core(struct sha1* m)
+extern inline void sha1_portable_core_blocks(uint32_t* state,
+        const uint8_t* data, size_t nblocks)
 {
     size_t t = 0;
-    uint32_t w[80];
-    uint32_t h[5];
-    uint32_t temp;
-
-    // Message has to be processed as a big endian integer
-    for (t = 0; t < 16; t++) {
-        w[t] = (((
-                     uint32_t) m->partial[t * 4 + 0]) << 24) | (((
-                                 uint32_t) m->partial[t * 4 + 1]) << 16) | (((
-                                             uint32_t) m->partial[t * 4 + 2]) << 8) | (((
-                                                     uint32_t) m->partial[t * 4 + 3]) << 0);
-    }
+    uint32_t w[16];
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+    uint32_t e;
+    size_t block = 0;
+
+    for (block = 0; block < nblocks; block++) {
+        // Message has to be processed as a big endian integer
+        for (t = 0; t < 16; t++) {
+            w[t] = ((uint32_t) data[t * 4 + 0] << 24) |
+                   ((uint32_t) data[t * 4 + 1] << 16) |
+                   ((uint32_t) data[t * 4 + 2] << 8) |
+                   ((uint32_t) data[t * 4 + 3] << 0);
+        }
+
+        // Duplicate state into temporary variables
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+
+        // Rounds 0 to 19; W(16) onwards are computed as they are used.
+        for (t = 0; t < 15; t += 5) {
+            sha1_round_ch(a, &b, c, d, &e, w[t + 0]);
+            sha1_round_ch(e, &a, b, c, &d, w[t + 1]);
+            sha1_round_ch(d, &e, a, b, &c, w[t + 2]);
+            sha1_round_ch(c, &d, e, a, &b, w[t + 3]);
+            sha1_round_ch(b, &c, d, e, &a, w[t + 4]);
+        }
+        sha1_round_ch(a, &b, c, d, &e, w[15]);
+        sha1_round_ch(e, &a, b, c, &d, sha1_schedule(w, 16));
+        sha1_round_ch(d, &e, a, b, &c, sha1_schedule(w, 17));
+        sha1_round_ch(c, &d, e, a, &b, sha1_schedule(w, 18));
+        sha1_round_ch(b, &c, d, e, &a, sha1_schedule(w, 19));
+
+        // Rounds 20 to 39
+        for (t = 20; t < 40; t += 5) {
+            sha1_round_parity(a, &b, c, d, &e,
+                              sha1_schedule(w, t + 0), 0x6ED9EBA1);
+            sha1_round_parity(e, &a, b, c, &d,
+                              sha1_schedule(w, t + 1), 0x6ED9EBA1);
+            sha1_round_parity(d, &e, a, b, &c,
+                              sha1_schedule(w, t + 2), 0x6ED9EBA1);
+            sha1_round_parity(c, &d, e, a, &b,
+                              sha1_schedule(w, t + 3), 0x6ED9EBA1);
+            sha1_round_parity(b, &c, d, e, &a,
+                              sha1_schedule(w, t + 4), 0x6ED9EBA1);
+        }
 
-    for (t = 16; t < 80; t++) {
-        w[t] = sha1_rotl32(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+        // Rounds 40 to 59
+        for (t = 40; t < 60; t += 5) {
+            sha1_round_maj(a, &b, c, d, &e,
+                           sha1_schedule(w, t + 0));
+            sha1_round_maj(e, &a, b, c, &d,
+                           sha1_schedule(w, t + 1));
+            sha1_round_maj(d, &e, a, b, &c,
+                           sha1_schedule(w, t + 2));
+            sha1_round_maj(c, &d, e, a, &b,
+                           sha1_schedule(w, t + 3));
+            sha1_round_maj(b, &c, d, e, &a,
+                           sha1_schedule(w, t + 4));
+        }
+
+        // Rounds 60 to 79
+        for (t = 60; t < 80; t += 5) {
+            sha1_round_parity(a, &b, c, d, &e,
+                              sha1_schedule(w, t + 0), 0xCA62C1D6);
+            sha1_round_parity(e, &a, b, c, &d,
+                              sha1_schedule(w, t + 1), 0xCA62C1D6);
+            sha1_round_parity(d, &e, a, b, &c,
+                              sha1_schedule(w, t + 2), 0xCA62C1D6);
+            sha1_round_parity(c, &d, e, a, &b,
+                              sha1_schedule(w, t + 3), 0xCA62C1D6);
+            sha1_round_parity(b, &c, d, e, &a,
+                              sha1_schedule(w, t + 4), 0xCA62C1D6);
+        }
+
+        // Add temporary variables back into state.
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+
+        data += 64;
     }
+}
 
-    // Duplicate state into temporary variables
-    h[0] = m->h[0];
-    h[1] = m->h[1];
-    h[2] = m->h[2];
-    h[3] = m->h[3];
-    h[4] = m->h[4];
-
-    for (t = 0; t < 80; t++) {
-        temp = sha1_rotl32(h[0], 5) + sha1_f(t, h[1], h[2],
-                                             h[3]) + h[4] + w[t] + sha1_k(t);
-        h[4] = h[3];
-        h[3] = h[2];
-        h[2] = sha1_rotl32(h[1], 30);
-        h[1] = h[0];
-        h[0] = temp;
+/*
+ * sha1 sha1_core_blocks
+ *
+ * Hashes nblocks consecutive 64-byte blocks at data into state, with the
+ * SHA extensions when the host has them (sha1_shani.h) and with
+ * sha1_portable_core_blocks otherwise.
+*/
+extern inline void sha1_core_blocks(uint32_t* state, const uint8_t* data,
+                                    size_t nblocks)
+{
+#ifdef CC_SHA1_SHANI
+    if (sha1_shani_supported()) {
+        sha1_shani_core_blocks(state, data, nblocks);
+        return;
     }
+#endif
 
-    // Add temporary variables back into state.
-    m->h[0] += h[0];
-    m->h[1] += h[1];
-    m->h[2] += h[2];
-    m->h[3] += h[3];
-    m->h[4] += h[4];
+    sha1_portable_core_blocks(state, data, nblocks);
+}
+
+/*
+ * sha1 sha1_core
+ *
+ * Runs sha1_core_blocks on the buffered block in m->partial.
+*/
+extern inline void sha1_core(struct sha1* m)
+{
+    sha1_core_blocks(m->h, m->partial, 1);
 }
 
 /*
@@ -234,21 +375,41 @@ extern inline void sha1_init(struct sha1* m)
 */
 extern inline void sha1_update(struct sha1* m, char* msg, uint64_t len)
 {
-    size_t i = 0;
+    const uint8_t* data = (const uint8_t*) msg;
+    size_t fill = 0;
+    size_t nblocks = 0;
 
     m->len += len;
-    for (i = 0; i < len; i++) {
-        if (m->p_len == 64) {
-            m->p_len = 0;
 
-            // Once we finish a buffer, call the core sha1 function to update
-            // state and recompute the current hash value.
+    // Complete a partially filled block first.
+    if (m->p_len > 0) {
+        fill = 64 - m->p_len;
+        if (fill > len) {
+            fill = (size_t) len;
+        }
+
+        memcpy(m->partial + m->p_len, data, fill);
+        m->p_len += fill;
+        data += fill;
+        len -= fill;
+
+        if (m->p_len == 64) {
             sha1_core(m);
+            m->p_len = 0;
         }
+    }
 
-        m->partial[m->p_len] = (uint8_t)((unsigned char) msg[i]);
-        m->p_len += 1;
+    // Whole blocks are hashed directly from the caller's buffer.
+    nblocks = len / 64;
+    if (nblocks > 0) {
+        sha1_core_blocks(m->h, data, nblocks);
+        data += nblocks * 64;
+        len -= nblocks * 64;
     }
+
+    // Buffer the tail for the next update or finalize.
+    memcpy(m->partial + m->p_len, data, (size_t) len);
+    m->p_len += (size_t) len;
 }
 
 /*
@@ -390,4 +551,105 @@ extern inline uint8_t* sha1_sum(struct sha1* m, char* msg)
     return m->digest;
 }
 
+/*
+ * sha1 sha1_store_be
+ *
+ * Writes the low count bytes of value to out, most significant first.
+*/
+extern inline void sha1_store_be(uint8_t* out, uint64_t value, size_t count)
+{
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        out[i] = (uint8_t) (value >> (8 * (count - 1 - i)));
+    }
+}
+
+/*
+ * sha1 sha1_load_be
+ *
+ * Reads count bytes at in as a big endian integer.
+*/
+extern inline uint64_t sha1_load_be(const uint8_t* in, size_t count)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+/*
+ * sha1 sha1_export
+ *
+ * Serializes the in-progress state of m into the SHA1_STATE_SIZE bytes at
+ * out, so that hashing can resume later with sha1_import, in this process
+ * or another one. The layout is stable for a given SHA1_STATE_VERSION, and
+ * all integers are big endian:
+ *
+ *     4 bytes   -- "cc", SHA1_STATE_VERSION, SHA1_STATE_ID
+ *     20 bytes  -- h[0] through h[4]
+ *     8 bytes   -- len
+ *     1 byte    -- p_len
+ *     64 bytes  -- partial; bytes past p_len are zero
+*/
+extern inline void sha1_export(const struct sha1* m, uint8_t* out)
+{
+    size_t i = 0;
+
+    memset(out, 0, SHA1_STATE_SIZE);
+    out[0] = 'c';
+    out[1] = 'c';
+    out[2] = SHA1_STATE_VERSION;
+    out[3] = SHA1_STATE_ID;
+
+    for (i = 0; i < 5; i++) {
+        sha1_store_be(out + 4 + 4 * i, m->h[i], 4);
+    }
+
+    sha1_store_be(out + 24, m->len, 8);
+    out[32] = (uint8_t) m->p_len;
+    memcpy(out + 33, m->partial, m->p_len);
+}
+
+/*
+ * sha1 sha1_import
+ *
+ * Restores a state written by sha1_export into m; sha1_update and
+ * sha1_finalize then continue as if hashing had never stopped. Returns 1 on
+ * success. Returns 0 and leaves m untouched if the len bytes at in are not
+ * a sha1 state of this version.
+*/
+extern inline int sha1_import(struct sha1* m, const uint8_t* in, size_t len)
+{
+    size_t i = 0;
+    size_t p_len = 0;
+
+    if (len != SHA1_STATE_SIZE || in[0] != 'c' || in[1] != 'c' ||
+            in[2] != SHA1_STATE_VERSION || in[3] != SHA1_STATE_ID) {
+        return 0;
+    }
+
+    // The partial block always holds the input past the last whole block.
+    p_len = in[32];
+    if (p_len != (size_t) (sha1_load_be(in + 24, 8) % 64)) {
+        return 0;
+    }
+
+    memset(m->digest, 0, sizeof(m->digest));
+    for (i = 0; i < 5; i++) {
+        m->h[i] = (uint32_t) sha1_load_be(in + 4 + 4 * i, 4);
+    }
+
+    m->len = sha1_load_be(in + 24, 8);
+    m->p_len = p_len;
+    memset(m->partial, 0, sizeof(m->partial));
+    memcpy(m->partial, in + 33, p_len);
+
+    return 1;
+}
+
 #endif // CC_sha1_H
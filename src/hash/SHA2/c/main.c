@@ -8,8 +8,12 @@
 #include "sha2_256.h"
 #include "sha2_384.h"
 #include "sha2_512.h"
+#include "sha2_512_224.h"
+#include "sha2_512_256.h"
+#include "sha2_256_avx2.h"
 #include "stdio.h"
 #include "strings.h"
+#include "time.h"
 
 void test_sha2_224_null()
 {
@@ -203,6 +207,946 @@ void test_sha2_512_foxcog()
     printf("\n\n");
 }
 
+void test_sha2_224_chunked()
+{
+    struct sha2_224 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of sha2_224_update.
+    memset(buffer, 'a', sizeof(buffer));
+    sha2_224_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        sha2_224_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    sha2_224_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: 20794655980c91d8bbb4c1ea97618a4bf03f42581948b2ee4ee7ad67\nResult:   ");
+
+    for (int i = 0; i < 28; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_224_chunked_padding()
+{
+    struct sha2_224 m;
+    char buffer[256];
+    size_t lengths[4] = { 247, 248, 255, 256 };
+    size_t sizes[3] = { 1, 63, 65 };
+    const char* expected[4] = {
+        "83b7f1ec6a30667ef11920a72f8c33b1fe7d85137a6f1cf3889b91ea",
+        "23194478636ea1f87c98a2d55177cbf505ab796a14355fea55b44e57",
+        "4b3ac7f9720f32ba21f5137acbc76d238e4c70d884a1942f69dc127b",
+        "f04baed8b027a18d96a1485220841d375a1bb4576760cd15a4cdb1a1"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 55, 56, 63 and 64
+    // bytes: from 56 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        sha2_224_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            sha2_224_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        sha2_224_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 28; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_256_chunked()
+{
+    struct sha2_256 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of sha2_256_update.
+    memset(buffer, 'a', sizeof(buffer));
+    sha2_256_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        sha2_256_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    sha2_256_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_256_chunked_padding()
+{
+    struct sha2_256 m;
+    char buffer[256];
+    size_t lengths[4] = { 247, 248, 255, 256 };
+    size_t sizes[3] = { 1, 63, 65 };
+    const char* expected[4] = {
+        "d1c97f05a04d45d67be0d82b39f93d8e06e52db3aeb4752067c9b5e61583b641",
+        "fdff3ab023a901d4e6d47d39905cc6a4d394b9297d2605ac17efbf10da969fd2",
+        "b0f3323e7a3cad8ae6778340cc2a17ae0cb31c818df3767cda7c3dd423725e90",
+        "02d7160d77e18c6447be80c2e355c7ed4388545271702c50253b0914c65ce5fe"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 55, 56, 63 and 64
+    // bytes: from 56 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        sha2_256_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            sha2_256_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        sha2_256_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 32; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_384_chunked()
+{
+    struct sha2_384 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of sha2_384_update.
+    memset(buffer, 'a', sizeof(buffer));
+    sha2_384_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        sha2_384_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    sha2_384_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: 9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b07b8b3dc38ecc4ebae97ddd87f3d8985\nResult:   ");
+
+    for (int i = 0; i < 48; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_384_chunked_padding()
+{
+    struct sha2_384 m;
+    char buffer[504];
+    size_t lengths[4] = { 495, 496, 503, 504 };
+    size_t sizes[3] = { 1, 127, 129 };
+    const char* expected[4] = {
+        "54981503574809c854f9174e769dd2f502ee9eb148f675e6"
+        "c74db375d2396c00ea5423ef85d2e11a54979fa3bb9fc491",
+        "80aa57cff5363551f26d35fe8258c253dc2ca16ffa42a506"
+        "15ddb75305a0ee3a9de3b3b31e37d7048c8f9239b524f3db",
+        "7a56bfb7fab7018c3440ca1d7dc50fe73d2502cd80243e32"
+        "8ffd3567906ab78f5f98726e640af1ea6c8089a3bc57d644",
+        "7d071cd57047d5489ac0b5b4ae5c4115a302f46ae45ab8cc"
+        "56d7e076a88e65b0c0a170d885d1f5ea8bd087af06ea3da0"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 111, 112, 119 and 120
+    // bytes: from 112 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        sha2_384_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            sha2_384_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        sha2_384_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 48; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_512_chunked()
+{
+    struct sha2_512 m;
+    char buffer[1000];
+    size_t sizes[6] = { 1, 63, 64, 65, 200, 1000 };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Odd chunk sizes exercise the partial-block, whole-block and tail paths
+    // of sha2_512_update.
+    memset(buffer, 'a', sizeof(buffer));
+    sha2_512_init(&m);
+    for (int i = 0; done < 1000000; i++) {
+        chunk = sizes[i % 6];
+        if (chunk > 1000000 - done) {
+            chunk = 1000000 - done;
+        }
+
+        sha2_512_update(&m, buffer, chunk);
+        done += chunk;
+    }
+    sha2_512_finalize(&m);
+
+    printf("Message:  \"a\"*1000000 in chunks\nExpected: e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973ebde0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b\nResult:   ");
+
+    for (int i = 0; i < 64; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_512_chunked_padding()
+{
+    struct sha2_512 m;
+    char buffer[504];
+    size_t lengths[4] = { 495, 496, 503, 504 };
+    size_t sizes[3] = { 1, 127, 129 };
+    const char* expected[4] = {
+        "b7e7a9f7c01422651128f480068a40d3e6a2d3c1279a317226e37559eeb9c061"
+        "db6df8ba8530bd31d4fec22a3d60f0fdfe7b22ba0d9b7ecebaa0c92c545a9472",
+        "d2548013be573e7a1e2869f6bae13f3cced6f7388a4d36f9719a5688848f3fee"
+        "89f705dfdd334482bb077ff8a74e08d601c672271ade84b8e35d626a45b2d015",
+        "195395ce601ac6e97799030b5b89decdde0a9ee7beea9f94c1ea8177a5ca2a2a"
+        "8c2e9dbbde12d82389f1077a5ee6744a0c1726c5a554e6a1e36781cb87829e20",
+        "e17e45a5bab1fcb054e453a6c70e2d6f64aa95e5cad41a2268e63b646cb237c4"
+        "c2759b94b5b74b8cd7487bfb2a7781f8596182943b4cca4c8a3fca530cce1461"
+    };
+    size_t done = 0;
+    size_t chunk = 0;
+
+    // Three whole blocks and a final partial block of 111, 112, 119 and 120
+    // bytes: from 112 bytes on, the padding spills into one more block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int j = 0; j < 4; j++) {
+        sha2_512_init(&m);
+        done = 0;
+        for (int i = 0; done < lengths[j]; i++) {
+            chunk = sizes[i % 3];
+            if (chunk > lengths[j] - done) {
+                chunk = lengths[j] - done;
+            }
+
+            sha2_512_update(&m, buffer + done, chunk);
+            done += chunk;
+        }
+        sha2_512_finalize(&m);
+
+        printf("Message:  \"a\"*%zu in chunks\nExpected: %s\nResult:   ",
+               lengths[j], expected[j]);
+
+        for (int i = 0; i < 64; i ++) {
+            printf("%02x", m.digest[i]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_256_shani()
+{
+    static uint8_t data[64 * 37];
+    struct sha2_256 portable;
+    struct sha2_256 shani;
+
+    printf("SHA extensions supported: %d\n", sha2_256_shani_supported());
+
+    for (int i = 0; i < 64 * 37; i++) {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    sha2_256_init(&portable);
+    sha2_256_portable_core_blocks(portable.h, data, 37);
+    printf("Expected: ");
+    for (int i = 0; i < 8; i++) {
+        printf("%08x", portable.h[i]);
+    }
+    printf("\n");
+
+#ifdef CC_SHA2_256_SHANI
+    if (sha2_256_shani_supported()) {
+        sha2_256_init(&shani);
+        sha2_256_shani_core_blocks(shani.h, data, 37);
+        printf("Result:   ");
+        for (int i = 0; i < 8; i++) {
+            printf("%08x", shani.h[i]);
+        }
+        printf("\n");
+    }
+#endif
+
+    printf("\n");
+}
+
+void benchmark_sha2_256_shani()
+{
+    static uint8_t data[1048576];
+    struct sha2_256 m;
+    clock_t start;
+
+    sha2_256_init(&m);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha2_256_portable_core_blocks(m.h, data, sizeof(data) / 64);
+    }
+    printf("Benchmark: 64MB sha2_256_portable_core_blocks: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+#ifdef CC_SHA2_256_SHANI
+    if (sha2_256_shani_supported()) {
+        start = clock();
+        for (int i = 0; i < 64; i++) {
+            sha2_256_shani_core_blocks(m.h, data, sizeof(data) / 64);
+        }
+        printf("Benchmark: 64MB sha2_256_shani_core_blocks: %f seconds\n",
+               (double) (clock() - start) / CLOCKS_PER_SEC);
+    }
+#endif
+}
+
+void test_sha2_224_shani()
+{
+    static uint8_t data[64 * 37];
+    struct sha2_224 portable;
+    struct sha2_224 shani;
+
+    printf("SHA extensions supported: %d\n", sha2_256_shani_supported());
+
+    for (int i = 0; i < 64 * 37; i++) {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    sha2_224_init(&portable);
+    sha2_224_portable_core_blocks(portable.h, data, 37);
+    printf("Expected: ");
+    for (int i = 0; i < 8; i++) {
+        printf("%08x", portable.h[i]);
+    }
+    printf("\n");
+
+#ifdef CC_SHA2_256_SHANI
+    if (sha2_256_shani_supported()) {
+        sha2_224_init(&shani);
+        sha2_256_shani_core_blocks(shani.h, data, 37);
+        printf("Result:   ");
+        for (int i = 0; i < 8; i++) {
+            printf("%08x", shani.h[i]);
+        }
+        printf("\n");
+    }
+#endif
+
+    printf("\n");
+}
+
+void benchmark_sha2_224_shani()
+{
+    static uint8_t data[1048576];
+    struct sha2_224 m;
+    clock_t start;
+
+    sha2_224_init(&m);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha2_224_portable_core_blocks(m.h, data, sizeof(data) / 64);
+    }
+    printf("Benchmark: 64MB sha2_224_portable_core_blocks: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+#ifdef CC_SHA2_256_SHANI
+    if (sha2_256_shani_supported()) {
+        start = clock();
+        for (int i = 0; i < 64; i++) {
+            sha2_256_shani_core_blocks(m.h, data, sizeof(data) / 64);
+        }
+        printf("Benchmark: 64MB sha2_256_shani_core_blocks: %f seconds\n",
+               (double) (clock() - start) / CLOCKS_PER_SEC);
+    }
+#endif
+}
+
+void test_sha2_256_avx2()
+{
+    static uint8_t data[4096 + 19];
+    const size_t sizes[19] = { 43, 0, 1, 55, 56, 57, 63, 64, 65, 119, 120,
+                               127, 128, 129, 200, 1000, 1001, 4000, 4096
+                             };
+    const uint8_t* msg[19];
+    size_t len[19];
+    uint8_t digests[19 * 32];
+    struct sha2_256 m;
+    size_t matches = 0;
+
+    printf("AVX2 supported: %d\n", sha2_256_avx2_supported());
+
+    for (int i = 0; i < 4096 + 19; i++) {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    msg[0] = (const uint8_t*) "The quick brown fox jumps over the lazy dog";
+    len[0] = sizes[0];
+    for (int i = 1; i < 19; i++) {
+        msg[i] = data + i;
+        len[i] = sizes[i];
+    }
+
+    sha2_256_avx2_batch(msg, len, digests, 19);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog\nExpected: d7a8fbb307d7809469ca9abcb0082e4f8d5651e46d3cdb762d02d0bf37c9e592\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", digests[i]);
+    }
+
+    printf("\n");
+
+    for (int i = 0; i < 19; i++) {
+        sha2_256_init(&m);
+        sha2_256_update(&m, (char*) msg[i], len[i]);
+        sha2_256_finalize(&m);
+        matches += memcmp(m.digest, digests + 32 * i, 32) == 0;
+    }
+
+    printf("AVX2 batch Actual:   %zu digests match\n", matches);
+    printf("AVX2 batch Expected: 19 digests match\n\n");
+}
+
+void benchmark_sha2_256_avx2()
+{
+    static uint8_t data[4096 * 1024];
+    static uint8_t digests[4096 * 32];
+    const uint8_t* msg[4096];
+    size_t len[4096];
+    struct sha2_256 m;
+    clock_t start;
+
+    for (int i = 0; i < 4096; i++) {
+        msg[i] = data + 1024 * i;
+        len[i] = 1024;
+    }
+
+    start = clock();
+    for (int i = 0; i < 4096; i++) {
+        sha2_256_init(&m);
+        sha2_256_portable_core_blocks(m.h, msg[i], len[i] / 64);
+    }
+    printf("Benchmark: 4096 x 1KB sha2_256_portable_core_blocks: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    sha2_256_avx2_batch(msg, len, digests, 4096);
+    printf("Benchmark: 4096 x 1KB sha2_256_avx2_batch: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+void test_sha2_512_avx2()
+{
+    static uint8_t data[128 * 37];
+    struct sha2_512 portable;
+    struct sha2_512 avx2;
+
+    printf("AVX2 supported: %d\n", sha2_512_avx2_supported());
+
+    for (int i = 0; i < 128 * 37; i++) {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    sha2_512_init(&portable);
+    sha2_512_portable_core_blocks(portable.h, data, 37);
+    printf("Expected: ");
+    for (int i = 0; i < 8; i++) {
+        printf("%016llx", (unsigned long long) portable.h[i]);
+    }
+    printf("\n");
+
+#ifdef CC_SHA2_512_AVX2
+    if (sha2_512_avx2_supported()) {
+        sha2_512_init(&avx2);
+        sha2_512_avx2_core_blocks(avx2.h, data, 37);
+        printf("Result:   ");
+        for (int i = 0; i < 8; i++) {
+            printf("%016llx", (unsigned long long) avx2.h[i]);
+        }
+        printf("\n");
+    }
+#endif
+
+    printf("\n");
+}
+
+void benchmark_sha2_512_avx2()
+{
+    static uint8_t data[1048576];
+    struct sha2_512 m;
+    clock_t start;
+
+    sha2_512_init(&m);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha2_512_portable_core_blocks(m.h, data, sizeof(data) / 128);
+    }
+    printf("Benchmark: 64MB sha2_512_portable_core_blocks: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+#ifdef CC_SHA2_512_AVX2
+    if (sha2_512_avx2_supported()) {
+        start = clock();
+        for (int i = 0; i < 64; i++) {
+            sha2_512_avx2_core_blocks(m.h, data, sizeof(data) / 128);
+        }
+        printf("Benchmark: 64MB sha2_512_avx2_core_blocks: %f seconds\n",
+               (double) (clock() - start) / CLOCKS_PER_SEC);
+    }
+#endif
+}
+
+void test_sha2_384_padding()
+{
+    struct sha2_384 m;
+    char buffer[120];
+    size_t sizes[4] = { 111, 112, 119, 120 };
+    const char* expected[4] = {
+        "3c37955051cb5c3026f94d551d5b5e2ac38d572ae4e07172085fed81f8466b8f"
+        "90dc23a8ffcdea0b8d8e58e8fdacc80a",
+        "187d4e07cb306103c69967bf544d0dfbe9042577599c73c330abc0cb64c61236"
+        "d5ed565ee19119d8c31779a38f791fcd",
+        "c2fbb1911d6889e3db556b482236ab82f3c736f00a22c088641a09fdbbca27e3"
+        "f1e3b6235bad20aee1ca083c76ac590c",
+        "ca2f7755efa04d43651f9bcb466044511102e472c2a3981c836b487ee4508ca8"
+        "461f8c396653123400762de4d6d17e63"
+    };
+
+    // From 112 bytes on, the 0x80 byte and the 16-byte length field no
+    // longer fit in the last block, so padding spills into a second one.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int i = 0; i < 4; i++) {
+        sha2_384_init(&m);
+        sha2_384_update(&m, buffer, sizes[i]);
+        sha2_384_finalize(&m);
+
+        printf("Message:  \"a\"*%zu\nExpected: %s\nResult:   ", sizes[i],
+               expected[i]);
+
+        for (int j = 0; j < 48; j ++) {
+            printf("%02x", m.digest[j]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_512_padding()
+{
+    struct sha2_512 m;
+    char buffer[120];
+    size_t sizes[4] = { 111, 112, 119, 120 };
+    const char* expected[4] = {
+        "fa9121c7b32b9e01733d034cfc78cbf67f926c7ed83e82200ef8681819692176"
+        "0b4beff48404df811b953828274461673c68d04e297b0eb7b2b4d60fc6b566a2",
+        "c01d080efd492776a1c43bd23dd99d0a2e626d481e16782e75d54c2503b5dc32"
+        "bd05f0f1ba33e568b88fd2d970929b719ecbb152f58f130a407c8830604b70ca",
+        "130396a75cb483f2eee8c56d8a668bb3d2641f5243212c0bee2bd33da096ad9e"
+        "b8179fe18f9eaacf76e09fae9de4c3f14ba13341e345be05bf76c182cc3468cb",
+        "f241de612b01aa2fa3cf01531d2a8e5e17fc761dfd48a704a834a47f57d6eade"
+        "7804ecc39be42fdef16ec6adeaf7c01c2fd0c4cc97d3860907cfa4a3b36d0c05"
+    };
+
+    // From 112 bytes on, the 0x80 byte and the 16-byte length field no
+    // longer fit in the last block, so padding spills into a second one.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int i = 0; i < 4; i++) {
+        sha2_512_init(&m);
+        sha2_512_update(&m, buffer, sizes[i]);
+        sha2_512_finalize(&m);
+
+        printf("Message:  \"a\"*%zu\nExpected: %s\nResult:   ", sizes[i],
+               expected[i]);
+
+        for (int j = 0; j < 64; j ++) {
+            printf("%02x", m.digest[j]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_512_224_null()
+{
+    struct sha2_512_224 m;
+    sha2_512_224_init(&m);
+    sha2_512_224_update(&m, "", 0);
+    sha2_512_224_finalize(&m);
+
+    printf("Message:  <null>\nExpected: 6ed0dd02806fa89e25de060c19d3ac86cabb87d6a0ddd05c333b84f4\nResult:   ");
+
+    for (int i = 0; i < 28; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_512_224_foxdog()
+{
+    struct sha2_512_224 m;
+    sha2_512_224_init(&m);
+    sha2_512_224_update(&m, "The quick brown fox jumps over the lazy dog", 43);
+    sha2_512_224_finalize(&m);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog\nExpected: 944cd2847fb54558d4775db0485a50003111c8e5daa63fe722c6aa37\nResult:   ");
+
+    for (int i = 0; i < 28; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_512_224_foxcog()
+{
+    struct sha2_512_224 m;
+    sha2_512_224_init(&m);
+    sha2_512_224_update(&m, "The quick brown fox jumps over the lazy cog", 43);
+    sha2_512_224_finalize(&m);
+
+    printf("Message:  The quick brown fox jumps over the lazy cog\nExpected: 2b9d6565a7e40f780ba8ab7c8dcf41e3ed3b77997f4c55aa987eede5\nResult:   ");
+
+    for (int i = 0; i < 28; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_512_256_null()
+{
+    struct sha2_512_256 m;
+    sha2_512_256_init(&m);
+    sha2_512_256_update(&m, "", 0);
+    sha2_512_256_finalize(&m);
+
+    printf("Message:  <null>\nExpected: c672b8d1ef56ed28ab87c3622c5114069bdd3ad7b8f9737498d0c01ecef0967a\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_512_256_foxdog()
+{
+    struct sha2_512_256 m;
+    sha2_512_256_init(&m);
+    sha2_512_256_update(&m, "The quick brown fox jumps over the lazy dog", 43);
+    sha2_512_256_finalize(&m);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog\nExpected: dd9d67b371519c339ed8dbd25af90e976a1eeefd4ad3d889005e532fc5bef04d\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void test_sha2_512_256_foxcog()
+{
+    struct sha2_512_256 m;
+    sha2_512_256_init(&m);
+    sha2_512_256_update(&m, "The quick brown fox jumps over the lazy cog", 43);
+    sha2_512_256_finalize(&m);
+
+    printf("Message:  The quick brown fox jumps over the lazy cog\nExpected: cc8d255a7f2f38fd50388fd1f65ea7910835c5c1e73da46fba01ea50d5dd76fb\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", m.digest[i]);
+    }
+
+    printf("\n\n");
+}
+
+void benchmark_sha2_512_256()
+{
+    static char data[1048576];
+    struct sha2_256 m256;
+    struct sha2_512 m512;
+    struct sha2_512_256 m512_256;
+    clock_t start;
+
+    sha2_256_init(&m256);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha2_256_update(&m256, data, sizeof(data));
+    }
+    sha2_256_finalize(&m256);
+    printf("Benchmark: 64MB sha2_256: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    sha2_512_init(&m512);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha2_512_update(&m512, data, sizeof(data));
+    }
+    sha2_512_finalize(&m512);
+    printf("Benchmark: 64MB sha2_512: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    sha2_512_256_init(&m512_256);
+    start = clock();
+    for (int i = 0; i < 64; i++) {
+        sha2_512_256_update(&m512_256, data, sizeof(data));
+    }
+    sha2_512_256_finalize(&m512_256);
+    printf("Benchmark: 64MB sha2_512_256: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+void test_sha2_512_224_padding()
+{
+    struct sha2_512_224 m;
+    char buffer[120];
+    size_t sizes[4] = { 111, 112, 119, 120 };
+    const char* expected[4] = {
+        "3ebe1b48e8c66acb9ae014db95b4bec93de7e9572bff41cf566bd7d0",
+        "79b41fef2a0439d2705724a67615f7bcbcd2bf5664a7774b80818eb6",
+        "3faf8c370047a31f89bd959c5af5a2328928fb13823f15826ce8c225",
+        "724c823bb25a39b9c905e5f32228abd3c8561c1889e13745dc4bc438"
+    };
+
+    // The last two lengths leave no room for the length field after the
+    // 0x80 byte, so padding spills into a second block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int i = 0; i < 4; i++) {
+        sha2_512_224_init(&m);
+        sha2_512_224_update(&m, buffer, sizes[i]);
+        sha2_512_224_finalize(&m);
+
+        printf("Message:  \"a\"*%zu\nExpected: %s\nResult:   ", sizes[i],
+               expected[i]);
+
+        for (int j = 0; j < 28; j ++) {
+            printf("%02x", m.digest[j]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_512_256_padding()
+{
+    struct sha2_512_256 m;
+    char buffer[120];
+    size_t sizes[4] = { 111, 112, 119, 120 };
+    const char* expected[4] = {
+        "0239e429f98d0ed61ee8e2a7c30afe98c1c3a80ce5dff62a107e9c538f7632ce",
+        "9216b5303edb66504570bee90e48ea5beaa5e9fe9f760bbd3e0460559fc005f6",
+        "6cb452f832033489de69b49d6a8e8a1e0018092f1986c132287f4ca4ab3ee545",
+        "2e6ca4d879d367d7708701ed2e448540d04a6b8fcd2b0806278cf36090b9ba2b"
+    };
+
+    // The last two lengths leave no room for the length field after the
+    // 0x80 byte, so padding spills into a second block.
+    memset(buffer, 'a', sizeof(buffer));
+    for (int i = 0; i < 4; i++) {
+        sha2_512_256_init(&m);
+        sha2_512_256_update(&m, buffer, sizes[i]);
+        sha2_512_256_finalize(&m);
+
+        printf("Message:  \"a\"*%zu\nExpected: %s\nResult:   ", sizes[i],
+               expected[i]);
+
+        for (int j = 0; j < 32; j ++) {
+            printf("%02x", m.digest[j]);
+        }
+
+        printf("\n\n");
+    }
+}
+
+void test_sha2_256_export()
+{
+    char msg[] = "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog";
+    uint8_t state[SHA2_256_STATE_SIZE];
+    struct sha2_256 m;
+    struct sha2_256 resumed;
+    const struct sha2_256* frozen = &m;
+
+    // Checkpoint mid-message through a const pointer and resume in a
+    // separate struct.
+    sha2_256_init(&m);
+    sha2_256_update(&m, msg, 86);
+    sha2_256_export(frozen, state);
+
+    memset(&resumed, 0xff, sizeof(resumed));
+    printf("Message:  import of sha2_256_export\nExpected: 1\nResult:   %d\n\n",
+           sha2_256_import(&resumed, state, sizeof(state)));
+
+    sha2_256_update(&resumed, msg + 86, 43);
+    sha2_256_finalize(&resumed);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog (x3), resumed\nExpected: 5cfa2bf023f22ac82b00cd883ea96852677ff2ecd777f656146bd22004eb75f2\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", resumed.digest[i]);
+    }
+
+    printf("\n\n");
+
+    // A state of another algorithm is rejected.
+    struct sha2_224 other;
+    printf("Message:  import of sha2_256 state as sha2_224\nExpected: 0\nResult:   %d\n\n",
+           sha2_224_import(&other, state, sizeof(state)));
+}
+
+void test_sha2_512_export()
+{
+    char msg[] = "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog";
+    uint8_t state[SHA2_512_STATE_SIZE];
+    struct sha2_512 m;
+    struct sha2_512 resumed;
+    const struct sha2_512* frozen = &m;
+
+    // Checkpoint mid-message through a const pointer and resume in a
+    // separate struct.
+    sha2_512_init(&m);
+    sha2_512_update(&m, msg, 86);
+    sha2_512_export(frozen, state);
+
+    memset(&resumed, 0xff, sizeof(resumed));
+    printf("Message:  import of sha2_512_export\nExpected: 1\nResult:   %d\n\n",
+           sha2_512_import(&resumed, state, sizeof(state)));
+
+    sha2_512_update(&resumed, msg + 86, 43);
+    sha2_512_finalize(&resumed);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog (x3), resumed\nExpected: 8bbc0670dc3e29c7341035e6110968c878dca505248f09b3380899ed9b3a1aec19282f1d2de75d6c6acc1d3e0b63be33c0c5a731ac00f7d29c02e31c2846cfde\nResult:   ");
+
+    for (int i = 0; i < 64; i ++) {
+        printf("%02x", resumed.digest[i]);
+    }
+
+    printf("\n\n");
+
+    // A state from another version is rejected.
+    state[2]++;
+    printf("Message:  import of another version\nExpected: 0\nResult:   %d\n\n",
+           sha2_512_import(&resumed, state, sizeof(state)));
+}
+
+void test_sha2_512_256_export()
+{
+    char msg[] = "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog"
+                 "The quick brown fox jumps over the lazy dog";
+    uint8_t state[SHA2_512_256_STATE_SIZE];
+    struct sha2_512_256 m;
+    struct sha2_512_256 resumed;
+    const struct sha2_512_256* frozen = &m;
+
+    // Checkpoint mid-message through a const pointer and resume in a
+    // separate struct.
+    sha2_512_256_init(&m);
+    sha2_512_256_update(&m, msg, 86);
+    sha2_512_256_export(frozen, state);
+
+    memset(&resumed, 0xff, sizeof(resumed));
+    printf("Message:  import of sha2_512_256_export\nExpected: 1\nResult:   %d\n\n",
+           sha2_512_256_import(&resumed, state, sizeof(state)));
+
+    sha2_512_256_update(&resumed, msg + 86, 43);
+    sha2_512_256_finalize(&resumed);
+
+    printf("Message:  The quick brown fox jumps over the lazy dog (x3), resumed\nExpected: 35591989d960896a3d36207256da463aa85aeca2401def10f9c190bcba8fc187\nResult:   ");
+
+    for (int i = 0; i < 32; i ++) {
+        printf("%02x", resumed.digest[i]);
+    }
+
+    printf("\n\n");
+
+    // A state of another algorithm is rejected.
+    struct sha2_512_224 other;
+    printf("Message:  import of sha2_512_256 state as sha2_512_224\nExpected: 0\nResult:   %d\n\n",
+           sha2_512_224_import(&other, state, sizeof(state)));
+}
+
 int main()
 {
     printf("\nSHA224\n");
@@ -224,4 +1168,39 @@ int main()
     test_sha2_512_null();
     test_sha2_512_foxdog();
     test_sha2_512_foxcog();
+
+    printf("\nSHA512/224\n");
+    test_sha2_512_224_null();
+    test_sha2_512_224_foxdog();
+    test_sha2_512_224_foxcog();
+
+    printf("\nSHA512/256\n");
+    test_sha2_512_256_null();
+    test_sha2_512_256_foxdog();
+    test_sha2_512_256_foxcog();
+
+    test_sha2_224_chunked();
+    test_sha2_224_chunked_padding();
+    test_sha2_256_chunked();
+    test_sha2_256_chunked_padding();
+    test_sha2_384_chunked();
+    test_sha2_384_chunked_padding();
+    test_sha2_512_chunked();
+    test_sha2_512_chunked_padding();
+    test_sha2_384_padding();
+    test_sha2_512_padding();
+    test_sha2_512_224_padding();
+    test_sha2_512_256_padding();
+    test_sha2_256_export();
+    test_sha2_512_export();
+    test_sha2_512_256_export();
+    test_sha2_256_shani();
+    test_sha2_224_shani();
+    benchmark_sha2_256_shani();
+    benchmark_sha2_224_shani();
+    test_sha2_256_avx2();
+    benchmark_sha2_256_avx2();
+    test_sha2_512_avx2();
+    benchmark_sha2_512_avx2();
+    benchmark_sha2_512_256();
 }
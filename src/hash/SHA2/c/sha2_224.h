@@ -27,6 +27,11 @@
 
 #include "stdint.h"
 #include "string.h"
+#include "sha2_256_shani.h"
+
+#define SHA2_224_STATE_VERSION 1
+#define SHA2_224_STATE_ID 3
+#define SHA2_224_STATE_SIZE 109
 
 /*
  * struct sha2_224
@@ -161,10 +166,41 @@ extern inline uint32_t sha2_224_ssig1(uint32_t x)
 }
 
 /*
- * sha2_224 sha2_224_core
+ * sha2_224 sha2_224_schedule
+ *
+ * Computes W(t) for t >= 16 into the 16-word circular buffer w, where it
+ * replaces W(t-16), and returns it.
+*/
+extern inline uint32_t sha2_224_schedule(uint32_t* w, size_t t)
+{
+    w[t & 15] += sha2_224_ssig1(w[(t - 2) & 15]) + w[(t - 7) & 15] +
+                 sha2_224_ssig0(w[(t - 15) & 15]);
+    return w[t & 15];
+}
+
+/*
+ * sha2_224 sha2_224_round
+ *
+ * One round of the main hash computation with kw = Kt + Wt. The caller
+ * renames the working variables instead of shifting them, so only d and h
+ * are written: d becomes the next e and h the next a.
+*/
+extern inline void sha2_224_round(uint32_t a, uint32_t b, uint32_t c,
+                                  uint32_t* d, uint32_t e, uint32_t f,
+                                  uint32_t g, uint32_t* h, uint32_t kw)
+{
+    uint32_t tmp1 = *h + sha2_224_bsig1(e) + (g ^ (e & (f ^ g))) + kw;
+    uint32_t tmp2 = sha2_224_bsig0(a) + ((a & b) | (c & (a | b)));
+
+    *d += tmp1;
+    *h = tmp1 + tmp2;
+}
+
+/*
+ * sha2_224 sha2_224_portable_core_blocks
  *
- * Core of sha2_224 hash function; operates on a single round from m->partial
- * and updates hash state in m->s.
+ * Portable core of sha2_224 hash function; operates on nblocks consecutive
+ * 64-byte blocks at data and updates the hash state in state.
  *
  * SHA-224 and SHA-256 perform identical processing on messages blocks
  * and differ only in how H(0) is initialized and how they produce their
@@ -233,14 +269,24 @@ extern inline uint32_t sha2_224_ssig1(uint32_t x)
  * SHA-256, this is the concatenation of all of H(N)0, H(N)1, through
  * H(N)7.  For SHA-224, this is the concatenation of H(N)0, H(N)1,
  * through H(N)6.
+ *
+ * Here the 64 rounds are written out in full with a to h renamed from
+ * round to round rather than shifted, and W is kept in a 16-word
+ * circular buffer (see sha2_224_schedule).
 */
-extern inline void sha2_224_core(struct sha2_224* m)
+extern inline void sha2_224_portable_core_blocks(uint32_t* state,
+        const uint8_t* data, size_t nblocks)
 {
     size_t t = 0;
-    uint32_t w[64];
-    uint32_t h[8];
-    uint32_t tmp1;
-    uint32_t tmp2;
+    uint32_t w[16];
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+    uint32_t e;
+    uint32_t f;
+    uint32_t g;
+    uint32_t h;
 
     /*
      * SHA-224 and SHA-256 use the same sequence of sixty-four constant
@@ -278,55 +324,184 @@ extern inline void sha2_224_core(struct sha2_224* m)
         0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
         0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
     };
+    size_t block = 0;
+
+    for (block = 0; block < nblocks; block++) {
+        // Message has to be processed as a big endian integer
+        for (t = 0; t < 16; t++) {
+            w[t] = ((uint32_t) data[t * 4 + 0] << 24) |
+                   ((uint32_t) data[t * 4 + 1] << 16) |
+                   ((uint32_t) data[t * 4 + 2] << 8) |
+                   ((uint32_t) data[t * 4 + 3] << 0);
+        }
 
-    // Message has to be processed as a big endian integer
-    for (t = 0; t < 16; t++) {
-        w[t] = (((
-                     uint32_t) m->partial[t * 4 + 0]) << 24) | (((
-                                 uint32_t) m->partial[t * 4 + 1]) << 16) | (((
-                                             uint32_t) m->partial[t * 4 + 2]) << 8) | (((
-                                                     uint32_t) m->partial[t * 4 + 3]) << 0);
+        // Duplicate state into temporary variables
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        sha2_224_round(a, b, c, &d, e, f, g, &h, K[0] + w[0]);
+        sha2_224_round(h, a, b, &c, d, e, f, &g, K[1] + w[1]);
+        sha2_224_round(g, h, a, &b, c, d, e, &f, K[2] + w[2]);
+        sha2_224_round(f, g, h, &a, b, c, d, &e, K[3] + w[3]);
+        sha2_224_round(e, f, g, &h, a, b, c, &d, K[4] + w[4]);
+        sha2_224_round(d, e, f, &g, h, a, b, &c, K[5] + w[5]);
+        sha2_224_round(c, d, e, &f, g, h, a, &b, K[6] + w[6]);
+        sha2_224_round(b, c, d, &e, f, g, h, &a, K[7] + w[7]);
+        sha2_224_round(a, b, c, &d, e, f, g, &h, K[8] + w[8]);
+        sha2_224_round(h, a, b, &c, d, e, f, &g, K[9] + w[9]);
+        sha2_224_round(g, h, a, &b, c, d, e, &f, K[10] + w[10]);
+        sha2_224_round(f, g, h, &a, b, c, d, &e, K[11] + w[11]);
+        sha2_224_round(e, f, g, &h, a, b, c, &d, K[12] + w[12]);
+        sha2_224_round(d, e, f, &g, h, a, b, &c, K[13] + w[13]);
+        sha2_224_round(c, d, e, &f, g, h, a, &b, K[14] + w[14]);
+        sha2_224_round(b, c, d, &e, f, g, h, &a, K[15] + w[15]);
+
+        // W(16) onwards are computed as they are used.
+        sha2_224_round(a, b, c, &d, e, f, g, &h,
+                       K[16] + sha2_224_schedule(w, 16));
+        sha2_224_round(h, a, b, &c, d, e, f, &g,
+                       K[17] + sha2_224_schedule(w, 17));
+        sha2_224_round(g, h, a, &b, c, d, e, &f,
+                       K[18] + sha2_224_schedule(w, 18));
+        sha2_224_round(f, g, h, &a, b, c, d, &e,
+                       K[19] + sha2_224_schedule(w, 19));
+        sha2_224_round(e, f, g, &h, a, b, c, &d,
+                       K[20] + sha2_224_schedule(w, 20));
+        sha2_224_round(d, e, f, &g, h, a, b, &c,
+                       K[21] + sha2_224_schedule(w, 21));
+        sha2_224_round(c, d, e, &f, g, h, a, &b,
+                       K[22] + sha2_224_schedule(w, 22));
+        sha2_224_round(b, c, d, &e, f, g, h, &a,
+                       K[23] + sha2_224_schedule(w, 23));
+        sha2_224_round(a, b, c, &d, e, f, g, &h,
+                       K[24] + sha2_224_schedule(w, 24));
+        sha2_224_round(h, a, b, &c, d, e, f, &g,
+                       K[25] + sha2_224_schedule(w, 25));
+        sha2_224_round(g, h, a, &b, c, d, e, &f,
+                       K[26] + sha2_224_schedule(w, 26));
+        sha2_224_round(f, g, h, &a, b, c, d, &e,
+                       K[27] + sha2_224_schedule(w, 27));
+        sha2_224_round(e, f, g, &h, a, b, c, &d,
+                       K[28] + sha2_224_schedule(w, 28));
+        sha2_224_round(d, e, f, &g, h, a, b, &c,
+                       K[29] + sha2_224_schedule(w, 29));
+        sha2_224_round(c, d, e, &f, g, h, a, &b,
+                       K[30] + sha2_224_schedule(w, 30));
+        sha2_224_round(b, c, d, &e, f, g, h, &a,
+                       K[31] + sha2_224_schedule(w, 31));
+        sha2_224_round(a, b, c, &d, e, f, g, &h,
+                       K[32] + sha2_224_schedule(w, 32));
+        sha2_224_round(h, a, b, &c, d, e, f, &g,
+                       K[33] + sha2_224_schedule(w, 33));
+        sha2_224_round(g, h, a, &b, c, d, e, &f,
+                       K[34] + sha2_224_schedule(w, 34));
+        sha2_224_round(f, g, h, &a, b, c, d, &e,
+                       K[35] + sha2_224_schedule(w, 35));
+        sha2_224_round(e, f, g, &h, a, b, c, &d,
+                       K[36] + sha2_224_schedule(w, 36));
+        sha2_224_round(d, e, f, &g, h, a, b, &c,
+                       K[37] + sha2_224_schedule(w, 37));
+        sha2_224_round(c, d, e, &f, g, h, a, &b,
+                       K[38] + sha2_224_schedule(w, 38));
+        sha2_224_round(b, c, d, &e, f, g, h, &a,
+                       K[39] + sha2_224_schedule(w, 39));
+        sha2_224_round(a, b, c, &d, e, f, g, &h,
+                       K[40] + sha2_224_schedule(w, 40));
+        sha2_224_round(h, a, b, &c, d, e, f, &g,
+                       K[41] + sha2_224_schedule(w, 41));
+        sha2_224_round(g, h, a, &b, c, d, e, &f,
+                       K[42] + sha2_224_schedule(w, 42));
+        sha2_224_round(f, g, h, &a, b, c, d, &e,
+                       K[43] + sha2_224_schedule(w, 43));
+        sha2_224_round(e, f, g, &h, a, b, c, &d,
+                       K[44] + sha2_224_schedule(w, 44));
+        sha2_224_round(d, e, f, &g, h, a, b, &c,
+                       K[45] + sha2_224_schedule(w, 45));
+        sha2_224_round(c, d, e, &f, g, h, a, &b,
+                       K[46] + sha2_224_schedule(w, 46));
+        sha2_224_round(b, c, d, &e, f, g, h, &a,
+                       K[47] + sha2_224_schedule(w, 47));
+        sha2_224_round(a, b, c, &d, e, f, g, &h,
+                       K[48] + sha2_224_schedule(w, 48));
+        sha2_224_round(h, a, b, &c, d, e, f, &g,
+                       K[49] + sha2_224_schedule(w, 49));
+        sha2_224_round(g, h, a, &b, c, d, e, &f,
+                       K[50] + sha2_224_schedule(w, 50));
+        sha2_224_round(f, g, h, &a, b, c, d, &e,
+                       K[51] + sha2_224_schedule(w, 51));
+        sha2_224_round(e, f, g, &h, a, b, c, &d,
+                       K[52] + sha2_224_schedule(w, 52));
+        sha2_224_round(d, e, f, &g, h, a, b, &c,
+                       K[53] + sha2_224_schedule(w, 53));
+        sha2_224_round(c, d, e, &f, g, h, a, &b,
+                       K[54] + sha2_224_schedule(w, 54));
+        sha2_224_round(b, c, d, &e, f, g, h, &a,
+                       K[55] + sha2_224_schedule(w, 55));
+        sha2_224_round(a, b, c, &d, e, f, g, &h,
+                       K[56] + sha2_224_schedule(w, 56));
+        sha2_224_round(h, a, b, &c, d, e, f, &g,
+                       K[57] + sha2_224_schedule(w, 57));
+        sha2_224_round(g, h, a, &b, c, d, e, &f,
+                       K[58] + sha2_224_schedule(w, 58));
+        sha2_224_round(f, g, h, &a, b, c, d, &e,
+                       K[59] + sha2_224_schedule(w, 59));
+        sha2_224_round(e, f, g, &h, a, b, c, &d,
+                       K[60] + sha2_224_schedule(w, 60));
+        sha2_224_round(d, e, f, &g, h, a, b, &c,
+                       K[61] + sha2_224_schedule(w, 61));
+        sha2_224_round(c, d, e, &f, g, h, a, &b,
+                       K[62] + sha2_224_schedule(w, 62));
+        sha2_224_round(b, c, d, &e, f, g, h, &a,
+                       K[63] + sha2_224_schedule(w, 63));
+
+        // Add temporary variables back into state.
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        data += 64;
     }
+}
 
-    for (t = 16; t < 64; t++) {
-        w[t] = sha2_224_ssig1(w[t - 2]) + w[t - 7] + sha2_224_ssig0(
-                   w[t - 15]) + w[t - 16];
+/*
+ * sha2_224 sha2_224_core_blocks
+ *
+ * Hashes nblocks consecutive 64-byte blocks at data into state, with the
+ * SHA extensions when the host has them (sha2_256_shani.h) and with
+ * sha2_224_portable_core_blocks otherwise.
+*/
+extern inline void sha2_224_core_blocks(uint32_t* state, const uint8_t* data,
+                                        size_t nblocks)
+{
+#ifdef CC_SHA2_256_SHANI
+    if (sha2_256_shani_supported()) {
+        sha2_256_shani_core_blocks(state, data, nblocks);
+        return;
     }
+#endif
 
-    // Duplicate state into temporary variables
-    h[0] = m->h[0];
-    h[1] = m->h[1];
-    h[2] = m->h[2];
-    h[3] = m->h[3];
-    h[4] = m->h[4];
-    h[5] = m->h[5];
-    h[6] = m->h[6];
-    h[7] = m->h[7];
-
-    for (t = 0; t < 64; t++) {
-        tmp1 = h[7] + sha2_224_bsig1(h[4]) + sha2_224_ch(h[4], h[5],
-                h[6]) + K[t] + w[t];
-        tmp2 = sha2_224_bsig0(h[0]) + sha2_224_mj(h[0], h[1], h[2]);
-
-        h[7] = h[6];
-        h[6] = h[5];
-        h[5] = h[4];
-        h[4] = h[3] + tmp1;
-        h[3] = h[2];
-        h[2] = h[1];
-        h[1] = h[0];
-        h[0] = tmp1 + tmp2;
-    }
+    sha2_224_portable_core_blocks(state, data, nblocks);
+}
 
-    // Add temporary variables back into state.
-    m->h[0] += h[0];
-    m->h[1] += h[1];
-    m->h[2] += h[2];
-    m->h[3] += h[3];
-    m->h[4] += h[4];
-    m->h[5] += h[5];
-    m->h[6] += h[6];
-    m->h[7] += h[7];
+/*
+ * sha2_224 sha2_224_core
+ *
+ * Runs sha2_224_core_blocks on the buffered block in m->partial.
+*/
+extern inline void sha2_224_core(struct sha2_224* m)
+{
+    sha2_224_core_blocks(m->h, m->partial, 1);
 }
 
 /*
@@ -377,21 +552,41 @@ extern inline void sha2_224_init(struct sha2_224* m)
 extern inline void sha2_224_update(struct sha2_224* m, char* msg,
                                    uint64_t len)
 {
-    size_t i = 0;
+    const uint8_t* data = (const uint8_t*) msg;
+    size_t fill = 0;
+    size_t nblocks = 0;
 
     m->len += len;
-    for (i = 0; i < len; i++) {
-        if (m->p_len == 64) {
-            m->p_len = 0;
 
-            // Once we finish a buffer, call the core sha2_224 function to update
-            // state and recompute the current hash value.
+    // Complete a partially filled block first.
+    if (m->p_len > 0) {
+        fill = 64 - m->p_len;
+        if (fill > len) {
+            fill = (size_t) len;
+        }
+
+        memcpy(m->partial + m->p_len, data, fill);
+        m->p_len += fill;
+        data += fill;
+        len -= fill;
+
+        if (m->p_len == 64) {
             sha2_224_core(m);
+            m->p_len = 0;
         }
+    }
 
-        m->partial[m->p_len] = (uint8_t)((unsigned char) msg[i]);
-        m->p_len += 1;
+    // Whole blocks are hashed directly from the caller's buffer.
+    nblocks = len / 64;
+    if (nblocks > 0) {
+        sha2_224_core_blocks(m->h, data, nblocks);
+        data += nblocks * 64;
+        len -= nblocks * 64;
     }
+
+    // Buffer the tail for the next update or finalize.
+    memcpy(m->partial + m->p_len, data, (size_t) len);
+    m->p_len += (size_t) len;
 }
 
 /*
@@ -499,4 +694,107 @@ extern inline uint8_t* sha2_224_sum(struct sha2_224* m, char* msg)
     return m->digest;
 }
 
+/*
+ * sha2_224 sha2_224_store_be
+ *
+ * Writes the low count bytes of value to out, most significant first.
+*/
+extern inline void sha2_224_store_be(uint8_t* out, uint64_t value,
+                                     size_t count)
+{
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        out[i] = (uint8_t) (value >> (8 * (count - 1 - i)));
+    }
+}
+
+/*
+ * sha2_224 sha2_224_load_be
+ *
+ * Reads count bytes at in as a big endian integer.
+*/
+extern inline uint64_t sha2_224_load_be(const uint8_t* in, size_t count)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+/*
+ * sha2_224 sha2_224_export
+ *
+ * Serializes the in-progress state of m into the SHA2_224_STATE_SIZE bytes at
+ * out, so that hashing can resume later with sha2_224_import, in this process
+ * or another one. The layout is stable for a given SHA2_224_STATE_VERSION,
+ * and all integers are big endian:
+ *
+ *     4 bytes   -- "cc", SHA2_224_STATE_VERSION, SHA2_224_STATE_ID
+ *     32 bytes  -- h[0] through h[7]
+ *     8 bytes   -- len
+ *     1 byte    -- p_len
+ *     64 bytes  -- partial; bytes past p_len are zero
+*/
+extern inline void sha2_224_export(const struct sha2_224* m, uint8_t* out)
+{
+    size_t i = 0;
+
+    memset(out, 0, SHA2_224_STATE_SIZE);
+    out[0] = 'c';
+    out[1] = 'c';
+    out[2] = SHA2_224_STATE_VERSION;
+    out[3] = SHA2_224_STATE_ID;
+
+    for (i = 0; i < 8; i++) {
+        sha2_224_store_be(out + 4 + 4 * i, m->h[i], 4);
+    }
+
+    sha2_224_store_be(out + 36, m->len, 8);
+    out[44] = (uint8_t) m->p_len;
+    memcpy(out + 45, m->partial, m->p_len);
+}
+
+/*
+ * sha2_224 sha2_224_import
+ *
+ * Restores a state written by sha2_224_export into m; sha2_224_update and
+ * sha2_224_finalize then continue as if hashing had never stopped. Returns 1
+ * on success. Returns 0 and leaves m untouched if the len bytes at in are not
+ * a sha2_224 state of this version.
+*/
+extern inline int sha2_224_import(struct sha2_224* m, const uint8_t* in,
+                                  size_t len)
+{
+    size_t i = 0;
+    size_t p_len = 0;
+
+    if (len != SHA2_224_STATE_SIZE || in[0] != 'c' || in[1] != 'c' ||
+            in[2] != SHA2_224_STATE_VERSION || in[3] != SHA2_224_STATE_ID) {
+        return 0;
+    }
+
+    // The partial block always holds the input past the last whole block.
+    p_len = in[44];
+    if (p_len != (size_t) (sha2_224_load_be(in + 36, 8) % 64)) {
+        return 0;
+    }
+
+    memset(m->digest, 0, sizeof(m->digest));
+    for (i = 0; i < 8; i++) {
+        m->h[i] = (uint32_t) sha2_224_load_be(in + 4 + 4 * i, 4);
+    }
+
+    m->len = sha2_224_load_be(in + 36, 8);
+    m->p_len = p_len;
+    memset(m->partial, 0, sizeof(m->partial));
+    memcpy(m->partial, in + 45, p_len);
+
+    return 1;
+}
+
 #endif // CC_sha2_224_H
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Eight-lane AVX2 multi-buffer implementation of the sha2_256 hash
+ * algorithm, for hashing many independent messages at once.
+ *
+ * Each 256-bit register holds one state word (or message word) of eight
+ * independent messages, so one pass of the 64 rounds advances eight hashes
+ * by a block each. Messages of different lengths share a pass until the
+ * shorter ones run out of blocks: a lane with nothing left to hash is masked
+ * and keeps its state. Once fewer than SHA2_256_AVX2_MIN_LANES lanes are
+ * still busy, the rest of each message is finished with the scalar
+ * sha2_256_core_blocks instead.
+ *
+ * Usage:
+ *
+ *     const uint8_t* msg[3] = { a, b, c };
+ *     size_t len[3] = { a_len, b_len, c_len };
+ *     uint8_t digests[3 * 32];
+ *     sha2_256_avx2_batch(msg, len, digests, 3);
+ *     // digests + 32 * i holds the sha2_256 digest of msg[i]
+ *
+ * sha2_256_avx2_batch can be called on any host; without AVX2 every message
+ * goes through sha2_256_core_blocks. CC_SHA2_256_AVX2 is defined when the
+ * AVX2 path is built (x86 with GCC or Clang).
+*/
+
+#pragma once
+#ifndef CC_SHA2_256_AVX2_H
+#define CC_SHA2_256_AVX2_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sha2_256.h"
+
+#define SHA2_256_AVX2_MIN_LANES 4
+
+/*
+ * struct sha2_256_avx2_lane
+ *
+ * uint32_t h[8]         -- internal; hash state of the message
+ * const uint8_t* data   -- internal; next whole block of the message
+ * size_t blocks         -- internal; whole blocks left at data
+ * uint8_t tail[128]     -- internal; last partial block and padding
+ * const uint8_t* t_data -- internal; next block in tail
+ * size_t t_blocks       -- internal; blocks left at t_data
+*/
+struct sha2_256_avx2_lane {
+    uint32_t h[8];
+
+    const uint8_t* data;
+    size_t blocks;
+
+    uint8_t tail[128];
+    const uint8_t* t_data;
+    size_t t_blocks;
+};
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_lane_init
+ *
+ * Sets up lane to hash the len bytes at msg: the whole blocks are read in
+ * place and the rest, with the sha2_256 padding, is copied into lane->tail.
+*/
+extern inline void sha2_256_avx2_lane_init(struct sha2_256_avx2_lane* lane,
+        const uint8_t* msg, size_t len)
+{
+    struct sha2_256 m;
+    size_t rest = len % 64;
+    uint64_t bits = (uint64_t) len * 8;
+    size_t end = 0;
+    size_t i = 0;
+
+    sha2_256_init(&m);
+    memcpy(lane->h, m.h, sizeof(lane->h));
+
+    lane->data = msg;
+    lane->blocks = len / 64;
+
+    // The 0x80 byte and the 64-bit length need nine bytes after the message.
+    lane->t_blocks = rest < 56 ? 1 : 2;
+    end = lane->t_blocks * 64;
+
+    memset(lane->tail, 0, sizeof(lane->tail));
+    if (rest > 0) {
+        memcpy(lane->tail, msg + len - rest, rest);
+    }
+    lane->tail[rest] = 0x80;
+    for (i = 0; i < 8; i++) {
+        lane->tail[end - 1 - i] = (uint8_t) (bits >> (8 * i));
+    }
+    lane->t_data = lane->tail;
+}
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_lane_next
+ *
+ * Returns the next block of the lane and moves past it, or NULL once the
+ * lane is finished.
+*/
+extern inline const uint8_t* sha2_256_avx2_lane_next(
+    struct sha2_256_avx2_lane* lane)
+{
+    const uint8_t* block = NULL;
+
+    if (lane->blocks > 0) {
+        block = lane->data;
+        lane->data += 64;
+        lane->blocks -= 1;
+    } else if (lane->t_blocks > 0) {
+        block = lane->t_data;
+        lane->t_data += 64;
+        lane->t_blocks -= 1;
+    }
+
+    return block;
+}
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_lane_finish
+ *
+ * Hashes whatever is left of the lane with sha2_256_core_blocks and writes
+ * the big-endian digest to the 32 bytes at digest.
+*/
+extern inline void sha2_256_avx2_lane_finish(struct sha2_256_avx2_lane* lane,
+        uint8_t* digest)
+{
+    size_t i = 0;
+
+    sha2_256_core_blocks(lane->h, lane->data, lane->blocks);
+    sha2_256_core_blocks(lane->h, lane->t_data, lane->t_blocks);
+    lane->blocks = 0;
+    lane->t_blocks = 0;
+
+    for (i = 0; i < 8; i++) {
+        digest[i * 4 + 0] = (uint8_t) (lane->h[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t) (lane->h[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t) (lane->h[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t) (lane->h[i] >> 0);
+    }
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_SHA2_256_AVX2 1
+
+#include "immintrin.h"
+
+const uint32_t sha2_256_avx2_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_transpose
+ *
+ * Transposes the 8x8 matrix of 32-bit words in r, so that word j of row i
+ * becomes word i of row j.
+*/
+__attribute__((target("avx2")))
+extern inline void sha2_256_avx2_transpose(__m256i* r)
+{
+    __m256i t[8];
+    __m256i u[8];
+    size_t i = 0;
+
+    for (i = 0; i < 8; i += 2) {
+        t[i + 0] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+
+    for (i = 0; i < 8; i += 4) {
+        u[i + 0] = _mm256_unpacklo_epi64(t[i + 0], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i + 0], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    for (i = 0; i < 4; i++) {
+        r[i + 0] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_256_avx2_rotr(__m256i x, int count)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, count),
+                           _mm256_slli_epi32(x, 32 - count));
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_256_avx2_bsig0(__m256i x)
+{
+    return _mm256_xor_si256(_mm256_xor_si256(sha2_256_avx2_rotr(x, 2),
+                            sha2_256_avx2_rotr(x, 13)),
+                            sha2_256_avx2_rotr(x, 22));
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_256_avx2_bsig1(__m256i x)
+{
+    return _mm256_xor_si256(_mm256_xor_si256(sha2_256_avx2_rotr(x, 6),
+                            sha2_256_avx2_rotr(x, 11)),
+                            sha2_256_avx2_rotr(x, 25));
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_256_avx2_ssig0(__m256i x)
+{
+    return _mm256_xor_si256(_mm256_xor_si256(sha2_256_avx2_rotr(x, 7),
+                            sha2_256_avx2_rotr(x, 18)),
+                            _mm256_srli_epi32(x, 3));
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_256_avx2_ssig1(__m256i x)
+{
+    return _mm256_xor_si256(_mm256_xor_si256(sha2_256_avx2_rotr(x, 17),
+                            sha2_256_avx2_rotr(x, 19)),
+                            _mm256_srli_epi32(x, 10));
+}
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_compress
+ *
+ * Runs the 64 rounds on one block per lane, blocks[i] for lane i, updating
+ * the transposed state s. Lanes whose word in active is zero keep their
+ * state; their block pointer must still be readable.
+*/
+__attribute__((target("avx2")))
+extern inline void sha2_256_avx2_compress(__m256i* s,
+        const uint8_t** blocks, __m256i active)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11,
+                                          4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i w[16];
+    __m256i h[8];
+    __m256i t1;
+    __m256i t2;
+    size_t i = 0;
+    size_t t = 0;
+
+    // Message has to be processed as a big endian integer; w[t] holds
+    // word t of every lane.
+    for (i = 0; i < 8; i++) {
+        w[i] = _mm256_loadu_si256((const __m256i*) blocks[i]);
+        w[i + 8] = _mm256_loadu_si256((const __m256i*) (blocks[i] + 32));
+    }
+    sha2_256_avx2_transpose(w);
+    sha2_256_avx2_transpose(w + 8);
+    for (t = 0; t < 16; t++) {
+        w[t] = _mm256_shuffle_epi8(w[t], bswap);
+    }
+
+    // Duplicate state into temporary variables
+    for (i = 0; i < 8; i++) {
+        h[i] = s[i];
+    }
+
+    for (t = 0; t < 64; t++) {
+        if (t >= 16) {
+            t1 = sha2_256_avx2_ssig0(w[(t - 15) & 15]);
+            t2 = sha2_256_avx2_ssig1(w[(t - 2) & 15]);
+            t1 = _mm256_add_epi32(t1, w[(t - 7) & 15]);
+            w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], t1), t2);
+        }
+
+        // t1 = h + bsig1(e) + ch(e, f, g) + k[t] + w[t]
+        t1 = _mm256_xor_si256(_mm256_and_si256(h[4], h[5]),
+                              _mm256_andnot_si256(h[4], h[6]));
+        t1 = _mm256_add_epi32(t1, _mm256_add_epi32(h[7],
+                              sha2_256_avx2_bsig1(h[4])));
+        t1 = _mm256_add_epi32(t1, _mm256_add_epi32(w[t & 15],
+                              _mm256_set1_epi32((int) sha2_256_avx2_k[t])));
+
+        // t2 = bsig0(a) + maj(a, b, c)
+        t2 = _mm256_or_si256(_mm256_and_si256(h[0], h[1]),
+                             _mm256_and_si256(h[2], _mm256_or_si256(h[0],
+                                              h[1])));
+        t2 = _mm256_add_epi32(t2, sha2_256_avx2_bsig0(h[0]));
+
+        h[7] = h[6];
+        h[6] = h[5];
+        h[5] = h[4];
+        h[4] = _mm256_add_epi32(h[3], t1);
+        h[3] = h[2];
+        h[2] = h[1];
+        h[1] = h[0];
+        h[0] = _mm256_add_epi32(t1, t2);
+    }
+
+    // Add temporary variables back into the state of the active lanes.
+    for (i = 0; i < 8; i++) {
+        s[i] = _mm256_blendv_epi8(s[i], _mm256_add_epi32(s[i], h[i]),
+                                  active);
+    }
+}
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_run
+ *
+ * Hashes blocks of the eight lanes together while at least
+ * SHA2_256_AVX2_MIN_LANES of them have blocks left.
+*/
+__attribute__((target("avx2")))
+extern inline void sha2_256_avx2_run(struct sha2_256_avx2_lane* lanes)
+{
+    const uint8_t* blocks[8];
+    int32_t active[8];
+    __m256i s[8];
+    size_t busy = 0;
+    size_t i = 0;
+
+    for (i = 0; i < 8; i++) {
+        s[i] = _mm256_loadu_si256((const __m256i*) lanes[i].h);
+    }
+    sha2_256_avx2_transpose(s);
+
+    for (;;) {
+        busy = 0;
+        for (i = 0; i < 8; i++) {
+            busy += lanes[i].blocks + lanes[i].t_blocks > 0;
+        }
+        if (busy < SHA2_256_AVX2_MIN_LANES) {
+            break;
+        }
+
+        for (i = 0; i < 8; i++) {
+            blocks[i] = sha2_256_avx2_lane_next(&lanes[i]);
+            active[i] = blocks[i] != NULL ? -1 : 0;
+            if (blocks[i] == NULL) {
+                blocks[i] = lanes[i].tail;
+            }
+        }
+
+        sha2_256_avx2_compress(s, blocks,
+                               _mm256_loadu_si256((const __m256i*) active));
+    }
+
+    sha2_256_avx2_transpose(s);
+    for (i = 0; i < 8; i++) {
+        _mm256_storeu_si256((__m256i*) lanes[i].h, s[i]);
+    }
+}
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_supported
+ *
+ * Returns 1 if the host supports AVX2, 0 otherwise.
+*/
+extern inline int sha2_256_avx2_supported()
+{
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+#else
+
+extern inline int sha2_256_avx2_supported()
+{
+    return 0;
+}
+
+#endif
+
+/*
+ * sha2_256_avx2 sha2_256_avx2_batch
+ *
+ * Computes the sha2_256 digests of count messages, msg[i] of len[i] bytes,
+ * eight at a time, and writes digest i to the 32 bytes at digests + 32 * i.
+*/
+extern inline void sha2_256_avx2_batch(const uint8_t* const* msg,
+                                       const size_t* len, uint8_t* digests,
+                                       size_t count)
+{
+    struct sha2_256_avx2_lane lanes[8];
+    size_t group = 0;
+    size_t n = 0;
+    size_t i = 0;
+
+    for (group = 0; group < count; group += 8) {
+        n = count - group < 8 ? count - group : 8;
+
+        for (i = 0; i < 8; i++) {
+            if (i < n) {
+                sha2_256_avx2_lane_init(&lanes[i], msg[group + i],
+                                        len[group + i]);
+            } else {
+                // Idle lanes have nothing to hash.
+                sha2_256_avx2_lane_init(&lanes[i], NULL, 0);
+                lanes[i].t_blocks = 0;
+            }
+        }
+
+#ifdef CC_SHA2_256_AVX2
+        if (sha2_256_avx2_supported()) {
+            sha2_256_avx2_run(lanes);
+        }
+#endif
+
+        for (i = 0; i < n; i++) {
+            sha2_256_avx2_lane_finish(&lanes[i], digests + 32 * (group + i));
+        }
+    }
+}
+
+#endif
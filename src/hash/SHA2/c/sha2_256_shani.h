@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Implementation of the sha2-256 compression function with the Intel SHA
+ * extensions (SHA256RNDS2, SHA256MSG1 and SHA256MSG2).
+ *
+ * sha2_256_shani_core_blocks is a drop-in replacement for the portable
+ * compression function shared by sha2_224.h and sha2_256.h, which call it
+ * whenever sha2_256_shani_supported reports that the host has the SHA
+ * extensions. CC_SHA2_256_SHANI is defined when this path is built (x86 with
+ * GCC or Clang).
+*/
+
+#pragma once
+#ifndef CC_SHA2_256_SHANI_H
+#define CC_SHA2_256_SHANI_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_SHA2_256_SHANI 1
+
+#include "immintrin.h"
+
+const uint32_t sha2_256_shani_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*
+ * sha2_256_shani sha2_256_shani_supported
+ *
+ * Returns 1 if the host supports the SHA extensions and SSE4.1, 0
+ * otherwise.
+*/
+extern inline int sha2_256_shani_supported()
+{
+    return __builtin_cpu_supports("sha") != 0 &&
+           __builtin_cpu_supports("sse4.1") != 0;
+}
+
+/*
+ * sha2_256_shani sha2_256_shani_core_blocks
+ *
+ * Hashes nblocks consecutive 64-byte blocks at data into the eight-word
+ * state, like sha2_256_core_blocks. SHA256RNDS2 works on the state split
+ * as ABEF and CDGH and does two rounds, taking the two message-plus-constant
+ * words from the low half of its third operand.
+*/
+__attribute__((target("sha,sse4.1")))
+extern inline void sha2_256_shani_core_blocks(uint32_t* state,
+        const uint8_t* data, size_t nblocks)
+{
+    const uint32_t* K = sha2_256_shani_k;
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+    __m128i state0;
+    __m128i state1;
+    __m128i abef_save;
+    __m128i cdgh_save;
+    __m128i msg;
+    __m128i msg0;
+    __m128i msg1;
+    __m128i msg2;
+    __m128i msg3;
+    __m128i temp;
+    size_t block = 0;
+
+    // Rearrange state words from ABCD EFGH into ABEF CDGH.
+    temp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state), 0xB1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) (state + 4)),
+                               0x1B);
+    state0 = _mm_alignr_epi8(temp, state1, 8);
+    state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+    for (block = 0; block < nblocks; block++) {
+        abef_save = state0;
+        cdgh_save = state1;
+
+        // Rounds 0-3
+        msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 0)),
+                                mask);
+        msg = _mm_add_epi32(msg0,
+                            _mm_loadu_si128((const __m128i*) (K + 0)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+        // Rounds 4-7
+        msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 16)),
+                                mask);
+        msg = _mm_add_epi32(msg1,
+                            _mm_loadu_si128((const __m128i*) (K + 4)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+        // Rounds 8-11
+        msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 32)),
+                                mask);
+        msg = _mm_add_epi32(msg2,
+                            _mm_loadu_si128((const __m128i*) (K + 8)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+        // Rounds 12-15
+        msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 48)),
+                                mask);
+        msg = _mm_add_epi32(msg3,
+                            _mm_loadu_si128((const __m128i*) (K + 12)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg3, msg2, 4);
+        msg0 = _mm_add_epi32(msg0, temp);
+        msg0 = _mm_sha256msg2_epu32(msg0, msg3);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+        // Rounds 16-19
+        msg = _mm_add_epi32(msg0,
+                            _mm_loadu_si128((const __m128i*) (K + 16)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg0, msg3, 4);
+        msg1 = _mm_add_epi32(msg1, temp);
+        msg1 = _mm_sha256msg2_epu32(msg1, msg0);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+        // Rounds 20-23
+        msg = _mm_add_epi32(msg1,
+                            _mm_loadu_si128((const __m128i*) (K + 20)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg1, msg0, 4);
+        msg2 = _mm_add_epi32(msg2, temp);
+        msg2 = _mm_sha256msg2_epu32(msg2, msg1);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+        // Rounds 24-27
+        msg = _mm_add_epi32(msg2,
+                            _mm_loadu_si128((const __m128i*) (K + 24)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg2, msg1, 4);
+        msg3 = _mm_add_epi32(msg3, temp);
+        msg3 = _mm_sha256msg2_epu32(msg3, msg2);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+        // Rounds 28-31
+        msg = _mm_add_epi32(msg3,
+                            _mm_loadu_si128((const __m128i*) (K + 28)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg3, msg2, 4);
+        msg0 = _mm_add_epi32(msg0, temp);
+        msg0 = _mm_sha256msg2_epu32(msg0, msg3);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+        // Rounds 32-35
+        msg = _mm_add_epi32(msg0,
+                            _mm_loadu_si128((const __m128i*) (K + 32)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg0, msg3, 4);
+        msg1 = _mm_add_epi32(msg1, temp);
+        msg1 = _mm_sha256msg2_epu32(msg1, msg0);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+        // Rounds 36-39
+        msg = _mm_add_epi32(msg1,
+                            _mm_loadu_si128((const __m128i*) (K + 36)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg1, msg0, 4);
+        msg2 = _mm_add_epi32(msg2, temp);
+        msg2 = _mm_sha256msg2_epu32(msg2, msg1);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+        // Rounds 40-43
+        msg = _mm_add_epi32(msg2,
+                            _mm_loadu_si128((const __m128i*) (K + 40)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg2, msg1, 4);
+        msg3 = _mm_add_epi32(msg3, temp);
+        msg3 = _mm_sha256msg2_epu32(msg3, msg2);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+        // Rounds 44-47
+        msg = _mm_add_epi32(msg3,
+                            _mm_loadu_si128((const __m128i*) (K + 44)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg3, msg2, 4);
+        msg0 = _mm_add_epi32(msg0, temp);
+        msg0 = _mm_sha256msg2_epu32(msg0, msg3);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+        // Rounds 48-51
+        msg = _mm_add_epi32(msg0,
+                            _mm_loadu_si128((const __m128i*) (K + 48)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg0, msg3, 4);
+        msg1 = _mm_add_epi32(msg1, temp);
+        msg1 = _mm_sha256msg2_epu32(msg1, msg0);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+        // Rounds 52-55
+        msg = _mm_add_epi32(msg1,
+                            _mm_loadu_si128((const __m128i*) (K + 52)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg1, msg0, 4);
+        msg2 = _mm_add_epi32(msg2, temp);
+        msg2 = _mm_sha256msg2_epu32(msg2, msg1);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+        // Rounds 56-59
+        msg = _mm_add_epi32(msg2,
+                            _mm_loadu_si128((const __m128i*) (K + 56)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        temp = _mm_alignr_epi8(msg2, msg1, 4);
+        msg3 = _mm_add_epi32(msg3, temp);
+        msg3 = _mm_sha256msg2_epu32(msg3, msg2);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+        // Rounds 60-63
+        msg = _mm_add_epi32(msg3,
+                            _mm_loadu_si128((const __m128i*) (K + 60)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+        // Add temporary variables back into state.
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+
+        data += 64;
+    }
+
+    // And back from ABEF CDGH to ABCD EFGH.
+    temp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(temp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, temp, 8);
+
+    _mm_storeu_si128((__m128i*) state, state0);
+    _mm_storeu_si128((__m128i*) (state + 4), state1);
+}
+
+#else
+
+extern inline int sha2_256_shani_supported()
+{
+    return 0;
+}
+
+#endif
+
+#endif
@@ -27,6 +27,11 @@
 
 #include "stdint.h"
 #include "string.h"
+#include "sha2_512_avx2.h"
+
+#define SHA2_384_STATE_VERSION 1
+#define SHA2_384_STATE_ID 5
+#define SHA2_384_STATE_SIZE 205
 
 /*
  * struct sha2_384
@@ -161,10 +166,10 @@ extern inline uint64_t sha2_384_ssig1(uint64_t x)
 }
 
 /*
- * sha2_384 sha2_384_core
+ * sha2_384 sha2_384_portable_core_blocks
  *
- * Core of sha2_384 hash function; operates on a single round from m->partial
- * and updates hash state in m->s.
+ * Portable core of sha2_384 hash function; operates on nblocks consecutive
+ * 128-byte blocks at data and updates the hash state in state.
  * SHA-384 and SHA-512 perform identical processing on message blocks
  * and differ only in how H(0) is initialized and how they produce their
  * final output.  They may be used to hash a message, M, having a length
@@ -232,7 +237,8 @@ extern inline uint64_t sha2_384_ssig1(uint64_t x)
  * H(N)7.  For SHA-384, this is the concatenation of H(N)0, H(N)1,
  * through H(N)5.
 */
-extern inline void sha2_384_core(struct sha2_384* m)
+extern inline void sha2_384_portable_core_blocks(uint64_t* state,
+        const uint8_t* data, size_t nblocks)
 {
     size_t t = 0;
     uint64_t w[80];
@@ -297,59 +303,93 @@ extern inline void sha2_384_core(struct sha2_384* m)
         0x431D67C49C100D4Cll, 0x4CC5D4BECB3E42B6ll, 0x597F299CFC657E2All,
         0x5FCB6FAB3AD6FAECll, 0x6C44198C4A475817ll
     };
+    size_t block = 0;
+
+    for (block = 0; block < nblocks; block++) {
+        // Message has to be processed as a big endian integer
+        for (t = 0; t < 16; t++) {
+            w[t] = ((uint64_t) data[t * 8 + 0] << 56) |
+                   ((uint64_t) data[t * 8 + 1] << 48) |
+                   ((uint64_t) data[t * 8 + 2] << 40) |
+                   ((uint64_t) data[t * 8 + 3] << 32) |
+                   ((uint64_t) data[t * 8 + 4] << 24) |
+                   ((uint64_t) data[t * 8 + 5] << 16) |
+                   ((uint64_t) data[t * 8 + 6] << 8) |
+                   ((uint64_t) data[t * 8 + 7] << 0);
+        }
 
-    // Message has to be processed as a big endian integer
-    for (t = 0; t < 16; t++) {
-        w[t] = (((
-                     uint64_t) m->partial[t * 8 + 0]) << 56) | (((
-                                 uint64_t) m->partial[t * 8 + 1]) << 48) | (((
-                                             uint64_t) m->partial[t * 8 + 2]) << 40) | (((
-                                                     uint64_t) m->partial[t * 8 + 3]) << 32) | (((
-                                                             uint64_t) m->partial[t * 8 + 4]) << 24) | (((
-                                                                     uint64_t) m->partial[t * 8 + 5]) << 16) | (((
-                                                                             uint64_t) m->partial[t * 8 + 6]) << 8) | (((
-                                                                                     uint64_t) m->partial[t * 8 + 7]) << 0);
-    }
+        for (t = 16; t < 80; t++) {
+            w[t] = sha2_384_ssig1(w[t - 2]) + w[t - 7] + sha2_384_ssig0(
+                       w[t - 15]) + w[t - 16];
+        }
+
+        // Duplicate state into temporary variables
+        h[0] = state[0];
+        h[1] = state[1];
+        h[2] = state[2];
+        h[3] = state[3];
+        h[4] = state[4];
+        h[5] = state[5];
+        h[6] = state[6];
+        h[7] = state[7];
+
+        for (t = 0; t < 80; t++) {
+            tmp1 = h[7] + sha2_384_bsig1(h[4]) + sha2_384_ch(h[4], h[5],
+                    h[6]) + K[t] + w[t];
+            tmp2 = sha2_384_bsig0(h[0]) + sha2_384_mj(h[0], h[1], h[2]);
+
+            h[7] = h[6];
+            h[6] = h[5];
+            h[5] = h[4];
+            h[4] = h[3] + tmp1;
+            h[3] = h[2];
+            h[2] = h[1];
+            h[1] = h[0];
+            h[0] = tmp1 + tmp2;
+        }
 
-    for (t = 16; t < 80; t++) {
-        w[t] = sha2_384_ssig1(w[t - 2]) + w[t - 7] + sha2_384_ssig0(
-                   w[t - 15]) + w[t - 16];
+        // Add temporary variables back into state.
+        state[0] += h[0];
+        state[1] += h[1];
+        state[2] += h[2];
+        state[3] += h[3];
+        state[4] += h[4];
+        state[5] += h[5];
+        state[6] += h[6];
+        state[7] += h[7];
+
+        data += 128;
     }
+}
 
-    // Duplicate state into temporary variables
-    h[0] = m->h[0];
-    h[1] = m->h[1];
-    h[2] = m->h[2];
-    h[3] = m->h[3];
-    h[4] = m->h[4];
-    h[5] = m->h[5];
-    h[6] = m->h[6];
-    h[7] = m->h[7];
-
-    for (t = 0; t < 80; t++) {
-        tmp1 = h[7] + sha2_384_bsig1(h[4]) + sha2_384_ch(h[4], h[5],
-                h[6]) + K[t] + w[t];
-        tmp2 = sha2_384_bsig0(h[0]) + sha2_384_mj(h[0], h[1], h[2]);
-
-        h[7] = h[6];
-        h[6] = h[5];
-        h[5] = h[4];
-        h[4] = h[3] + tmp1;
-        h[3] = h[2];
-        h[2] = h[1];
-        h[1] = h[0];
-        h[0] = tmp1 + tmp2;
+/*
+ * sha2_384 sha2_384_core_blocks
+ *
+ * Hashes nblocks consecutive 128-byte blocks at data into state, with the
+ * AVX2 core when the host has AVX2 (sha2_512_avx2.h) and with
+ * sha2_384_portable_core_blocks otherwise.
+*/
+extern inline void sha2_384_core_blocks(uint64_t* state, const uint8_t* data,
+                                        size_t nblocks)
+{
+#ifdef CC_SHA2_512_AVX2
+    if (sha2_512_avx2_supported()) {
+        sha2_512_avx2_core_blocks(state, data, nblocks);
+        return;
     }
+#endif
+
+    sha2_384_portable_core_blocks(state, data, nblocks);
+}
 
-    // Add temporary variables back into state.
-    m->h[0] += h[0];
-    m->h[1] += h[1];
-    m->h[2] += h[2];
-    m->h[3] += h[3];
-    m->h[4] += h[4];
-    m->h[5] += h[5];
-    m->h[6] += h[6];
-    m->h[7] += h[7];
+/*
+ * sha2_384 sha2_384_core
+ *
+ * Runs sha2_384_core_blocks on the buffered block in m->partial.
+*/
+extern inline void sha2_384_core(struct sha2_384* m)
+{
+    sha2_384_core_blocks(m->h, m->partial, 1);
 }
 
 /*
@@ -402,21 +442,41 @@ extern inline void sha2_384_init(struct sha2_384* m)
 extern inline void sha2_384_update(struct sha2_384* m, char* msg,
                                    uint64_t len)
 {
-    size_t i = 0;
+    const uint8_t* data = (const uint8_t*) msg;
+    size_t fill = 0;
+    size_t nblocks = 0;
 
     m->len += len;
-    for (i = 0; i < len; i++) {
-        if (m->p_len == 128) {
-            m->p_len = 0;
 
-            // Once we finish a buffer, call the core sha2_384 function to update
-            // state and recompute the current hash value.
+    // Complete a partially filled block first.
+    if (m->p_len > 0) {
+        fill = 128 - m->p_len;
+        if (fill > len) {
+            fill = (size_t) len;
+        }
+
+        memcpy(m->partial + m->p_len, data, fill);
+        m->p_len += fill;
+        data += fill;
+        len -= fill;
+
+        if (m->p_len == 128) {
             sha2_384_core(m);
+            m->p_len = 0;
         }
+    }
 
-        m->partial[m->p_len] = (uint8_t)((unsigned char) msg[i]);
-        m->p_len += 1;
+    // Whole blocks are hashed directly from the caller's buffer.
+    nblocks = len / 128;
+    if (nblocks > 0) {
+        sha2_384_core_blocks(m->h, data, nblocks);
+        data += nblocks * 128;
+        len -= nblocks * 128;
     }
+
+    // Buffer the tail for the next update or finalize.
+    memcpy(m->partial + m->p_len, data, (size_t) len);
+    m->p_len += (size_t) len;
 }
 
 /*
@@ -475,7 +535,7 @@ extern inline void sha2_384_update(struct sha2_384* m, char* msg,
 */
 extern inline void sha2_384_finalize(struct sha2_384* m)
 {
-    if (m->p_len > 119) {
+    if (m->p_len > 111) {
         m->partial[m->p_len] = 0x80;
         m->p_len += 1;
 
@@ -536,4 +596,107 @@ extern inline uint8_t* sha2_384_sum(struct sha2_384* m, char* msg)
     return m->digest;
 }
 
+/*
+ * sha2_384 sha2_384_store_be
+ *
+ * Writes the low count bytes of value to out, most significant first.
+*/
+extern inline void sha2_384_store_be(uint8_t* out, uint64_t value,
+                                     size_t count)
+{
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        out[i] = (uint8_t) (value >> (8 * (count - 1 - i)));
+    }
+}
+
+/*
+ * sha2_384 sha2_384_load_be
+ *
+ * Reads count bytes at in as a big endian integer.
+*/
+extern inline uint64_t sha2_384_load_be(const uint8_t* in, size_t count)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+/*
+ * sha2_384 sha2_384_export
+ *
+ * Serializes the in-progress state of m into the SHA2_384_STATE_SIZE bytes at
+ * out, so that hashing can resume later with sha2_384_import, in this process
+ * or another one. The layout is stable for a given SHA2_384_STATE_VERSION,
+ * and all integers are big endian:
+ *
+ *     4 bytes   -- "cc", SHA2_384_STATE_VERSION, SHA2_384_STATE_ID
+ *     64 bytes  -- h[0] through h[7]
+ *     8 bytes   -- len
+ *     1 byte    -- p_len
+ *     128 bytes -- partial; bytes past p_len are zero
+*/
+extern inline void sha2_384_export(const struct sha2_384* m, uint8_t* out)
+{
+    size_t i = 0;
+
+    memset(out, 0, SHA2_384_STATE_SIZE);
+    out[0] = 'c';
+    out[1] = 'c';
+    out[2] = SHA2_384_STATE_VERSION;
+    out[3] = SHA2_384_STATE_ID;
+
+    for (i = 0; i < 8; i++) {
+        sha2_384_store_be(out + 4 + 8 * i, m->h[i], 8);
+    }
+
+    sha2_384_store_be(out + 68, m->len, 8);
+    out[76] = (uint8_t) m->p_len;
+    memcpy(out + 77, m->partial, m->p_len);
+}
+
+/*
+ * sha2_384 sha2_384_import
+ *
+ * Restores a state written by sha2_384_export into m; sha2_384_update and
+ * sha2_384_finalize then continue as if hashing had never stopped. Returns 1
+ * on success. Returns 0 and leaves m untouched if the len bytes at in are not
+ * a sha2_384 state of this version.
+*/
+extern inline int sha2_384_import(struct sha2_384* m, const uint8_t* in,
+                                  size_t len)
+{
+    size_t i = 0;
+    size_t p_len = 0;
+
+    if (len != SHA2_384_STATE_SIZE || in[0] != 'c' || in[1] != 'c' ||
+            in[2] != SHA2_384_STATE_VERSION || in[3] != SHA2_384_STATE_ID) {
+        return 0;
+    }
+
+    // The partial block always holds the input past the last whole block.
+    p_len = in[76];
+    if (p_len != (size_t) (sha2_384_load_be(in + 68, 8) % 128)) {
+        return 0;
+    }
+
+    memset(m->digest, 0, sizeof(m->digest));
+    for (i = 0; i < 8; i++) {
+        m->h[i] = (uint64_t) sha2_384_load_be(in + 4 + 8 * i, 8);
+    }
+
+    m->len = sha2_384_load_be(in + 68, 8);
+    m->p_len = p_len;
+    memset(m->partial, 0, sizeof(m->partial));
+    memcpy(m->partial, in + 77, p_len);
+
+    return 1;
+}
+
 #endif // CC_sha2_384_H
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Implementation of the sha2_512/224 hash algorithm per FIPS 180-4: sha2_512
+ * with its own initial hash value, truncated to 224 bits. It runs on the
+ * 64-bit sha2_512 core, which on 64-bit hosts processes more bytes per
+ * cycle than sha2_256. See docs for the specification.
+ *
+ *
+ * Usage:
+ *
+ *     struct sha2_512_224 m;
+ *     sha2_512_224_sum(&m, "The quick brown fox jumps over the lazy dog");
+ *     // Note, sha2_512_224_sum returns the resulting sha2_512_224 digest
+ *
+ *
+ * Alternative usage:
+ *
+ *     struct sha2_512_224 m;
+ *     sha2_512_224_init(&m);
+ *     sha2_512_224_update(&m, "The quick brown fox jumps over the lazy dog", 43);
+ *     sha2_512_224_finalize(&m);
+*/
+
+#pragma once
+#ifndef CC_SHA2_512_224_H
+#define CC_SHA2_512_224_H
+
+#include "stdint.h"
+#include "string.h"
+#include "sha2_512.h"
+
+#define SHA2_512_224_STATE_VERSION SHA2_512_STATE_VERSION
+#define SHA2_512_224_STATE_ID 7
+#define SHA2_512_224_STATE_SIZE SHA2_512_STATE_SIZE
+
+/*
+ * struct sha2_512_224
+ *
+ * uint8_t digest[28]    -- public; digest after finalization
+ *
+ * struct sha2_512 inner -- internal; sha2_512 state with the sha2_512_224 IV
+*/
+struct sha2_512_224 {
+    uint8_t digest[28];
+
+    struct sha2_512 inner;
+};
+
+/*
+ * sha2_512_224 sha2_512_224_init
+ *
+ * Initializes sha2_512_224 struct with initial state seed, empties partial
+ * and digest.
+ *
+ * For SHA-512/224, the initial hash value, H(0), consists of the
+ * following eight 64-bit words, in hex (generated by the SHA-512/t IV
+ * generation function of FIPS 180-4 section 5.3.6 with t = 224).
+ *
+ *     H(0)0 = 8c3d37c819544da2
+ *     H(0)1 = 73e1996689dcd4d6
+ *     H(0)2 = 1dfab7ae32ff9c82
+ *     H(0)3 = 679dd514582f9fcf
+ *     H(0)4 = 0f6d2b697bd44da8
+ *     H(0)5 = 77e36f7304c48942
+ *     H(0)6 = 3f9d85a86a1d36c8
+ *     H(0)7 = 1112e6ad91d692a1
+*/
+extern inline void sha2_512_224_init(struct sha2_512_224* m)
+{
+    memset(m->digest, 0, sizeof(m->digest));
+    sha2_512_init(&(m->inner));
+
+    m->inner.h[0] = 0x8c3d37c819544da2ll;
+    m->inner.h[1] = 0x73e1996689dcd4d6ll;
+    m->inner.h[2] = 0x1dfab7ae32ff9c82ll;
+    m->inner.h[3] = 0x679dd514582f9fcfll;
+    m->inner.h[4] = 0x0f6d2b697bd44da8ll;
+    m->inner.h[5] = 0x77e36f7304c48942ll;
+    m->inner.h[6] = 0x3f9d85a86a1d36c8ll;
+    m->inner.h[7] = 0x1112e6ad91d692a1ll;
+}
+
+/*
+ * sha2_512_224 sha2_512_224_update
+ *
+ * Updates the state of the sha2_512_224 struct with new values
+*/
+extern inline void sha2_512_224_update(struct sha2_512_224* m, char* msg,
+                                       uint64_t len)
+{
+    sha2_512_update(&(m->inner), msg, len);
+}
+
+/*
+ * sha2_512_224 sha2_512_224_finalize
+ *
+ * Finalizes the sha2_512_224 digest: the leftmost 28 bytes of the sha2_512
+ * digest.
+*/
+extern inline void sha2_512_224_finalize(struct sha2_512_224* m)
+{
+    sha2_512_finalize(&(m->inner));
+    memcpy(m->digest, m->inner.digest, 28);
+}
+
+/*
+ * sha2_512_224 sha2_512_224_sum
+ *
+ * Computes the sha2_512_224 sum of the msg and finalizes the digest, which is
+ * returned.
+*/
+extern inline uint8_t* sha2_512_224_sum(struct sha2_512_224* m, char* msg)
+{
+    sha2_512_224_init(m);
+    sha2_512_224_update(m, msg, strlen(msg));
+    sha2_512_224_finalize(m);
+    return m->digest;
+}
+
+/*
+ * sha2_512_224 sha2_512_224_export
+ *
+ * Serializes the in-progress state of m into the SHA2_512_224_STATE_SIZE
+ * bytes at out: the layout of sha2_512_export, tagged with
+ * SHA2_512_224_STATE_ID.
+*/
+extern inline void sha2_512_224_export(const struct sha2_512_224* m,
+                                       uint8_t* out)
+{
+    sha2_512_export(&(m->inner), out);
+    out[3] = SHA2_512_224_STATE_ID;
+}
+
+/*
+ * sha2_512_224 sha2_512_224_import
+ *
+ * Restores a state written by sha2_512_224_export into m. Returns 1 on
+ * success, and 0 with m untouched if the len bytes at in are not a
+ * sha2_512_224 state.
+*/
+extern inline int sha2_512_224_import(struct sha2_512_224* m,
+                                      const uint8_t* in, size_t len)
+{
+    uint8_t state[SHA2_512_STATE_SIZE];
+
+    if (len != SHA2_512_224_STATE_SIZE || in[3] != SHA2_512_224_STATE_ID) {
+        return 0;
+    }
+
+    memcpy(state, in, len);
+    state[3] = SHA2_512_STATE_ID;
+    if (!sha2_512_import(&(m->inner), state, len)) {
+        return 0;
+    }
+
+    memset(m->digest, 0, sizeof(m->digest));
+    return 1;
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Implementation of the sha2_512/256 hash algorithm per FIPS 180-4: sha2_512
+ * with its own initial hash value, truncated to 256 bits. It runs on the
+ * 64-bit sha2_512 core, which on 64-bit hosts processes more bytes per
+ * cycle than sha2_256. See docs for the specification.
+ *
+ *
+ * Usage:
+ *
+ *     struct sha2_512_256 m;
+ *     sha2_512_256_sum(&m, "The quick brown fox jumps over the lazy dog");
+ *     // Note, sha2_512_256_sum returns the resulting sha2_512_256 digest
+ *
+ *
+ * Alternative usage:
+ *
+ *     struct sha2_512_256 m;
+ *     sha2_512_256_init(&m);
+ *     sha2_512_256_update(&m, "The quick brown fox jumps over the lazy dog", 43);
+ *     sha2_512_256_finalize(&m);
+*/
+
+#pragma once
+#ifndef CC_SHA2_512_256_H
+#define CC_SHA2_512_256_H
+
+#include "stdint.h"
+#include "string.h"
+#include "sha2_512.h"
+
+#define SHA2_512_256_STATE_VERSION SHA2_512_STATE_VERSION
+#define SHA2_512_256_STATE_ID 8
+#define SHA2_512_256_STATE_SIZE SHA2_512_STATE_SIZE
+
+/*
+ * struct sha2_512_256
+ *
+ * uint8_t digest[32]    -- public; digest after finalization
+ *
+ * struct sha2_512 inner -- internal; sha2_512 state with the sha2_512_256 IV
+*/
+struct sha2_512_256 {
+    uint8_t digest[32];
+
+    struct sha2_512 inner;
+};
+
+/*
+ * sha2_512_256 sha2_512_256_init
+ *
+ * Initializes sha2_512_256 struct with initial state seed, empties partial
+ * and digest.
+ *
+ * For SHA-512/256, the initial hash value, H(0), consists of the
+ * following eight 64-bit words, in hex (generated by the SHA-512/t IV
+ * generation function of FIPS 180-4 section 5.3.6 with t = 256).
+ *
+ *     H(0)0 = 22312194fc2bf72c
+ *     H(0)1 = 9f555fa3c84c64c2
+ *     H(0)2 = 2393b86b6f53b151
+ *     H(0)3 = 963877195940eabd
+ *     H(0)4 = 96283ee2a88effe3
+ *     H(0)5 = be5e1e2553863992
+ *     H(0)6 = 2b0199fc2c85b8aa
+ *     H(0)7 = 0eb72ddc81c52ca2
+*/
+extern inline void sha2_512_256_init(struct sha2_512_256* m)
+{
+    memset(m->digest, 0, sizeof(m->digest));
+    sha2_512_init(&(m->inner));
+
+    m->inner.h[0] = 0x22312194fc2bf72cll;
+    m->inner.h[1] = 0x9f555fa3c84c64c2ll;
+    m->inner.h[2] = 0x2393b86b6f53b151ll;
+    m->inner.h[3] = 0x963877195940eabdll;
+    m->inner.h[4] = 0x96283ee2a88effe3ll;
+    m->inner.h[5] = 0xbe5e1e2553863992ll;
+    m->inner.h[6] = 0x2b0199fc2c85b8aall;
+    m->inner.h[7] = 0x0eb72ddc81c52ca2ll;
+}
+
+/*
+ * sha2_512_256 sha2_512_256_update
+ *
+ * Updates the state of the sha2_512_256 struct with new values
+*/
+extern inline void sha2_512_256_update(struct sha2_512_256* m, char* msg,
+                                       uint64_t len)
+{
+    sha2_512_update(&(m->inner), msg, len);
+}
+
+/*
+ * sha2_512_256 sha2_512_256_finalize
+ *
+ * Finalizes the sha2_512_256 digest: the leftmost 32 bytes of the sha2_512
+ * digest.
+*/
+extern inline void sha2_512_256_finalize(struct sha2_512_256* m)
+{
+    sha2_512_finalize(&(m->inner));
+    memcpy(m->digest, m->inner.digest, 32);
+}
+
+/*
+ * sha2_512_256 sha2_512_256_sum
+ *
+ * Computes the sha2_512_256 sum of the msg and finalizes the digest, which is
+ * returned.
+*/
+extern inline uint8_t* sha2_512_256_sum(struct sha2_512_256* m, char* msg)
+{
+    sha2_512_256_init(m);
+    sha2_512_256_update(m, msg, strlen(msg));
+    sha2_512_256_finalize(m);
+    return m->digest;
+}
+
+/*
+ * sha2_512_256 sha2_512_256_export
+ *
+ * Serializes the in-progress state of m into the SHA2_512_256_STATE_SIZE
+ * bytes at out: the layout of sha2_512_export, tagged with
+ * SHA2_512_256_STATE_ID.
+*/
+extern inline void sha2_512_256_export(const struct sha2_512_256* m,
+                                       uint8_t* out)
+{
+    sha2_512_export(&(m->inner), out);
+    out[3] = SHA2_512_256_STATE_ID;
+}
+
+/*
+ * sha2_512_256 sha2_512_256_import
+ *
+ * Restores a state written by sha2_512_256_export into m. Returns 1 on
+ * success, and 0 with m untouched if the len bytes at in are not a
+ * sha2_512_256 state.
+*/
+extern inline int sha2_512_256_import(struct sha2_512_256* m,
+                                      const uint8_t* in, size_t len)
+{
+    uint8_t state[SHA2_512_STATE_SIZE];
+
+    if (len != SHA2_512_256_STATE_SIZE || in[3] != SHA2_512_256_STATE_ID) {
+        return 0;
+    }
+
+    memcpy(state, in, len);
+    state[3] = SHA2_512_STATE_ID;
+    if (!sha2_512_import(&(m->inner), state, len)) {
+        return 0;
+    }
+
+    memset(m->digest, 0, sizeof(m->digest));
+    return 1;
+}
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Implementation of the sha2-512 compression function with an AVX2 message
+ * schedule and unrolled rounds.
+ *
+ * The message schedule is computed four words per instruction where the
+ * recurrence allows it (the sigma1 term, which depends on the two previous
+ * words, is done two words at a time), and K[t] is added in the same pass.
+ * Each group of eight rounds is written out with the working variables
+ * renamed instead of shifted, and the schedule for a later group is
+ * computed alongside it.
+ *
+ * sha2_512_avx2_core_blocks is a drop-in replacement for the portable
+ * compression function shared by sha2_384.h and sha2_512.h, which call it
+ * whenever sha2_512_avx2_supported reports that the host has AVX2.
+ * CC_SHA2_512_AVX2 is defined when this path is built (x86 with GCC or
+ * Clang).
+*/
+
+#pragma once
+#ifndef CC_SHA2_512_AVX2_H
+#define CC_SHA2_512_AVX2_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_SHA2_512_AVX2 1
+
+#include "immintrin.h"
+
+const uint64_t sha2_512_avx2_k[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+/*
+ * sha2_512_avx2 sha2_512_avx2_supported
+ *
+ * Returns 1 if the host supports AVX2, 0 otherwise.
+*/
+extern inline int sha2_512_avx2_supported()
+{
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_512_avx2_rotr(__m256i x, int count)
+{
+    return _mm256_or_si256(_mm256_srli_epi64(x, count),
+                           _mm256_slli_epi64(x, 64 - count));
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i sha2_512_avx2_ssig0(__m256i x)
+{
+    return _mm256_xor_si256(_mm256_xor_si256(sha2_512_avx2_rotr(x, 1),
+                            sha2_512_avx2_rotr(x, 8)),
+                            _mm256_srli_epi64(x, 7));
+}
+
+__attribute__((target("avx2")))
+extern inline __m128i sha2_512_avx2_ssig1(__m128i x)
+{
+    __m128i r19 = _mm_or_si128(_mm_srli_epi64(x, 19), _mm_slli_epi64(x, 45));
+    __m128i r61 = _mm_or_si128(_mm_srli_epi64(x, 61), _mm_slli_epi64(x, 3));
+
+    return _mm_xor_si128(_mm_xor_si128(r19, r61), _mm_srli_epi64(x, 6));
+}
+
+/*
+ * sha2_512_avx2 sha2_512_avx2_schedule
+ *
+ * Computes w[t] through w[t + 3] from the earlier words, and wk[t] through
+ * wk[t + 3] as those words plus K.
+*/
+__attribute__((target("avx2")))
+extern inline void sha2_512_avx2_schedule(uint64_t* w, uint64_t* wk,
+        size_t t)
+{
+    __m256i x;
+    __m128i lo;
+    __m128i hi;
+
+    // w[t - 16] + ssig0(w[t - 15]) + w[t - 7], four words at once.
+    x = _mm256_loadu_si256((const __m256i*) (w + t - 15));
+    x = _mm256_add_epi64(sha2_512_avx2_ssig0(x),
+                         _mm256_loadu_si256((const __m256i*) (w + t - 16)));
+    x = _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*) (w + t - 7)));
+
+    // ssig1(w[t - 2]) for the first pair, which the second pair needs.
+    lo = _mm256_castsi256_si128(x);
+    lo = _mm_add_epi64(lo, sha2_512_avx2_ssig1(
+                           _mm_loadu_si128((const __m128i*) (w + t - 2))));
+    hi = _mm256_extracti128_si256(x, 1);
+    hi = _mm_add_epi64(hi, sha2_512_avx2_ssig1(lo));
+
+    x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    _mm256_storeu_si256((__m256i*) (w + t), x);
+    x = _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)
+                         (sha2_512_avx2_k + t)));
+    _mm256_storeu_si256((__m256i*) (wk + t), x);
+}
+
+/*
+ * sha2_512_avx2 sha2_512_avx2_round
+ *
+ * One round; the caller renames the working variables instead of shifting
+ * them, so only d and h are written.
+*/
+extern inline void sha2_512_avx2_round(uint64_t a, uint64_t b, uint64_t c,
+                                       uint64_t* d, uint64_t e, uint64_t f,
+                                       uint64_t g, uint64_t* h, uint64_t wk)
+{
+    uint64_t s0 = ((a >> 28) | (a << 36)) ^ ((a >> 34) | (a << 30)) ^
+                  ((a >> 39) | (a << 25));
+    uint64_t s1 = ((e >> 14) | (e << 50)) ^ ((e >> 18) | (e << 46)) ^
+                  ((e >> 41) | (e << 23));
+    uint64_t t1 = *h + s1 + (g ^ (e & (f ^ g))) + wk;
+    uint64_t t2 = s0 + ((a & b) | (c & (a | b)));
+
+    *d += t1;
+    *h = t1 + t2;
+}
+
+/*
+ * sha2_512_avx2 sha2_512_avx2_core_blocks
+ *
+ * Hashes nblocks consecutive 128-byte blocks at data into the eight-word
+ * state, like sha2_512_core_blocks.
+*/
+__attribute__((target("avx2")))
+extern inline void sha2_512_avx2_core_blocks(uint64_t* state,
+        const uint8_t* data, size_t nblocks)
+{
+    const __m256i bswap = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7,
+                                          8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7);
+    uint64_t w[80];
+    uint64_t wk[80];
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+    uint64_t d;
+    uint64_t e;
+    uint64_t f;
+    uint64_t g;
+    uint64_t h;
+    __m256i x;
+    size_t block = 0;
+    size_t t = 0;
+
+    for (block = 0; block < nblocks; block++) {
+        // Message has to be processed as a big endian integer
+        for (t = 0; t < 16; t += 4) {
+            x = _mm256_loadu_si256((const __m256i*) (data + 8 * t));
+            x = _mm256_shuffle_epi8(x, bswap);
+            _mm256_storeu_si256((__m256i*) (w + t), x);
+            x = _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)
+                                 (sha2_512_avx2_k + t)));
+            _mm256_storeu_si256((__m256i*) (wk + t), x);
+        }
+
+        // Duplicate state into temporary variables
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (t = 0; t < 80; t += 8) {
+            // Schedule the words of the group after the next one.
+            if (t + 16 < 80) {
+                sha2_512_avx2_schedule(w, wk, t + 16);
+                sha2_512_avx2_schedule(w, wk, t + 20);
+            }
+
+            sha2_512_avx2_round(a, b, c, &d, e, f, g, &h, wk[t + 0]);
+            sha2_512_avx2_round(h, a, b, &c, d, e, f, &g, wk[t + 1]);
+            sha2_512_avx2_round(g, h, a, &b, c, d, e, &f, wk[t + 2]);
+            sha2_512_avx2_round(f, g, h, &a, b, c, d, &e, wk[t + 3]);
+            sha2_512_avx2_round(e, f, g, &h, a, b, c, &d, wk[t + 4]);
+            sha2_512_avx2_round(d, e, f, &g, h, a, b, &c, wk[t + 5]);
+            sha2_512_avx2_round(c, d, e, &f, g, h, a, &b, wk[t + 6]);
+            sha2_512_avx2_round(b, c, d, &e, f, g, h, &a, wk[t + 7]);
+        }
+
+        // Add temporary variables back into state.
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        data += 128;
+    }
+}
+
+#else
+
+extern inline int sha2_512_avx2_supported()
+{
+    return 0;
+}
+
+#endif
+
+#endif
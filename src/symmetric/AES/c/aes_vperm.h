@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Vector-permute implementation of the aes encryption algorithm per FIPS 197,
+ * after Hamburg's "Accelerating AES with Vector Permute Instructions". See
+ * docs for the specification.
+ *
+ * SubBytes is computed with SSSE3 pshufb lookups into 16-entry nibble tables,
+ * so no memory access depends on the data or the key. This makes it suitable
+ * for single-block, latency-bound modes (CBC encryption, CMAC) on hosts
+ * without AES-NI, where bitslicing does not pay off.
+ *
+ * The expanded key is taken from the regular aes128, aes192 or aes256
+ * structures:
+ *
+ *     struct aes128 a;
+ *     struct aes_vperm v;
+ *     aes128_init(&a, key);
+ *     aes_vperm_init(&v, a.skey, 10);
+ *     aes_vperm_encrypt(&v, plaintext, ciphertext);
+ *
+ * Only built on x86 with GCC or Clang; CC_AES_VPERM is defined when it is.
+ * Callers must check aes_vperm_supported() at runtime and fall back to the
+ * table-driven implementation otherwise.
+*/
+
+#pragma once
+#ifndef CC_AES_VPERM_H
+#define CC_AES_VPERM_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_AES_VPERM 1
+
+#include "tmmintrin.h"
+
+/*
+ * Field representation
+ *
+ * GF(2^8) is represented as GF(2^4)[t]/(t^2 + t + 8), with GF(2^4) built
+ * over x^4 + x + 1. A byte holds an element as hi * 1 + lo * (t + 1), so
+ * that hi and (hi ^ lo) are its coordinates in the normal basis {t, t + 1}.
+ * With i = hi, k = lo and j = i ^ k, the inverse is obtained through
+ *
+ *     io = j ^ 1 / (1 / i ^ 1 / (8 * k))
+ *     jo = i ^ 1 / (1 / j ^ 1 / (8 * k))
+ *
+ * where 1 / 0 is represented by 0x80, which pshufb maps back to zero. The
+ * output tables are indexed by io and jo and fold in the remaining
+ * reciprocal, the basis change, the affine transform of SubBytes and, for
+ * inner rounds, the MixColumns coefficients. All additive constants are
+ * folded into the transformed round keys.
+*/
+
+/*
+ * 1 / x and 1 / (8 * x) in GF(2^4)
+*/
+const uint8_t aes_vperm_inv[16] = {
+    0x80, 0x01, 0x09, 0x0e, 0x0d, 0x0b, 0x07, 0x06,
+    0x0f, 0x02, 0x0c, 0x05, 0x0a, 0x04, 0x03, 0x08
+};
+
+const uint8_t aes_vperm_inv_a[16] = {
+    0x80, 0x0f, 0x0e, 0x05, 0x07, 0x03, 0x0b, 0x04,
+    0x0a, 0x0d, 0x08, 0x06, 0x0c, 0x09, 0x02, 0x01
+};
+
+/*
+ * Standard byte to tower basis, split by nibble
+*/
+const uint8_t aes_vperm_ipt_lo[16] = {
+    0x00, 0x10, 0x22, 0x32, 0x24, 0x34, 0x06, 0x16,
+    0x84, 0x94, 0xa6, 0xb6, 0xa0, 0xb0, 0x82, 0x92
+};
+
+const uint8_t aes_vperm_ipt_hi[16] = {
+    0x00, 0xf3, 0x8d, 0x7e, 0x73, 0x80, 0xfe, 0x0d,
+    0xbe, 0x4d, 0x33, 0xc0, 0xcd, 0x3e, 0x40, 0xb3
+};
+
+/*
+ * S(x) and 2 * S(x) in the tower basis, indexed by io (u) and jo (t)
+*/
+const uint8_t aes_vperm_sb1u[16] = {
+    0x00, 0xbb, 0xc0, 0xce, 0xe8, 0x5d, 0x0e, 0xb5,
+    0x75, 0x9d, 0x53, 0x93, 0xe6, 0x28, 0x26, 0x7b
+};
+
+const uint8_t aes_vperm_sb1t[16] = {
+    0x00, 0xda, 0xd9, 0xd1, 0x74, 0xa6, 0x08, 0xd2,
+    0x0b, 0x7f, 0xae, 0x77, 0x7c, 0xad, 0xa5, 0x03
+};
+
+const uint8_t aes_vperm_sb2u[16] = {
+    0x00, 0xb5, 0xbb, 0xab, 0x4f, 0xea, 0x10, 0xa5,
+    0x1e, 0x51, 0xfa, 0x41, 0x5f, 0xf4, 0xe4, 0x0e
+};
+
+const uint8_t aes_vperm_sb2t[16] = {
+    0x00, 0x49, 0x19, 0xa9, 0x2e, 0xd7, 0xb0, 0xf9,
+    0xe0, 0xce, 0x67, 0x7e, 0x9e, 0x37, 0x87, 0x50
+};
+
+/*
+ * S(x) in the standard basis, for the last round
+*/
+const uint8_t aes_vperm_sbou[16] = {
+    0x00, 0x7b, 0xb0, 0x3d, 0x67, 0x91, 0x8d, 0xf6,
+    0x46, 0x21, 0x1c, 0xac, 0xea, 0xd7, 0x5a, 0xcb
+};
+
+const uint8_t aes_vperm_sbot[16] = {
+    0x00, 0x64, 0x99, 0x12, 0xe5, 0x0a, 0x8b, 0xef,
+    0x76, 0x93, 0x81, 0x18, 0x6e, 0x7c, 0xf7, 0xfd
+};
+
+/*
+ * Standard byte to the basis of the inverse cipher state, split by nibble
+*/
+const uint8_t aes_vperm_dipt_lo[16] = {
+    0x00, 0xd5, 0x69, 0xbc, 0x19, 0xcc, 0x70, 0xa5,
+    0xa2, 0x77, 0xcb, 0x1e, 0xbb, 0x6e, 0xd2, 0x07
+};
+
+const uint8_t aes_vperm_dipt_hi[16] = {
+    0x00, 0x17, 0xe7, 0xf0, 0x6f, 0x78, 0x88, 0x9f,
+    0xb9, 0xae, 0x5e, 0x49, 0xd6, 0xc1, 0x31, 0x26
+};
+
+/*
+ * 9, 11, 13 and 14 times InvS(x) in the inverse cipher basis
+*/
+const uint8_t aes_vperm_dsb9u[16] = {
+    0x00, 0x2c, 0xa8, 0xf8, 0xdd, 0xa1, 0x50, 0x7c,
+    0xd4, 0x09, 0xf1, 0x59, 0x8d, 0x75, 0x25, 0x84
+};
+
+const uint8_t aes_vperm_dsb9t[16] = {
+    0x00, 0x5b, 0x9e, 0x40, 0x60, 0xe5, 0xde, 0x85,
+    0x1b, 0x7b, 0x3b, 0xa5, 0xbe, 0xfe, 0x20, 0xc5
+};
+
+const uint8_t aes_vperm_dsb11u[16] = {
+    0x00, 0x64, 0x0f, 0x1a, 0x07, 0x76, 0x15, 0x71,
+    0x7e, 0x79, 0x63, 0x6c, 0x12, 0x08, 0x1d, 0x6b
+};
+
+const uint8_t aes_vperm_dsb11t[16] = {
+    0x00, 0x7a, 0x0e, 0xc8, 0x52, 0xee, 0xc6, 0xbc,
+    0xb2, 0xe0, 0x28, 0x26, 0x94, 0x5c, 0x9a, 0x74
+};
+
+const uint8_t aes_vperm_dsb13u[16] = {
+    0x00, 0xc8, 0xc6, 0xee, 0x94, 0x74, 0x28, 0xe0,
+    0x26, 0xb2, 0x5c, 0x9a, 0xbc, 0x52, 0x7a, 0x0e
+};
+
+const uint8_t aes_vperm_dsb13t[16] = {
+    0x00, 0xa6, 0x8f, 0x96, 0x66, 0xd9, 0x19, 0xbf,
+    0x30, 0x56, 0xc0, 0x4f, 0x7f, 0xe9, 0xf0, 0x29
+};
+
+const uint8_t aes_vperm_dsb14u[16] = {
+    0x00, 0x1a, 0x15, 0x76, 0x12, 0x6b, 0x63, 0x79,
+    0x6c, 0x7e, 0x08, 0x1d, 0x71, 0x07, 0x64, 0x0f
+};
+
+const uint8_t aes_vperm_dsb14t[16] = {
+    0x00, 0xc8, 0xc6, 0xee, 0x94, 0x74, 0x28, 0xe0,
+    0x26, 0xb2, 0x5c, 0x9a, 0xbc, 0x52, 0x7a, 0x0e
+};
+
+/*
+ * InvS(x) in the standard basis, for the last round
+*/
+const uint8_t aes_vperm_dsbou[16] = {
+    0x00, 0xf3, 0xc8, 0xdc, 0x2c, 0xcb, 0x14, 0xe7,
+    0x2f, 0x03, 0xdf, 0x17, 0x38, 0xe4, 0xf0, 0x3b
+};
+
+const uint8_t aes_vperm_dsbot[16] = {
+    0x00, 0xf2, 0x99, 0x30, 0x9d, 0xc6, 0xa9, 0x5b,
+    0xc2, 0x5f, 0x6f, 0xf6, 0x34, 0x04, 0xad, 0x6b
+};
+
+/*
+ * Byte shuffles: (inverse) ShiftRows and rotations within each column
+*/
+const uint8_t aes_vperm_shift_rows[16] = {
+    0x00, 0x05, 0x0a, 0x0f, 0x04, 0x09, 0x0e, 0x03,
+    0x08, 0x0d, 0x02, 0x07, 0x0c, 0x01, 0x06, 0x0b
+};
+
+const uint8_t aes_vperm_inverse_shift_rows[16] = {
+    0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b,
+    0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03
+};
+
+const uint8_t aes_vperm_rotate_1[16] = {
+    0x01, 0x02, 0x03, 0x00, 0x05, 0x06, 0x07, 0x04,
+    0x09, 0x0a, 0x0b, 0x08, 0x0d, 0x0e, 0x0f, 0x0c
+};
+
+const uint8_t aes_vperm_rotate_2[16] = {
+    0x02, 0x03, 0x00, 0x01, 0x06, 0x07, 0x04, 0x05,
+    0x0a, 0x0b, 0x08, 0x09, 0x0e, 0x0f, 0x0c, 0x0d
+};
+
+/*
+ * struct aes_vperm
+ *
+ * uint8_t ekey[15][16] -- internal; encryption round keys, transformed
+ * uint8_t dkey[15][16] -- internal; decryption round keys, transformed
+ * size_t rounds        -- internal; 10, 12 or 14
+*/
+struct aes_vperm {
+    uint8_t ekey[15][16];
+    uint8_t dkey[15][16];
+    size_t rounds;
+};
+
+static inline int aes_vperm_supported()
+{
+    return __builtin_cpu_supports("ssse3");
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i aes_vperm_load(const uint8_t* data)
+{
+    return _mm_loadu_si128((const __m128i*) data);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i aes_vperm_lookup(const uint8_t* table, __m128i index)
+{
+    return _mm_shuffle_epi8(aes_vperm_load(table), index);
+}
+
+/*
+ * aes_vperm aes_vperm_transform
+ *
+ * Applies the linear map given by its low and high nibble tables to every
+ * byte of x.
+*/
+__attribute__((target("ssse3")))
+static inline __m128i aes_vperm_transform(__m128i x, const uint8_t* lo,
+        const uint8_t* hi)
+{
+    __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i l = _mm_and_si128(x, mask);
+    __m128i h = _mm_and_si128(_mm_srli_epi32(x, 4), mask);
+
+    return _mm_xor_si128(aes_vperm_lookup(lo, l), aes_vperm_lookup(hi, h));
+}
+
+/*
+ * aes_vperm aes_vperm_invert
+ *
+ * Computes the nibble pair (io, jo) describing the inverse of every byte of
+ * x; see the field representation above.
+*/
+__attribute__((target("ssse3")))
+static inline void aes_vperm_invert(__m128i x, __m128i* io, __m128i* jo)
+{
+    __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i k = _mm_and_si128(x, mask);
+    __m128i i = _mm_and_si128(_mm_srli_epi32(x, 4), mask);
+    __m128i j = _mm_xor_si128(i, k);
+    __m128i ak = aes_vperm_lookup(aes_vperm_inv_a, k);
+    __m128i iak = _mm_xor_si128(aes_vperm_lookup(aes_vperm_inv, i), ak);
+    __m128i jak = _mm_xor_si128(aes_vperm_lookup(aes_vperm_inv, j), ak);
+
+    *io = _mm_xor_si128(j, aes_vperm_lookup(aes_vperm_inv, iak));
+    *jo = _mm_xor_si128(i, aes_vperm_lookup(aes_vperm_inv, jak));
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i aes_vperm_permute(__m128i x, const uint8_t* order)
+{
+    return _mm_shuffle_epi8(x, aes_vperm_load(order));
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i aes_vperm_output(const uint8_t* u, const uint8_t* t,
+                                       __m128i io, __m128i jo)
+{
+    return _mm_xor_si128(aes_vperm_lookup(u, io), aes_vperm_lookup(t, jo));
+}
+
+static inline uint8_t aes_vperm_xtime(uint8_t b)
+{
+    return (uint8_t) ((b << 1) ^ (0x1b & -(b >> 7)));
+}
+
+/*
+ * aes_vperm aes_vperm_inverse_mix_column
+ *
+ * InvMixColumns on one column of a round key, used to build the keys of the
+ * equivalent inverse cipher (FIPS 197, section 5.3.5). Written without
+ * tables so that key setup does not leak the key through the cache.
+*/
+static inline void aes_vperm_inverse_mix_column(uint8_t* col)
+{
+    size_t r = 0;
+    uint8_t b[4];
+    uint8_t b2[4];
+    uint8_t b4[4];
+    uint8_t b8[4];
+
+    for (r = 0; r < 4; r++) {
+        b[r] = col[r];
+        b2[r] = aes_vperm_xtime(b[r]);
+        b4[r] = aes_vperm_xtime(b2[r]);
+        b8[r] = aes_vperm_xtime(b4[r]);
+    }
+
+    for (r = 0; r < 4; r++) {
+        uint8_t e = b8[r] ^ b4[r] ^ b2[r];
+        uint8_t x = b8[(r + 1) % 4] ^ b2[(r + 1) % 4] ^ b[(r + 1) % 4];
+        uint8_t d = b8[(r + 2) % 4] ^ b4[(r + 2) % 4] ^ b[(r + 2) % 4];
+        uint8_t n = b8[(r + 3) % 4] ^ b[(r + 3) % 4];
+
+        col[r] = e ^ x ^ d ^ n;
+    }
+}
+
+/*
+ * aes_vperm aes_vperm_init
+ *
+ * Transforms an expanded FIPS 197 key schedule (the skey member of struct
+ * aes128, aes192 or aes256) into the representation used by the
+ * vector-permute rounds. rounds is 10, 12 or 14 respectively.
+*/
+__attribute__((target("ssse3")))
+static inline void aes_vperm_init(struct aes_vperm* v, const uint32_t* skey,
+                                  size_t rounds)
+{
+    size_t r = 0;
+    size_t c = 0;
+    uint8_t rk[15][16];
+    __m128i sbox_constant = _mm_set1_epi8(0x63);
+    __m128i dec_constant = _mm_set1_epi8(0x34);
+    __m128i x;
+
+    v->rounds = rounds;
+
+    for (r = 0; r <= rounds; r++) {
+        for (c = 0; c < 4; c++) {
+            rk[r][4 * c + 0] = (uint8_t) (skey[4 * r + c] >> 24);
+            rk[r][4 * c + 1] = (uint8_t) (skey[4 * r + c] >> 16);
+            rk[r][4 * c + 2] = (uint8_t) (skey[4 * r + c] >>  8);
+            rk[r][4 * c + 3] = (uint8_t) (skey[4 * r + c] >>  0);
+        }
+    }
+
+    // Encryption: the first key is applied in the tower basis; the SubBytes
+    // constant of every following round is folded into the next key, and the
+    // last round produces standard byte order directly.
+    x = aes_vperm_transform(aes_vperm_load(rk[0]), aes_vperm_ipt_lo,
+                            aes_vperm_ipt_hi);
+    _mm_storeu_si128((__m128i*) v->ekey[0], x);
+
+    for (r = 1; r < rounds; r++) {
+        x = _mm_xor_si128(aes_vperm_load(rk[r]), sbox_constant);
+        x = aes_vperm_transform(x, aes_vperm_ipt_lo, aes_vperm_ipt_hi);
+        _mm_storeu_si128((__m128i*) v->ekey[r], x);
+    }
+
+    x = _mm_xor_si128(aes_vperm_load(rk[rounds]), sbox_constant);
+    _mm_storeu_si128((__m128i*) v->ekey[rounds], x);
+
+    // Decryption uses the equivalent inverse cipher. Between rounds the state
+    // is held as the input of the field inversion, i.e. the tower basis image
+    // of the inverse affine transform; its constant is 0x34.
+    x = aes_vperm_transform(aes_vperm_load(rk[rounds]), aes_vperm_dipt_lo,
+                            aes_vperm_dipt_hi);
+    _mm_storeu_si128((__m128i*) v->dkey[0], _mm_xor_si128(x, dec_constant));
+
+    for (r = 1; r < rounds; r++) {
+        for (c = 0; c < 4; c++) {
+            aes_vperm_inverse_mix_column(&(rk[rounds - r][4 * c]));
+        }
+
+        x = aes_vperm_transform(aes_vperm_load(rk[rounds - r]),
+                                aes_vperm_dipt_lo, aes_vperm_dipt_hi);
+        x = _mm_xor_si128(x, dec_constant);
+        _mm_storeu_si128((__m128i*) v->dkey[r], x);
+    }
+
+    _mm_storeu_si128((__m128i*) v->dkey[rounds], aes_vperm_load(rk[0]));
+}
+
+/*
+ * aes_vperm aes_vperm_encrypt
+ *
+ * Encrypts one 16-byte block from input into output; the two may alias.
+ *
+ * Each inner round is ShiftRows (one byte shuffle), the nibble inversion,
+ * four output lookups giving S and 2 * S, and MixColumns as
+ *
+ *     2 * a[r] ^ 3 * a[r + 1] ^ a[r + 2] ^ a[r + 3]
+ *
+ * built from rotations within each column.
+*/
+__attribute__((target("ssse3")))
+static inline void aes_vperm_encrypt(const struct aes_vperm* v,
+                                     const uint8_t input[16],
+                                     uint8_t output[16])
+{
+    size_t r = 0;
+    __m128i x = aes_vperm_load(input);
+    __m128i io;
+    __m128i jo;
+    __m128i s1;
+    __m128i s2;
+    __m128i s1r;
+
+    x = aes_vperm_transform(x, aes_vperm_ipt_lo, aes_vperm_ipt_hi);
+    x = _mm_xor_si128(x, aes_vperm_load(v->ekey[0]));
+
+    for (r = 1; r < v->rounds; r++) {
+        x = aes_vperm_permute(x, aes_vperm_shift_rows);
+        aes_vperm_invert(x, &io, &jo);
+
+        s1 = aes_vperm_output(aes_vperm_sb1u, aes_vperm_sb1t, io, jo);
+        s2 = aes_vperm_output(aes_vperm_sb2u, aes_vperm_sb2t, io, jo);
+        s1r = aes_vperm_permute(s1, aes_vperm_rotate_1);
+
+        x = _mm_xor_si128(s2, aes_vperm_load(v->ekey[r]));
+        x = _mm_xor_si128(x, aes_vperm_permute(_mm_xor_si128(s2, s1),
+                          aes_vperm_rotate_1));
+        x = _mm_xor_si128(x, aes_vperm_permute(_mm_xor_si128(s1, s1r),
+                          aes_vperm_rotate_2));
+    }
+
+    x = aes_vperm_permute(x, aes_vperm_shift_rows);
+    aes_vperm_invert(x, &io, &jo);
+    x = aes_vperm_output(aes_vperm_sbou, aes_vperm_sbot, io, jo);
+    x = _mm_xor_si128(x, aes_vperm_load(v->ekey[v->rounds]));
+
+    _mm_storeu_si128((__m128i*) output, x);
+}
+
+/*
+ * aes_vperm aes_vperm_decrypt
+ *
+ * Decrypts one 16-byte block from input into output; the two may alias.
+ *
+ * Uses the equivalent inverse cipher; InvMixColumns is evaluated as
+ *
+ *     14 * a[r] ^ rot(11 * a ^ rot(13 * a ^ rot(9 * a)))[r]
+ *
+ * where rot moves every byte up one row within its column.
+*/
+__attribute__((target("ssse3")))
+static inline void aes_vperm_decrypt(const struct aes_vperm* v,
+                                     const uint8_t input[16],
+                                     uint8_t output[16])
+{
+    size_t r = 0;
+    __m128i x = aes_vperm_load(input);
+    __m128i io;
+    __m128i jo;
+    __m128i m;
+
+    x = aes_vperm_transform(x, aes_vperm_dipt_lo, aes_vperm_dipt_hi);
+    x = _mm_xor_si128(x, aes_vperm_load(v->dkey[0]));
+
+    for (r = 1; r < v->rounds; r++) {
+        x = aes_vperm_permute(x, aes_vperm_inverse_shift_rows);
+        aes_vperm_invert(x, &io, &jo);
+
+        m = aes_vperm_output(aes_vperm_dsb9u, aes_vperm_dsb9t, io, jo);
+        m = aes_vperm_permute(m, aes_vperm_rotate_1);
+        m = _mm_xor_si128(m, aes_vperm_output(aes_vperm_dsb13u,
+                                              aes_vperm_dsb13t, io, jo));
+        m = aes_vperm_permute(m, aes_vperm_rotate_1);
+        m = _mm_xor_si128(m, aes_vperm_output(aes_vperm_dsb11u,
+                                              aes_vperm_dsb11t, io, jo));
+        m = aes_vperm_permute(m, aes_vperm_rotate_1);
+        m = _mm_xor_si128(m, aes_vperm_output(aes_vperm_dsb14u,
+                                              aes_vperm_dsb14t, io, jo));
+
+        x = _mm_xor_si128(m, aes_vperm_load(v->dkey[r]));
+    }
+
+    x = aes_vperm_permute(x, aes_vperm_inverse_shift_rows);
+    aes_vperm_invert(x, &io, &jo);
+    x = aes_vperm_output(aes_vperm_dsbou, aes_vperm_dsbot, io, jo);
+    x = _mm_xor_si128(x, aes_vperm_load(v->dkey[v->rounds]));
+
+    _mm_storeu_si128((__m128i*) output, x);
+}
+
+#endif // x86 && GNUC
+
+#endif
@@ -7,8 +7,11 @@
 #include "aes128.h"
 #include "aes192.h"
 #include "aes256.h"
+#include "aes_vperm.h"
 #include "stdio.h"
 #include "inttypes.h"
+#include "string.h"
+#include "time.h"
 
 void test_aes128_key_expansion()
 {
@@ -168,6 +171,101 @@ void test_aes256_encrypt()
     printf("\n\n");
 }
 
+#ifdef CC_AES_VPERM
+void test_aes_vperm_encrypt()
+{
+    struct aes128 a128;
+    struct aes192 a192;
+    struct aes256 a256;
+    struct aes_vperm v;
+    uint8_t plaintext[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    uint8_t ciphertext[3][16] = {{0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a}, {0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91}, {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89}};
+    uint8_t key[32] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+    uint8_t block[16];
+
+    if (!aes_vperm_supported()) {
+        printf("SSSE3 not supported; skipping.\n\n");
+        return;
+    }
+
+    aes128_init(&a128, key);
+    aes192_init(&a192, key);
+    aes256_init(&a256, key);
+
+    for (size_t t = 0; t < 3; t++) {
+        if (t == 0) {
+            aes_vperm_init(&v, a128.skey, 10);
+        } else if (t == 1) {
+            aes_vperm_init(&v, a192.skey, 12);
+        } else {
+            aes_vperm_init(&v, a256.skey, 14);
+        }
+
+        aes_vperm_encrypt(&v, plaintext, block);
+
+        printf("Encrypt (%zu rounds): \n", v.rounds);
+        printf("Actual:   ");
+        for (size_t i = 0; i < 16; i++) {
+            printf("%02x", block[i]);
+        }
+        printf("\n");
+
+        printf("Expected: ");
+        for (size_t i = 0; i < 16; i++) {
+            printf("%02x", ciphertext[t][i]);
+        }
+        printf("\n\n");
+
+        aes_vperm_decrypt(&v, ciphertext[t], block);
+
+        printf("Decrypt (%zu rounds): \n", v.rounds);
+        printf("Actual:   ");
+        for (size_t i = 0; i < 16; i++) {
+            printf("%02x", block[i]);
+        }
+        printf("\n");
+
+        printf("Expected: ");
+        for (size_t i = 0; i < 16; i++) {
+            printf("%02x", plaintext[i]);
+        }
+        printf("\n\n");
+    }
+}
+
+void benchmark_aes_vperm()
+{
+    struct aes128 a;
+    struct aes_vperm v;
+    uint8_t key[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+    uint8_t block[16] = {0};
+    clock_t start;
+    size_t i = 0;
+
+    if (!aes_vperm_supported()) {
+        return;
+    }
+
+    aes128_init(&a, key);
+    aes_vperm_init(&v, a.skey, 10);
+
+    start = clock();
+    for (i = 0; i < 1024 * 1024; i++) {
+        aes128_encrypt(&a, block);
+        memcpy(block, a.block, 16);
+    }
+    printf("Benchmark: 16MB aes128 table:  %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < 1024 * 1024; i++) {
+        aes_vperm_encrypt(&v, block, block);
+    }
+    printf("Benchmark: 16MB aes128 vperm:  %f seconds\n\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+#endif
+
 int main()
 {
     printf("Expanding 128-bit key: \n");
@@ -188,5 +286,11 @@ int main()
     printf("Testing 256-bit encryption/decryption: \n");
     test_aes256_encrypt();
 
+#ifdef CC_AES_VPERM
+    printf("Testing vector-permute encryption/decryption: \n");
+    test_aes_vperm_encrypt();
+    benchmark_aes_vperm();
+#endif
+
     return 0;
 }
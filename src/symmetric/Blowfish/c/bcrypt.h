@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Implementation of the bcrypt password hashing function per Provos and
+ * Mazieres, "A Future-Adaptable Password Scheme", producing and checking
+ * OpenBSD "$2b$" modular crypt strings. See docs for the specification.
+ *
+ * bcrypt is built on the EksBlowfish key schedule, which runs the Blowfish
+ * key expansion 2^cost times over a struct blowfish. "$2a$" and "$2y$"
+ * hashes are accepted as well; they only differ from "$2b$" for passwords
+ * longer than 255 bytes, which all three truncate to 72 bytes here.
+ *
+ * The thread pool (struct bcrypt_pool) and bcrypt_verify_batch need POSIX
+ * threads; link with -pthread.
+*/
+
+#pragma once
+#ifndef CC_BCRYPT_H
+#define CC_BCRYPT_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "pthread.h"
+#include "blowfish.h"
+
+#define BCRYPT_HASH_SIZE 61
+
+/*
+ * Constants for bcrypt: the alphabet of its base64 variant and the text
+ * encrypted 64 times with the expanded state
+*/
+const char bcrypt_base64[65] =
+    "./ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+const uint8_t bcrypt_ciphertext[24] = "OrpheanBeholderScryDoubt";
+
+/*
+ * bcrypt bcrypt_stream_words
+ *
+ * Fills words[0..count) with big-endian 32-bit words read cyclically from
+ * data, as the Blowfish key schedule consumes its key.
+*/
+extern inline void bcrypt_stream_words(uint32_t* words, size_t count,
+                                       const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+    size_t b = 0;
+    size_t k = 0;
+
+    for (i = 0; i < count; i++) {
+        words[i] = 0;
+        for (b = 0; b < 4; b++) {
+            words[i] = (words[i] << 8) | data[k];
+            k = (k + 1) % len;
+        }
+    }
+}
+
+/*
+ * bcrypt bcrypt_expand
+ *
+ * ExpandKey(state, 0, key): xors the key words into P and re-derives P and
+ * the S-boxes by chaining Blowfish encryptions from a zero block. This is
+ * the loop that runs 2^(cost + 1) times, so the key is passed pre-expanded
+ * to the 18 words xored into P and the state is updated in place.
+*/
+extern inline void bcrypt_expand(struct blowfish* bf, const uint32_t* key)
+{
+    size_t i = 0;
+    uint32_t left = 0;
+    uint32_t right = 0;
+
+    for (i = 0; i < 18; i++) {
+        bf->P[i] = bf->P[i] ^ key[i];
+    }
+
+    for (i = 0; i < 18; i += 2) {
+        blowfish_encrypt(bf, &left, &right);
+        bf->P[i + 0] = left;
+        bf->P[i + 1] = right;
+    }
+
+    for (i = 0; i < 1024; i += 2) {
+        blowfish_encrypt(bf, &left, &right);
+        bf->S[i + 0] = left;
+        bf->S[i + 1] = right;
+    }
+}
+
+/*
+ * bcrypt bcrypt_expand_salted
+ *
+ * ExpandKey(state, salt, key): as bcrypt_expand, but each block is xored
+ * with the alternating halves of the 128-bit salt (four words) before it is
+ * encrypted.
+*/
+extern inline void bcrypt_expand_salted(struct blowfish* bf,
+                                        const uint32_t* key,
+                                        const uint32_t* salt)
+{
+    size_t i = 0;
+    size_t s = 0;
+    uint32_t left = 0;
+    uint32_t right = 0;
+
+    for (i = 0; i < 18; i++) {
+        bf->P[i] = bf->P[i] ^ key[i];
+    }
+
+    for (i = 0; i < 18; i += 2) {
+        left = left ^ salt[s + 0];
+        right = right ^ salt[s + 1];
+        s = s ^ 2;
+        blowfish_encrypt(bf, &left, &right);
+        bf->P[i + 0] = left;
+        bf->P[i + 1] = right;
+    }
+
+    for (i = 0; i < 1024; i += 2) {
+        left = left ^ salt[s + 0];
+        right = right ^ salt[s + 1];
+        s = s ^ 2;
+        blowfish_encrypt(bf, &left, &right);
+        bf->S[i + 0] = left;
+        bf->S[i + 1] = right;
+    }
+}
+
+/*
+ * bcrypt bcrypt_setup
+ *
+ * EksBlowfishSetup: derives the expensive key schedule for the given cost
+ * (4 to 31), 16-byte salt and key bytes (at most 72 are used).
+*/
+extern inline void bcrypt_setup(struct blowfish* bf, unsigned cost,
+                                const uint8_t* salt, const uint8_t* key,
+                                size_t key_len)
+{
+    size_t i = 0;
+    uint64_t rounds = (uint64_t) 1 << cost;
+    uint64_t n = 0;
+    uint32_t key_words[18];
+    uint32_t salt_words[18];
+
+    if (key_len > 72) {
+        key_len = 72;
+    }
+
+    bcrypt_stream_words(key_words, 18, key, key_len);
+    bcrypt_stream_words(salt_words, 18, salt, 16);
+
+    for (i = 0; i < 18; i++) {
+        bf->P[i] = blowfish_initial_subkeys[i];
+    }
+    for (i = 0; i < 1024; i++) {
+        bf->S[i] = blowfish_initial_sbox[i];
+    }
+
+    bcrypt_expand_salted(bf, key_words, salt_words);
+
+    for (n = 0; n < rounds; n++) {
+        bcrypt_expand(bf, key_words);
+        bcrypt_expand(bf, salt_words);
+    }
+}
+
+/*
+ * bcrypt bcrypt_encode
+ *
+ * Writes len bytes of data in bcrypt's base64 (no padding) to output,
+ * followed by a terminating zero; returns the number of characters.
+*/
+extern inline size_t bcrypt_encode(char* output, const uint8_t* data,
+                                   size_t len)
+{
+    size_t i = 0;
+    size_t o = 0;
+    uint32_t bits = 0;
+
+    for (i = 0; i < len; i += 3) {
+        bits = (uint32_t) data[i] << 16;
+        if (i + 1 < len) {
+            bits = bits | ((uint32_t) data[i + 1] << 8);
+        }
+        if (i + 2 < len) {
+            bits = bits | data[i + 2];
+        }
+
+        output[o++] = bcrypt_base64[(bits >> 18) & 0x3f];
+        output[o++] = bcrypt_base64[(bits >> 12) & 0x3f];
+        if (i + 1 < len) {
+            output[o++] = bcrypt_base64[(bits >> 6) & 0x3f];
+        }
+        if (i + 2 < len) {
+            output[o++] = bcrypt_base64[bits & 0x3f];
+        }
+    }
+
+    output[o] = '\0';
+    return o;
+}
+
+/*
+ * bcrypt bcrypt_decode
+ *
+ * Reads len bytes of data from bcrypt's base64 in input; returns 0 if input
+ * contains a character outside the alphabet or ends early, 1 otherwise.
+*/
+extern inline int bcrypt_decode(uint8_t* data, size_t len, const char* input)
+{
+    size_t i = 0;
+    size_t c = 0;
+    size_t chars = (len * 4 + 2) / 3;
+    uint32_t bits = 0;
+    const char* pos = NULL;
+
+    for (c = 0; c < chars; c++) {
+        if (input[c] == '\0') {
+            return 0;
+        }
+
+        pos = strchr(bcrypt_base64, input[c]);
+        if (pos == NULL) {
+            return 0;
+        }
+
+        bits = (bits << 6) | (uint32_t) (pos - bcrypt_base64);
+        if (c % 4 == 3) {
+            data[i++] = (uint8_t) (bits >> 16);
+            data[i++] = (uint8_t) (bits >> 8);
+            data[i++] = (uint8_t) bits;
+            bits = 0;
+        }
+    }
+
+    if (c % 4 == 2) {
+        data[i++] = (uint8_t) (bits >> 4);
+    } else if (c % 4 == 3) {
+        data[i++] = (uint8_t) (bits >> 10);
+        data[i++] = (uint8_t) (bits >> 2);
+    }
+
+    return 1;
+}
+
+/*
+ * bcrypt bcrypt_hash
+ *
+ * Hashes the zero-terminated password with the given cost (4 to 31) and
+ * 16-byte salt, writing the "$2b$" string (BCRYPT_HASH_SIZE bytes including
+ * the terminator) to output. Returns 0 if cost is out of range.
+*/
+extern inline int bcrypt_hash(const char* password, unsigned cost,
+                              const uint8_t* salt, char* output)
+{
+    struct blowfish bf;
+    size_t i = 0;
+    uint32_t text[6];
+    uint8_t digest[24];
+
+    if (cost < 4 || cost > 31) {
+        return 0;
+    }
+
+    // The key includes the terminating zero of the password.
+    bcrypt_setup(&bf, cost, salt, (const uint8_t*) password,
+                 strlen(password) + 1);
+
+    bcrypt_stream_words(text, 6, bcrypt_ciphertext, 24);
+    for (i = 0; i < 64; i++) {
+        blowfish_encrypt_blocks(&bf, text, 3);
+    }
+
+    for (i = 0; i < 6; i++) {
+        digest[4 * i + 0] = (uint8_t) (text[i] >> 24);
+        digest[4 * i + 1] = (uint8_t) (text[i] >> 16);
+        digest[4 * i + 2] = (uint8_t) (text[i] >> 8);
+        digest[4 * i + 3] = (uint8_t) (text[i] >> 0);
+    }
+
+    output[0] = '$';
+    output[1] = '2';
+    output[2] = 'b';
+    output[3] = '$';
+    output[4] = (char) ('0' + cost / 10);
+    output[5] = (char) ('0' + cost % 10);
+    output[6] = '$';
+    bcrypt_encode(output + 7, salt, 16);
+    bcrypt_encode(output + 29, digest, 23);
+
+    memset(&bf, 0, sizeof(bf));
+    memset(digest, 0, sizeof(digest));
+
+    return 1;
+}
+
+/*
+ * bcrypt bcrypt_verify
+ *
+ * Returns 1 if password matches the "$2a$", "$2b$" or "$2y$" string hash, 0
+ * if it does not or hash is malformed. Everything after the version, cost
+ * and salt included, is compared in constant time against the re-encoded
+ * result, so a salt whose last character carries non-canonical low bits is
+ * rejected, as OpenBSD and libxcrypt do.
+*/
+extern inline int bcrypt_verify(const char* password, const char* hash)
+{
+    size_t i = 0;
+    unsigned cost = 0;
+    uint8_t salt[16];
+    char computed[BCRYPT_HASH_SIZE];
+    uint8_t diff = 0;
+
+    if (strlen(hash) != BCRYPT_HASH_SIZE - 1 || hash[0] != '$' ||
+            hash[1] != '2' || strchr("aby", hash[2]) == NULL ||
+            hash[3] != '$' || hash[4] < '0' || hash[4] > '9' ||
+            hash[5] < '0' || hash[5] > '9' || hash[6] != '$') {
+        return 0;
+    }
+
+    cost = (unsigned) (hash[4] - '0') * 10 + (unsigned) (hash[5] - '0');
+    if (!bcrypt_decode(salt, 16, hash + 7) ||
+            !bcrypt_hash(password, cost, salt, computed)) {
+        return 0;
+    }
+
+    // computed always says "$2b$"; the version was checked above.
+    for (i = 4; i < BCRYPT_HASH_SIZE - 1; i++) {
+        diff = diff | (uint8_t) (computed[i] ^ hash[i]);
+    }
+
+    return diff == 0;
+}
+
+/*
+ * struct bcrypt_pool
+ *
+ * pthread_t* workers   -- internal; threads started by bcrypt_pool_init
+ * size_t threads       -- internal; number of workers
+ * pthread_mutex_t lock -- internal; guards the fields below
+ * pthread_cond_t work  -- internal; signalled on a new batch or shutdown
+ * pthread_cond_t done  -- internal; signalled when a batch completes
+ * passwords, hashes,   -- internal; the current batch
+ * results, count
+ * size_t next          -- internal; next pair to hand out
+ * size_t finished      -- internal; pairs checked so far
+ * generation           -- internal; number of batches submitted
+ * int stop             -- internal; set by bcrypt_pool_destroy
+*/
+struct bcrypt_pool {
+    pthread_t* workers;
+    size_t threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    const char* const* passwords;
+    const char* const* hashes;
+    int* results;
+    size_t count;
+    size_t next;
+    size_t finished;
+    unsigned long generation;
+    int stop;
+};
+
+/*
+ * bcrypt_pool bcrypt_pool_run
+ *
+ * Checks pairs of the current batch until none are left to hand out. Called
+ * and returns with pool->lock held, dropping it around each bcrypt_verify.
+*/
+extern inline void bcrypt_pool_run(struct bcrypt_pool* pool)
+{
+    size_t i = 0;
+    int result = 0;
+
+    while (pool->next < pool->count) {
+        i = pool->next;
+        pool->next = pool->next + 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        result = bcrypt_verify(pool->passwords[i], pool->hashes[i]);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->results[i] = result;
+        pool->finished = pool->finished + 1;
+        if (pool->finished == pool->count) {
+            pthread_cond_broadcast(&pool->done);
+        }
+    }
+}
+
+extern inline void* bcrypt_pool_worker(void* arg)
+{
+    struct bcrypt_pool* pool = (struct bcrypt_pool*) arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+
+        if (pool->stop) {
+            break;
+        }
+
+        seen = pool->generation;
+        bcrypt_pool_run(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/*
+ * bcrypt_pool bcrypt_pool_init
+ *
+ * Starts a pool that checks batches on up to threads threads, including the
+ * thread calling bcrypt_pool_submit; the workers sleep between batches.
+ * Returns 1 on success, 0 if the lock or condition variables could not be
+ * created. If fewer workers can be started, the remaining ones (at least
+ * the caller) still complete each batch.
+*/
+extern inline int bcrypt_pool_init(struct bcrypt_pool* pool, size_t threads)
+{
+    size_t i = 0;
+
+    pool->workers = NULL;
+    pool->threads = 0;
+    pool->passwords = NULL;
+    pool->hashes = NULL;
+    pool->results = NULL;
+    pool->count = 0;
+    pool->next = 0;
+    pool->finished = 0;
+    pool->generation = 0;
+    pool->stop = 0;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return 0;
+    }
+    if (pthread_cond_init(&pool->work, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        return 0;
+    }
+    if (pthread_cond_init(&pool->done, NULL) != 0) {
+        pthread_cond_destroy(&pool->work);
+        pthread_mutex_destroy(&pool->lock);
+        return 0;
+    }
+
+    if (threads > 1) {
+        pool->workers = (pthread_t*) malloc((threads - 1) *
+                                            sizeof(pthread_t));
+    }
+
+    for (i = 0; pool->workers != NULL && i < threads - 1; i++) {
+        if (pthread_create(&pool->workers[pool->threads], NULL,
+                           bcrypt_pool_worker, pool) == 0) {
+            pool->threads++;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * bcrypt_pool bcrypt_pool_submit
+ *
+ * Runs bcrypt_verify(passwords[i], hashes[i]) into results[i] for each of
+ * the count pairs and returns when all are done. The caller works on the
+ * batch too. Each thread takes the next unchecked pair from the shared
+ * queue, so uneven costs balance out. One batch runs at a time: do not
+ * submit to the same pool from several threads at once.
+*/
+extern inline void bcrypt_pool_submit(struct bcrypt_pool* pool,
+                                      const char* const* passwords,
+                                      const char* const* hashes,
+                                      int* results, size_t count)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->passwords = passwords;
+    pool->hashes = hashes;
+    pool->results = results;
+    pool->count = count;
+    pool->next = 0;
+    pool->finished = 0;
+    pool->generation = pool->generation + 1;
+    pthread_cond_broadcast(&pool->work);
+
+    bcrypt_pool_run(pool);
+    while (pool->finished < pool->count) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * bcrypt_pool bcrypt_pool_destroy
+ *
+ * Stops and joins the workers and releases the pool.
+*/
+extern inline void bcrypt_pool_destroy(struct bcrypt_pool* pool)
+{
+    size_t i = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->threads; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    free(pool->workers);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/*
+ * bcrypt bcrypt_verify_batch
+ *
+ * Checks a single batch as bcrypt_pool_submit does, on a pool of up to
+ * threads threads that is started and stopped around it. Callers with
+ * several batches should keep a struct bcrypt_pool instead. If the pool
+ * cannot be created, the caller checks every pair itself.
+*/
+extern inline void bcrypt_verify_batch(const char* const* passwords,
+                                       const char* const* hashes,
+                                       int* results, size_t count,
+                                       size_t threads)
+{
+    struct bcrypt_pool pool;
+    size_t i = 0;
+
+    if (threads > count) {
+        threads = count;
+    }
+
+    if (!bcrypt_pool_init(&pool, threads)) {
+        for (i = 0; i < count; i++) {
+            results[i] = bcrypt_verify(passwords[i], hashes[i]);
+        }
+        return;
+    }
+
+    bcrypt_pool_submit(&pool, passwords, hashes, results, count);
+    bcrypt_pool_destroy(&pool);
+}
+
+#endif
@@ -228,7 +228,8 @@ struct blowfish {
  * Divide xL into four eight-bit quarters: a, b, c, and d
  * F(xL) = ((S1,a + S2,b mod 2^32) XOR S3,c) + S4,d mod 2^32
 */
-extern inline uint32_t blowfish_feistel(struct blowfish* bf, uint32_t value)
+extern inline uint32_t blowfish_feistel(const struct blowfish* bf,
+                                        uint32_t value)
 {
     uint8_t a = value >> 24;
     uint8_t b = value >> 16;
@@ -260,22 +261,34 @@ extern inline uint32_t blowfish_feistel(struct blowfish* bf, uint32_t value)
  * xL = xL XOR P18
  * Recombine xL and xR
 */
-extern inline void blowfish_encrypt(struct blowfish* bf, uint32_t* left,
-                                    uint32_t* right)
+extern inline void blowfish_encrypt(const struct blowfish* bf,
+                                    uint32_t* left, uint32_t* right)
 {
-    size_t i = 0;
-    uint32_t tmp = 0;
-    for (i = 0; i < 16; i++) {
-        *left = (*left) ^ bf->P[i];
-        tmp = blowfish_feistel(bf, *left) ^ (*right);
-        *right = *left;
-        *left = tmp;
-    }
-    tmp = *right;
-    *right = *left;
-    *left = tmp;
-    *right = (*right) ^ bf->P[16];
-    *left = (*left) ^ bf->P[17];
+    const uint32_t* P = bf->P;
+    uint32_t l = (*left) ^ P[0];
+    uint32_t r = *right;
+
+    // Each line is one round: the P xor of the next round is folded into the
+    // half being updated, so the swap is implicit in alternating l and r.
+    r = r ^ blowfish_feistel(bf, l) ^ P[1];
+    l = l ^ blowfish_feistel(bf, r) ^ P[2];
+    r = r ^ blowfish_feistel(bf, l) ^ P[3];
+    l = l ^ blowfish_feistel(bf, r) ^ P[4];
+    r = r ^ blowfish_feistel(bf, l) ^ P[5];
+    l = l ^ blowfish_feistel(bf, r) ^ P[6];
+    r = r ^ blowfish_feistel(bf, l) ^ P[7];
+    l = l ^ blowfish_feistel(bf, r) ^ P[8];
+    r = r ^ blowfish_feistel(bf, l) ^ P[9];
+    l = l ^ blowfish_feistel(bf, r) ^ P[10];
+    r = r ^ blowfish_feistel(bf, l) ^ P[11];
+    l = l ^ blowfish_feistel(bf, r) ^ P[12];
+    r = r ^ blowfish_feistel(bf, l) ^ P[13];
+    l = l ^ blowfish_feistel(bf, r) ^ P[14];
+    r = r ^ blowfish_feistel(bf, l) ^ P[15];
+    l = l ^ blowfish_feistel(bf, r) ^ P[16];
+
+    *left = r ^ P[17];
+    *right = l;
 }
 
 /*
@@ -286,22 +299,178 @@ extern inline void blowfish_encrypt(struct blowfish* bf, uint32_t* left,
  * Decryption is exactly the same as encryption, except that P1, P2,..., P18
  * are used in the reverse order.
 */
-extern inline void blowfish_decrypt(struct blowfish* bf, uint32_t* left,
-                                    uint32_t* right)
+extern inline void blowfish_decrypt(const struct blowfish* bf,
+                                    uint32_t* left, uint32_t* right)
 {
+    const uint32_t* P = bf->P;
+    uint32_t l = (*left) ^ P[17];
+    uint32_t r = *right;
+
+    r = r ^ blowfish_feistel(bf, l) ^ P[16];
+    l = l ^ blowfish_feistel(bf, r) ^ P[15];
+    r = r ^ blowfish_feistel(bf, l) ^ P[14];
+    l = l ^ blowfish_feistel(bf, r) ^ P[13];
+    r = r ^ blowfish_feistel(bf, l) ^ P[12];
+    l = l ^ blowfish_feistel(bf, r) ^ P[11];
+    r = r ^ blowfish_feistel(bf, l) ^ P[10];
+    l = l ^ blowfish_feistel(bf, r) ^ P[9];
+    r = r ^ blowfish_feistel(bf, l) ^ P[8];
+    l = l ^ blowfish_feistel(bf, r) ^ P[7];
+    r = r ^ blowfish_feistel(bf, l) ^ P[6];
+    l = l ^ blowfish_feistel(bf, r) ^ P[5];
+    r = r ^ blowfish_feistel(bf, l) ^ P[4];
+    l = l ^ blowfish_feistel(bf, r) ^ P[3];
+    r = r ^ blowfish_feistel(bf, l) ^ P[2];
+    l = l ^ blowfish_feistel(bf, r) ^ P[1];
+
+    *left = r ^ P[0];
+    *right = l;
+}
+
+/*
+ * blowfish blowfish_encrypt4
+ *
+ * Encrypts four independent blocks in place; left[j] and right[j] are the
+ * halves of block j. The rounds of the four blocks are interleaved, so the
+ * S-box loads of one block overlap with those of the others rather than
+ * each round waiting on the previous one.
+*/
+extern inline void blowfish_encrypt4(const struct blowfish* bf,
+                                     uint32_t* left, uint32_t* right)
+{
+    const uint32_t* P = bf->P;
+    uint32_t l0 = left[0] ^ P[0];
+    uint32_t l1 = left[1] ^ P[0];
+    uint32_t l2 = left[2] ^ P[0];
+    uint32_t l3 = left[3] ^ P[0];
+    uint32_t r0 = right[0];
+    uint32_t r1 = right[1];
+    uint32_t r2 = right[2];
+    uint32_t r3 = right[3];
     size_t i = 0;
-    uint32_t tmp = 0;
-    for (i = 17; i > 1; i--) {
-        *left = (*left) ^ bf->P[i];
-        tmp = blowfish_feistel(bf, *left) ^ (*right);
-        *right = *left;
-        *left = tmp;
+
+    for (i = 1; i < 17; i += 2) {
+        r0 = r0 ^ blowfish_feistel(bf, l0) ^ P[i];
+        r1 = r1 ^ blowfish_feistel(bf, l1) ^ P[i];
+        r2 = r2 ^ blowfish_feistel(bf, l2) ^ P[i];
+        r3 = r3 ^ blowfish_feistel(bf, l3) ^ P[i];
+
+        l0 = l0 ^ blowfish_feistel(bf, r0) ^ P[i + 1];
+        l1 = l1 ^ blowfish_feistel(bf, r1) ^ P[i + 1];
+        l2 = l2 ^ blowfish_feistel(bf, r2) ^ P[i + 1];
+        l3 = l3 ^ blowfish_feistel(bf, r3) ^ P[i + 1];
+    }
+
+    left[0] = r0 ^ P[17];
+    left[1] = r1 ^ P[17];
+    left[2] = r2 ^ P[17];
+    left[3] = r3 ^ P[17];
+    right[0] = l0;
+    right[1] = l1;
+    right[2] = l2;
+    right[3] = l3;
+}
+
+/*
+ * blowfish blowfish_decrypt4
+ *
+ * Decrypts four independent blocks in place; see blowfish_encrypt4.
+*/
+extern inline void blowfish_decrypt4(const struct blowfish* bf,
+                                     uint32_t* left, uint32_t* right)
+{
+    const uint32_t* P = bf->P;
+    uint32_t l0 = left[0] ^ P[17];
+    uint32_t l1 = left[1] ^ P[17];
+    uint32_t l2 = left[2] ^ P[17];
+    uint32_t l3 = left[3] ^ P[17];
+    uint32_t r0 = right[0];
+    uint32_t r1 = right[1];
+    uint32_t r2 = right[2];
+    uint32_t r3 = right[3];
+    size_t i = 0;
+
+    for (i = 16; i > 0; i -= 2) {
+        r0 = r0 ^ blowfish_feistel(bf, l0) ^ P[i];
+        r1 = r1 ^ blowfish_feistel(bf, l1) ^ P[i];
+        r2 = r2 ^ blowfish_feistel(bf, l2) ^ P[i];
+        r3 = r3 ^ blowfish_feistel(bf, l3) ^ P[i];
+
+        l0 = l0 ^ blowfish_feistel(bf, r0) ^ P[i - 1];
+        l1 = l1 ^ blowfish_feistel(bf, r1) ^ P[i - 1];
+        l2 = l2 ^ blowfish_feistel(bf, r2) ^ P[i - 1];
+        l3 = l3 ^ blowfish_feistel(bf, r3) ^ P[i - 1];
+    }
+
+    left[0] = r0 ^ P[0];
+    left[1] = r1 ^ P[0];
+    left[2] = r2 ^ P[0];
+    left[3] = r3 ^ P[0];
+    right[0] = l0;
+    right[1] = l1;
+    right[2] = l2;
+    right[3] = l3;
+}
+
+/*
+ * blowfish blowfish_encrypt_blocks
+ *
+ * Encrypts count blocks in place. data holds the halves of each block in
+ * turn (left, right, left, right, ...); blocks are processed four at a time
+ * with blowfish_encrypt4.
+*/
+extern inline void blowfish_encrypt_blocks(const struct blowfish* bf,
+        uint32_t* data, size_t count)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint32_t left[4];
+    uint32_t right[4];
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        for (j = 0; j < 4; j++) {
+            left[j] = data[2 * (i + j) + 0];
+            right[j] = data[2 * (i + j) + 1];
+        }
+
+        blowfish_encrypt4(bf, left, right);
+
+        for (j = 0; j < 4; j++) {
+            data[2 * (i + j) + 0] = left[j];
+            data[2 * (i + j) + 1] = right[j];
+        }
+    }
+
+    for (; i < count; i++) {
+        blowfish_encrypt(bf, &data[2 * i + 0], &data[2 * i + 1]);
+    }
+}
+
+extern inline void blowfish_decrypt_blocks(const struct blowfish* bf,
+        uint32_t* data, size_t count)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint32_t left[4];
+    uint32_t right[4];
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        for (j = 0; j < 4; j++) {
+            left[j] = data[2 * (i + j) + 0];
+            right[j] = data[2 * (i + j) + 1];
+        }
+
+        blowfish_decrypt4(bf, left, right);
+
+        for (j = 0; j < 4; j++) {
+            data[2 * (i + j) + 0] = left[j];
+            data[2 * (i + j) + 1] = right[j];
+        }
+    }
+
+    for (; i < count; i++) {
+        blowfish_decrypt(bf, &data[2 * i + 0], &data[2 * i + 1]);
     }
-    tmp = *right;
-    *right = *left;
-    *left = tmp;
-    *right = (*right) ^ bf->P[1];
-    *left = (*left) ^ bf->P[0];
 }
 
 /*
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Eight-lane AVX2 implementation of the blowfish encryption algorithm, for
+ * bulk ECB, CTR and CBC decryption.
+ *
+ * Each 256-bit register holds one half of eight independent blocks, and two
+ * such groups are processed together. The F function is four vpgatherdd
+ * lookups into the regular S[1024] layout of struct blowfish, followed by
+ * the add, xor, add of the scalar code, so the key schedule from
+ * blowfish_init (or a snapshot) is used unchanged.
+ *
+ * The bulk functions below select the AVX2 path at runtime and otherwise,
+ * and for the blocks left over after the last group of sixteen, fall back to
+ * the four-way interleaved blowfish_encrypt_blocks and
+ * blowfish_decrypt_blocks; they can be called on any host. CC_BLOWFISH_AVX2
+ * is defined when the AVX2 path is built (x86 with GCC or Clang).
+ *
+ * The byte-oriented modes read and write blocks big-endian, left half
+ * first, as most other blowfish implementations do.
+*/
+
+#pragma once
+#ifndef CC_BLOWFISH_AVX2_H
+#define CC_BLOWFISH_AVX2_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "blowfish.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_BLOWFISH_AVX2 1
+
+#include "immintrin.h"
+
+/*
+ * blowfish_avx2 blowfish_avx2_feistel
+ *
+ * The F function on eight lanes at once.
+*/
+__attribute__((target("avx2")))
+extern inline __m256i blowfish_avx2_feistel(const struct blowfish* bf,
+        __m256i value)
+{
+    const int* S = (const int*) bf->S;
+    __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i a = _mm256_srli_epi32(value, 24);
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(value, 16), mask);
+    __m256i c = _mm256_and_si256(_mm256_srli_epi32(value, 8), mask);
+    __m256i d = _mm256_and_si256(value, mask);
+    __m256i sa = _mm256_i32gather_epi32(S, a, 4);
+    __m256i sb = _mm256_i32gather_epi32(S + 256, b, 4);
+    __m256i sc = _mm256_i32gather_epi32(S + 512, c, 4);
+    __m256i sd = _mm256_i32gather_epi32(S + 768, d, 4);
+
+    return _mm256_add_epi32(_mm256_xor_si256(_mm256_add_epi32(sa, sb), sc),
+                            sd);
+}
+
+/*
+ * blowfish_avx2 blowfish_avx2_crypt16
+ *
+ * Encrypts (decrypt = 0) or decrypts sixteen blocks in place: left[j] and
+ * right[j] hold the halves of eight blocks each. The two groups are
+ * interleaved round by round so that the gathers of one overlap with those
+ * of the other; a single group of eight leaves the gather latency exposed.
+*/
+__attribute__((target("avx2")))
+extern inline void blowfish_avx2_crypt16(const struct blowfish* bf,
+        __m256i* left, __m256i* right,
+        int decrypt)
+{
+    const uint32_t* P = bf->P;
+    size_t first = decrypt ? 17 : 0;
+    size_t last = decrypt ? 0 : 17;
+    size_t i = 0;
+    size_t j = 0;
+    __m256i l[2];
+    __m256i r[2];
+    __m256i k;
+
+    for (j = 0; j < 2; j++) {
+        l[j] = _mm256_xor_si256(left[j], _mm256_set1_epi32(P[first]));
+        r[j] = right[j];
+    }
+
+    for (i = 1; i < 17; i += 2) {
+        k = _mm256_set1_epi32(P[decrypt ? 17 - i : i]);
+        for (j = 0; j < 2; j++) {
+            r[j] = _mm256_xor_si256(r[j], blowfish_avx2_feistel(bf, l[j]));
+            r[j] = _mm256_xor_si256(r[j], k);
+        }
+
+        k = _mm256_set1_epi32(P[decrypt ? 16 - i : i + 1]);
+        for (j = 0; j < 2; j++) {
+            l[j] = _mm256_xor_si256(l[j], blowfish_avx2_feistel(bf, r[j]));
+            l[j] = _mm256_xor_si256(l[j], k);
+        }
+    }
+
+    for (j = 0; j < 2; j++) {
+        left[j] = _mm256_xor_si256(r[j], _mm256_set1_epi32(P[last]));
+        right[j] = l[j];
+    }
+}
+
+/*
+ * blowfish_avx2 blowfish_avx2_crypt_blocks
+ *
+ * Encrypts (decrypt = 0) or decrypts the blocks of data in groups of
+ * sixteen, with data laid out as for blowfish_encrypt_blocks. Returns the
+ * number of blocks processed, count rounded down to a multiple of sixteen.
+*/
+__attribute__((target("avx2")))
+extern inline size_t blowfish_avx2_crypt_blocks(const struct blowfish* bf,
+        uint32_t* data, size_t count,
+        int decrypt)
+{
+    size_t i = 0;
+    size_t j = 0;
+    __m256 lo;
+    __m256 hi;
+    __m256i left[2];
+    __m256i right[2];
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        // Split the (left, right) pairs into one register per half.
+        for (j = 0; j < 2; j++) {
+            lo = _mm256_loadu_ps((const float*) (data + 2 * i + 16 * j));
+            hi = _mm256_loadu_ps((const float*) (data + 2 * i + 16 * j + 8));
+            left[j] = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, 0x88));
+            right[j] = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, 0xDD));
+            left[j] = _mm256_permute4x64_epi64(left[j], 0xD8);
+            right[j] = _mm256_permute4x64_epi64(right[j], 0xD8);
+        }
+
+        blowfish_avx2_crypt16(bf, left, right, decrypt);
+
+        for (j = 0; j < 2; j++) {
+            left[j] = _mm256_permute4x64_epi64(left[j], 0xD8);
+            right[j] = _mm256_permute4x64_epi64(right[j], 0xD8);
+            _mm256_storeu_si256((__m256i*) (data + 2 * i + 16 * j),
+                                _mm256_unpacklo_epi32(left[j], right[j]));
+            _mm256_storeu_si256((__m256i*) (data + 2 * i + 16 * j + 8),
+                                _mm256_unpackhi_epi32(left[j], right[j]));
+        }
+    }
+
+    return i;
+}
+#endif
+
+extern inline int blowfish_avx2_supported()
+{
+#ifdef CC_BLOWFISH_AVX2
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * blowfish_avx2 blowfish_avx2_encrypt_blocks
+ *
+ * Encrypts count blocks in place, laid out as for blowfish_encrypt_blocks:
+ * sixteen at a time with AVX2 when available, the rest four-way.
+*/
+extern inline void blowfish_avx2_encrypt_blocks(const struct blowfish* bf,
+        uint32_t* data, size_t count)
+{
+    size_t done = 0;
+
+#ifdef CC_BLOWFISH_AVX2
+    if (blowfish_avx2_supported()) {
+        done = blowfish_avx2_crypt_blocks(bf, data, count, 0);
+    }
+#endif
+
+    blowfish_encrypt_blocks(bf, data + 2 * done, count - done);
+}
+
+extern inline void blowfish_avx2_decrypt_blocks(const struct blowfish* bf,
+        uint32_t* data, size_t count)
+{
+    size_t done = 0;
+
+#ifdef CC_BLOWFISH_AVX2
+    if (blowfish_avx2_supported()) {
+        done = blowfish_avx2_crypt_blocks(bf, data, count, 1);
+    }
+#endif
+
+    blowfish_decrypt_blocks(bf, data + 2 * done, count - done);
+}
+
+extern inline uint32_t blowfish_avx2_load32(const uint8_t* data)
+{
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+           ((uint32_t) data[2] << 8) | ((uint32_t) data[3] << 0);
+}
+
+extern inline void blowfish_avx2_store32(uint8_t* data, uint32_t value)
+{
+    data[0] = (uint8_t) (value >> 24);
+    data[1] = (uint8_t) (value >> 16);
+    data[2] = (uint8_t) (value >> 8);
+    data[3] = (uint8_t) (value >> 0);
+}
+
+extern inline void blowfish_avx2_ecb(const struct blowfish* bf,
+                                     const uint8_t* input, uint8_t* output,
+                                     size_t len, int decrypt)
+{
+    size_t i = 0;
+    size_t n = 0;
+    size_t count = 0;
+    uint32_t data[2 * 32];
+
+    for (n = 0; n + 8 <= len; n += 8 * count) {
+        count = (len - n) / 8;
+        if (count > 32) {
+            count = 32;
+        }
+
+        for (i = 0; i < 2 * count; i++) {
+            data[i] = blowfish_avx2_load32(input + n + 4 * i);
+        }
+
+        if (decrypt) {
+            blowfish_avx2_decrypt_blocks(bf, data, count);
+        } else {
+            blowfish_avx2_encrypt_blocks(bf, data, count);
+        }
+
+        for (i = 0; i < 2 * count; i++) {
+            blowfish_avx2_store32(output + n + 4 * i, data[i]);
+        }
+    }
+}
+
+/*
+ * blowfish_avx2 blowfish_avx2_ecb_encrypt
+ *
+ * Encrypts len bytes from input into output in ECB mode; input and output
+ * may be the same buffer. len must be a multiple of 8; a trailing partial
+ * block is ignored.
+*/
+extern inline void blowfish_avx2_ecb_encrypt(const struct blowfish* bf,
+        const uint8_t* input,
+        uint8_t* output, size_t len)
+{
+    blowfish_avx2_ecb(bf, input, output, len, 0);
+}
+
+extern inline void blowfish_avx2_ecb_decrypt(const struct blowfish* bf,
+        const uint8_t* input,
+        uint8_t* output, size_t len)
+{
+    blowfish_avx2_ecb(bf, input, output, len, 1);
+}
+
+/*
+ * blowfish_avx2 blowfish_avx2_cbc_decrypt
+ *
+ * Decrypts len bytes from input into output in CBC mode; input and output
+ * may be the same buffer. iv holds the initialization vector (left half in
+ * the upper 32 bits) on entry and the last ciphertext block on return, so a
+ * message may be processed in several calls. len must be a multiple of 8; a
+ * trailing partial block is ignored. CBC encryption is inherently serial;
+ * use blowfish_encrypt for it.
+*/
+extern inline void blowfish_avx2_cbc_decrypt(const struct blowfish* bf,
+        uint64_t* iv,
+        const uint8_t* input,
+        uint8_t* output, size_t len)
+{
+    size_t i = 0;
+    size_t n = 0;
+    size_t count = 0;
+    uint32_t chain[2] = {(uint32_t) (*iv >> 32), (uint32_t) *iv};
+    uint32_t cipher[2 * 32];
+    uint32_t data[2 * 32];
+
+    for (n = 0; n + 8 <= len; n += 8 * count) {
+        count = (len - n) / 8;
+        if (count > 32) {
+            count = 32;
+        }
+
+        for (i = 0; i < 2 * count; i++) {
+            cipher[i] = blowfish_avx2_load32(input + n + 4 * i);
+            data[i] = cipher[i];
+        }
+
+        blowfish_avx2_decrypt_blocks(bf, data, count);
+
+        for (i = 0; i < 2 * count; i += 2) {
+            blowfish_avx2_store32(output + n + 4 * i, data[i] ^ chain[0]);
+            blowfish_avx2_store32(output + n + 4 * i + 4,
+                                  data[i + 1] ^ chain[1]);
+            chain[0] = cipher[i];
+            chain[1] = cipher[i + 1];
+        }
+    }
+
+    *iv = ((uint64_t) chain[0] << 32) | chain[1];
+}
+
+/*
+ * blowfish_avx2 blowfish_avx2_ctr_xor
+ *
+ * Encrypts or decrypts len bytes from input into output in CTR mode; input
+ * and output may be the same buffer. counter is the 64-bit counter block
+ * (left half in the upper 32 bits), incremented (modulo 2^64) once per
+ * block; on return it holds the counter for the block following the last
+ * one used. len need not be a multiple of 8, but a message may only be
+ * split across calls at block boundaries.
+*/
+extern inline void blowfish_avx2_ctr_xor(const struct blowfish* bf,
+        uint64_t* counter,
+        const uint8_t* input,
+        uint8_t* output, size_t len)
+{
+    size_t i = 0;
+    size_t n = 0;
+    size_t count = 0;
+    uint64_t ctr = *counter;
+    uint32_t data[2 * 32];
+    uint8_t pad[8 * 32];
+
+    for (n = 0; n < len; n += 8 * count) {
+        count = (len - n + 7) / 8;
+        if (count > 32) {
+            count = 32;
+        }
+
+        for (i = 0; i < count; i++) {
+            data[2 * i + 0] = (uint32_t) ((ctr + i) >> 32);
+            data[2 * i + 1] = (uint32_t) (ctr + i);
+        }
+
+        blowfish_avx2_encrypt_blocks(bf, data, count);
+
+        for (i = 0; i < 2 * count; i++) {
+            blowfish_avx2_store32(pad + 4 * i, data[i]);
+        }
+        for (i = 0; i < 8 * count && n + i < len; i++) {
+            output[n + i] = input[n + i] ^ pad[i];
+        }
+
+        ctr = ctr + count;
+    }
+
+    *counter = ctr;
+}
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Persistable snapshots of expanded blowfish key schedules.
+ *
+ * blowfish_init runs 521 encryptions to derive the 4168-byte P-array and
+ * S-boxes of a key. A snapshot file stores any number of expanded schedules
+ * so that they can be mapped back read-only and used in place, skipping key
+ * setup entirely:
+ *
+ *     blowfish_snapshot_save("keys.bfs", schedules, count);
+ *     ...
+ *     struct blowfish_snapshot s;
+ *     blowfish_snapshot_open(&s, "keys.bfs");
+ *     blowfish_encrypt(blowfish_snapshot_get(&s, i), &left, &right);
+ *     blowfish_snapshot_close(&s);
+ *
+ * File format, version 1: a 64-byte header (struct blowfish_snapshot_header)
+ * followed by count records of BLOWFISH_SNAPSHOT_RECORD_SIZE bytes. Each
+ * record is a struct blowfish (P then S, native 32-bit words) padded with
+ * zeros to a multiple of 64 bytes, so every record starts on a cache line
+ * of the page-aligned mapping. The byte_order field holds 0x01020304 in the
+ * writer's byte order; files written on a host of the other byte order are
+ * rejected rather than converted. Records are identified by index; callers
+ * keep their own mapping from tunnels or key ids to indices.
+ *
+ * The files hold key material in the clear and must be protected
+ * accordingly. Loading needs POSIX mmap.
+*/
+
+#pragma once
+#ifndef CC_BLOWFISH_SNAPSHOT_H
+#define CC_BLOWFISH_SNAPSHOT_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "blowfish.h"
+
+#define BLOWFISH_SNAPSHOT_VERSION 1
+#define BLOWFISH_SNAPSHOT_HEADER_SIZE 64
+#define BLOWFISH_SNAPSHOT_RECORD_SIZE \
+    ((sizeof(struct blowfish) + 63) / 64 * 64)
+
+const char blowfish_snapshot_magic[8] = "BFSCHED";
+
+/*
+ * struct blowfish_snapshot_header
+ *
+ * char magic[8]         -- "BFSCHED" and a zero byte
+ * uint32_t version      -- BLOWFISH_SNAPSHOT_VERSION
+ * uint32_t byte_order   -- 0x01020304 as written by the host
+ * uint32_t header_size  -- BLOWFISH_SNAPSHOT_HEADER_SIZE
+ * uint32_t record_size  -- BLOWFISH_SNAPSHOT_RECORD_SIZE
+ * uint64_t count        -- number of records
+ * uint8_t reserved[32]  -- zero
+*/
+struct blowfish_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint64_t count;
+    uint8_t reserved[32];
+};
+
+/*
+ * struct blowfish_snapshot
+ *
+ * const uint8_t* data -- internal; the snapshot image
+ * size_t size         -- internal; size of the image in bytes
+ * size_t count        -- number of schedules in the snapshot
+ * int mapped          -- internal; whether data was mapped by open
+*/
+struct blowfish_snapshot {
+    const uint8_t* data;
+    size_t size;
+    size_t count;
+    int mapped;
+};
+
+/*
+ * blowfish_snapshot blowfish_snapshot_write
+ *
+ * Writes len bytes from data to fd, retrying short and interrupted writes.
+ * Returns 1 on success, 0 on error.
+*/
+extern inline int blowfish_snapshot_write(int fd, const void* data,
+        size_t len)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    ssize_t n = 0;
+
+    while (len > 0) {
+        n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+
+        p += n;
+        len -= (size_t) n;
+    }
+
+    return 1;
+}
+
+/*
+ * blowfish_snapshot blowfish_snapshot_save
+ *
+ * Writes count expanded schedules to a snapshot file at path. Returns 1 on
+ * success, 0 if the file could not be written.
+ *
+ * The snapshot is written and synced to path.tmp, readable by the owner
+ * only, and then renamed over path. Readers that have the old file mapped
+ * keep it, and path never holds a partial snapshot; on failure the
+ * temporary file is removed and path is left as it was.
+*/
+extern inline int blowfish_snapshot_save(const char* path,
+        const struct blowfish* schedules,
+        size_t count)
+{
+    struct blowfish_snapshot_header header;
+    uint8_t padding[64];
+    size_t pad = BLOWFISH_SNAPSHOT_RECORD_SIZE - sizeof(struct blowfish);
+    size_t path_len = strlen(path);
+    size_t i = 0;
+    int ok = 1;
+    int fd = -1;
+    char* temp = (char*) malloc(path_len + 5);
+
+    if (temp == NULL) {
+        return 0;
+    }
+
+    memcpy(temp, path, path_len);
+    memcpy(temp + path_len, ".tmp", 5);
+
+    fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        free(temp);
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memset(padding, 0, sizeof(padding));
+    memcpy(header.magic, blowfish_snapshot_magic, 8);
+    header.version = BLOWFISH_SNAPSHOT_VERSION;
+    header.byte_order = 0x01020304;
+    header.header_size = BLOWFISH_SNAPSHOT_HEADER_SIZE;
+    header.record_size = BLOWFISH_SNAPSHOT_RECORD_SIZE;
+    header.count = count;
+
+    ok = blowfish_snapshot_write(fd, &header, sizeof(header));
+    for (i = 0; ok && i < count; i++) {
+        ok = blowfish_snapshot_write(fd, &schedules[i],
+                                     sizeof(struct blowfish));
+        if (ok && pad > 0) {
+            ok = blowfish_snapshot_write(fd, padding, pad);
+        }
+    }
+
+    if (ok && fsync(fd) != 0) {
+        ok = 0;
+    }
+    if (close(fd) != 0) {
+        ok = 0;
+    }
+    if (ok && rename(temp, path) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        unlink(temp);
+    }
+
+    free(temp);
+    return ok;
+}
+
+/*
+ * blowfish_snapshot blowfish_snapshot_load
+ *
+ * Attaches s to a snapshot image already in memory (size bytes at data,
+ * aligned to at least 4 bytes), after checking its header and size. The
+ * image is not copied and must outlive s. Returns 1 if the image is a valid
+ * snapshot, 0 otherwise.
+*/
+extern inline int blowfish_snapshot_load(struct blowfish_snapshot* s,
+        const uint8_t* data, size_t size)
+{
+    struct blowfish_snapshot_header header;
+
+    s->data = NULL;
+    s->size = 0;
+    s->count = 0;
+    s->mapped = 0;
+
+    if (size < sizeof(header)) {
+        return 0;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, blowfish_snapshot_magic, 8) != 0 ||
+            header.version != BLOWFISH_SNAPSHOT_VERSION ||
+            header.byte_order != 0x01020304 ||
+            header.header_size != BLOWFISH_SNAPSHOT_HEADER_SIZE ||
+            header.record_size != BLOWFISH_SNAPSHOT_RECORD_SIZE) {
+        return 0;
+    }
+
+    if (header.count > (size - BLOWFISH_SNAPSHOT_HEADER_SIZE) /
+            BLOWFISH_SNAPSHOT_RECORD_SIZE) {
+        return 0;
+    }
+
+    s->data = data;
+    s->size = size;
+    s->count = (size_t) header.count;
+    return 1;
+}
+
+/*
+ * blowfish_snapshot blowfish_snapshot_open
+ *
+ * Maps the snapshot file at path read-only and attaches s to it. Returns 1
+ * on success, 0 if the file cannot be mapped or is not a valid snapshot.
+*/
+extern inline int blowfish_snapshot_open(struct blowfish_snapshot* s,
+        const char* path)
+{
+    struct stat st;
+    void* data = NULL;
+    int fd = open(path, O_RDONLY);
+
+    s->data = NULL;
+    s->mapped = 0;
+
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+
+    if (!blowfish_snapshot_load(s, (const uint8_t*) data,
+                                (size_t) st.st_size)) {
+        munmap(data, (size_t) st.st_size);
+        return 0;
+    }
+
+    s->mapped = 1;
+    return 1;
+}
+
+/*
+ * blowfish_snapshot blowfish_snapshot_get
+ *
+ * Returns the expanded schedule at index (less than s->count), ready for
+ * blowfish_encrypt and friends.
+*/
+extern inline const struct blowfish* blowfish_snapshot_get(
+    const struct blowfish_snapshot* s, size_t index)
+{
+    return (const struct blowfish*) (s->data +
+                                     BLOWFISH_SNAPSHOT_HEADER_SIZE +
+                                     index * BLOWFISH_SNAPSHOT_RECORD_SIZE);
+}
+
+/*
+ * blowfish_snapshot blowfish_snapshot_close
+ *
+ * Detaches s, unmapping the file if it was mapped by blowfish_snapshot_open.
+*/
+extern inline void blowfish_snapshot_close(struct blowfish_snapshot* s)
+{
+    if (s->mapped) {
+        munmap((void*) s->data, s->size);
+    }
+
+    s->data = NULL;
+    s->size = 0;
+    s->count = 0;
+    s->mapped = 0;
+}
+
+#endif
@@ -5,7 +5,11 @@
 **/
 
 #include "blowfish.h"
+#include "bcrypt.h"
+#include "blowfish_snapshot.h"
+#include "blowfish_avx2.h"
 #include "stdio.h"
+#include "time.h"
 
 void test_schneier()
 {
@@ -130,8 +134,357 @@ void test_schneier()
     }
 }
 
+void test_blowfish_blocks()
+{
+    struct blowfish bf;
+    uint32_t key[2] = {0x01234567, 0x89ABCDEF};
+    uint32_t data[2 * 11];
+    uint32_t expected[2 * 11];
+    size_t matches = 0;
+    size_t i = 0;
+
+    blowfish_init(&bf, key, 2);
+
+    for (i = 0; i < 2 * 11; i++) {
+        data[i] = (uint32_t) (i * 0x9E3779B9u);
+        expected[i] = data[i];
+    }
+    for (i = 0; i < 11; i++) {
+        blowfish_encrypt(&bf, &expected[2 * i], &expected[2 * i + 1]);
+    }
+
+    blowfish_encrypt_blocks(&bf, data, 11);
+    for (i = 0; i < 2 * 11; i++) {
+        matches += data[i] == expected[i];
+    }
+    printf("Blocks Actual:   %zu words match\n", matches);
+    printf("Blocks Expected: %d words match\n", 2 * 11);
+
+    matches = 0;
+    blowfish_decrypt_blocks(&bf, data, 11);
+    for (i = 0; i < 2 * 11; i++) {
+        matches += data[i] == (uint32_t) (i * 0x9E3779B9u);
+    }
+    printf("Blocks Decrypted: %zu words match\n\n", matches);
+}
+
+void test_bcrypt()
+{
+    const char* passwords[4] = {
+        "",
+        "U*U",
+        "password",
+        "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+        "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+    };
+    const char* hashes[4] = {
+        "$2b$04$.LYly/MZmzANan0BObo1C.epCmOWTYGVzMUEQyEpquCvPa1c8Sl.2",
+        "$2b$04$FSfs5GTgt6HUhu7IViv8J.Ozz7bJ3l6tDppAiT9H8eS0c/K6qopae",
+        "$2b$04$Tgt6HUhu7IViv8JWjw9KX.uOKO3zGfMJ5/Y0xs8K6RTiCY/JKC3Oa",
+        "$2b$04$hu7IViv8JWjw9KXkx.LYl.QrE7wUtRT0DZy/3i2/jUwontPEjtD2a"
+    };
+    // Only the first 72 bytes of a password count: this one is the last
+    // password above followed by eight more bytes.
+    const char* long_password =
+        "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+        "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+        "cccccccc";
+    const char* mixed_passwords[3] = { long_password, "U*U", "password" };
+    const char* mixed_hashes[3] = {
+        "$2b$04$hu7IViv8JWjw9KXkx.LYl.QrE7wUtRT0DZy/3i2/jUwontPEjtD2a",
+        "$2b$04$Tgt6HUhu7IViv8JWjw9KX.uOKO3zGfMJ5/Y0xs8K6RTiCY/JKC3Oa",
+        "$2b$04$Tgt6HUhu7IViv8JWjw9KX.uOKO3zGfMJ5/Y0xs8K6RTiCY/JKC3Ob"
+    };
+    int results[4];
+    struct bcrypt_pool pool;
+    uint8_t salt[16];
+    char output[BCRYPT_HASH_SIZE];
+    size_t i = 0;
+
+    for (i = 0; i < 4; i++) {
+        bcrypt_decode(salt, 16, hashes[i] + 7);
+        bcrypt_hash(passwords[i], 4, salt, output);
+        printf("bcrypt Actual:   %s\n", output);
+        printf("bcrypt Expected: %s\n", hashes[i]);
+    }
+
+    bcrypt_verify_batch(passwords, hashes, results, 4, 4);
+    printf("bcrypt batch Actual:   %d %d %d %d\n", results[0], results[1],
+           results[2], results[3]);
+    printf("bcrypt batch Expected: 1 1 1 1\n");
+
+    // The same pool serves several batches.
+    printf("bcrypt pool init Actual:   %d\n", bcrypt_pool_init(&pool, 3));
+    printf("bcrypt pool init Expected: 1\n");
+    for (i = 0; i < 2; i++) {
+        memset(results, 0, sizeof(results));
+        bcrypt_pool_submit(&pool, passwords + i, hashes + i, results, 4 - i);
+        printf("bcrypt pool Actual:   %d %d %d\n", results[0], results[1],
+               results[2]);
+        printf("bcrypt pool Expected: 1 1 1\n");
+    }
+    bcrypt_pool_destroy(&pool);
+
+    // A password longer than 72 bytes, a hash of another password and a
+    // hash with its last character changed, all through the batch path.
+    bcrypt_verify_batch(mixed_passwords, mixed_hashes, results, 3, 3);
+    printf("bcrypt mixed batch Actual:   %d %d %d\n", results[0], results[1],
+           results[2]);
+    printf("bcrypt mixed batch Expected: 1 0 0\n");
+    printf("bcrypt %zu-byte password Actual:   %d\n", strlen(long_password),
+           bcrypt_verify(long_password, hashes[3]));
+    printf("bcrypt %zu-byte password Expected: 1\n", strlen(long_password));
+
+    printf("bcrypt wrong password Actual:   %d\n",
+           bcrypt_verify("U*U*", hashes[1]));
+    printf("bcrypt wrong password Expected: 0\n");
+    // Same salt bytes, but the last salt character has a low bit set that
+    // the canonical encoding leaves clear.
+    printf("bcrypt non-canonical salt Actual:   %d\n",
+           bcrypt_verify("U*U", "$2b$04$FSfs5GTgt6HUhu7IViv8J/"
+                         "Ozz7bJ3l6tDppAiT9H8eS0c/K6qopae"));
+    printf("bcrypt non-canonical salt Expected: 0\n\n");
+}
+
+void test_blowfish_snapshot()
+{
+    struct blowfish schedules[3];
+    struct blowfish_snapshot s;
+    uint32_t key[3][2] = {
+        {0x00000000, 0x00000000},
+        {0x01234567, 0x89ABCDEF},
+        {0xFEDCBA98, 0x76543210}
+    };
+    uint32_t expected[3][2] = {
+        {0x4EF99745, 0x6198DD78},
+        {0x61F9C380, 0x2281B096},
+        {0x0ACEAB0F, 0xC6A0A28D}
+    };
+    uint32_t plaintext[3][2] = {
+        {0x00000000, 0x00000000},
+        {0x11111111, 0x11111111},
+        {0x01234567, 0x89ABCDEF}
+    };
+    const char* path = "blowfish_snapshot_test.bfs";
+    const char* short_path = "blowfish_snapshot_short.bfs";
+    struct blowfish_snapshot bad;
+    uint32_t* image = NULL;
+    uint32_t left = 0;
+    uint32_t right = 0;
+    FILE* file = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < 3; i++) {
+        blowfish_init(&schedules[i], key[i], 2);
+    }
+
+    if (!blowfish_snapshot_save(path, schedules, 3) ||
+            !blowfish_snapshot_open(&s, path)) {
+        printf("Snapshot: could not write or map %s\n\n", path);
+        return;
+    }
+
+    printf("Snapshot count Actual:   %zu\n", s.count);
+    printf("Snapshot count Expected: 3\n");
+    for (i = 0; i < 3; i++) {
+        blowfish_encrypt(blowfish_snapshot_get(&s, i), &plaintext[i][0],
+                         &plaintext[i][1]);
+        printf("Snapshot Actual:   %08x,%08x\n", plaintext[i][0],
+               plaintext[i][1]);
+        printf("Snapshot Expected: %08x,%08x\n", expected[i][0],
+               expected[i][1]);
+    }
+
+    // Damaged copies of the image must be refused: one with a magic byte
+    // changed, and one cut a byte short of its last record, both in memory
+    // and as a file.
+    image = (uint32_t*) malloc(s.size);
+    if (image != NULL) {
+        memcpy(image, s.data, s.size);
+        ((uint8_t*) image)[0] ^= 0x01;
+        printf("Snapshot bad magic Actual:   %d\n",
+               blowfish_snapshot_load(&bad, (const uint8_t*) image, s.size));
+        printf("Snapshot bad magic Expected: 0\n");
+        ((uint8_t*) image)[0] ^= 0x01;
+        printf("Snapshot truncated Actual:   %d\n",
+               blowfish_snapshot_load(&bad, (const uint8_t*) image,
+                                      s.size - 1));
+        printf("Snapshot truncated Expected: 0\n");
+
+        file = fopen(short_path, "wb");
+        if (file != NULL) {
+            fwrite(image, s.size - 1, 1, file);
+            fclose(file);
+        }
+        printf("Snapshot truncated file Actual:   %d\n",
+               blowfish_snapshot_open(&bad, short_path));
+        printf("Snapshot truncated file Expected: 0\n");
+        remove(short_path);
+        free(image);
+    }
+
+    // Saving over a mapped snapshot replaces the file rather than rewriting
+    // it: the old mapping still reads all three schedules, the new file
+    // holds two, and no temporary file is left behind.
+    left = 0x01234567;
+    right = 0x89ABCDEF;
+    printf("Snapshot replace Actual:   %d\n",
+           blowfish_snapshot_save(path, schedules, 2));
+    printf("Snapshot replace Expected: 1\n");
+    blowfish_encrypt(blowfish_snapshot_get(&s, 2), &left, &right);
+    printf("Snapshot old mapping Actual:   %08x,%08x\n", left, right);
+    printf("Snapshot old mapping Expected: %08x,%08x\n", expected[2][0],
+           expected[2][1]);
+    if (blowfish_snapshot_open(&bad, path)) {
+        printf("Snapshot new count Actual:   %zu\n", bad.count);
+        blowfish_snapshot_close(&bad);
+    }
+    printf("Snapshot new count Expected: 2\n");
+    file = fopen("blowfish_snapshot_test.bfs.tmp", "rb");
+    printf("Snapshot temporary file Actual:   %d\n", file != NULL);
+    printf("Snapshot temporary file Expected: 0\n");
+    if (file != NULL) {
+        fclose(file);
+    }
+    printf("\n");
+
+    blowfish_snapshot_close(&s);
+    remove(path);
+}
+
+void print_hex(const char* label, const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+
+    printf("%s", label);
+    for (i = 0; i < len; i++) {
+        printf("%02x", data[i]);
+    }
+    printf("\n");
+}
+
+void test_blowfish_avx2()
+{
+    struct blowfish bf;
+    uint32_t key[4] = {0x01234567, 0x89ABCDEF, 0xF0E1D2C3, 0xB4A59687};
+    uint8_t ciphertext[88] = {
+        0xa0, 0xb3, 0x56, 0x9b, 0x4b, 0x44, 0xa4, 0xa8,
+        0xf8, 0xa7, 0xb9, 0xe0, 0x8e, 0x43, 0xa2, 0xb0,
+        0xfc, 0x17, 0x4d, 0x80, 0x1b, 0x3e, 0xc0, 0x57,
+        0xc9, 0x69, 0xc1, 0x77, 0x0f, 0x62, 0xa6, 0x0d,
+        0xb2, 0x3a, 0x47, 0x0c, 0x59, 0x3b, 0xcd, 0x10,
+        0x59, 0x65, 0xcf, 0x88, 0x82, 0x9e, 0x78, 0x3f,
+        0xdd, 0xc8, 0x4b, 0xea, 0x0d, 0xfb, 0x1b, 0xe3,
+        0x8d, 0x45, 0x0b, 0x17, 0x1e, 0xbb, 0x7b, 0x20,
+        0xda, 0xa2, 0xbf, 0x9c, 0xad, 0x03, 0x5c, 0xb5,
+        0xec, 0xf1, 0xd7, 0x22, 0x4a, 0x07, 0x7f, 0xd1,
+        0xb5, 0xc1, 0xb0, 0xab, 0x6b, 0x1d, 0xcf, 0xaa
+    };
+    uint8_t plaintext[88];
+    uint8_t output[88];
+    uint8_t expected[88];
+    uint32_t data[2 * 37];
+    uint32_t reference[2 * 37];
+    uint64_t iv = 0xFEDCBA9876543210ull;
+    uint64_t counter = 0x00000001FFFFFFFEull;
+    size_t matches = 0;
+    size_t i = 0;
+
+    printf("AVX2 supported: %d\n", blowfish_avx2_supported());
+    blowfish_init(&bf, key, 4);
+
+    for (i = 0; i < 2 * 37; i++) {
+        data[i] = (uint32_t) (i * 0x9E3779B9u);
+        reference[i] = data[i];
+    }
+    for (i = 0; i < 37; i++) {
+        blowfish_encrypt(&bf, &reference[2 * i], &reference[2 * i + 1]);
+    }
+
+    blowfish_avx2_encrypt_blocks(&bf, data, 37);
+    for (i = 0; i < 2 * 37; i++) {
+        matches += data[i] == reference[i];
+    }
+    printf("AVX2 blocks Actual:   %zu words match\n", matches);
+    printf("AVX2 blocks Expected: %d words match\n", 2 * 37);
+
+    matches = 0;
+    blowfish_avx2_decrypt_blocks(&bf, data, 37);
+    for (i = 0; i < 2 * 37; i++) {
+        matches += data[i] == (uint32_t) (i * 0x9E3779B9u);
+    }
+    printf("AVX2 blocks decrypted: %zu words match\n", matches);
+
+    for (i = 0; i < 88; i++) {
+        plaintext[i] = (uint8_t) (i * 37 + 11);
+    }
+
+    blowfish_avx2_cbc_decrypt(&bf, &iv, ciphertext, output, 88);
+    print_hex("AVX2 CBC Actual:   ", output, 88);
+    print_hex("AVX2 CBC Expected: ", plaintext, 88);
+
+    blowfish_avx2_ecb_encrypt(&bf, ciphertext, output, 88);
+    blowfish_avx2_ecb_decrypt(&bf, output, output, 88);
+    printf("AVX2 ECB round trip: %d\n",
+           memcmp(output, ciphertext, 88) == 0);
+
+    // CTR keystream blocks are the encrypted counters; 85 bytes leaves a
+    // partial final block and the counter carries into the left half.
+    for (i = 0; i < 11; i++) {
+        uint32_t left = (uint32_t) ((counter + i) >> 32);
+        uint32_t right = (uint32_t) (counter + i);
+
+        blowfish_encrypt(&bf, &left, &right);
+        blowfish_avx2_store32(expected + 8 * i, left);
+        blowfish_avx2_store32(expected + 8 * i + 4, right);
+    }
+    for (i = 0; i < 85; i++) {
+        expected[i] = expected[i] ^ plaintext[i];
+    }
+
+    blowfish_avx2_ctr_xor(&bf, &counter, plaintext, output, 85);
+    print_hex("AVX2 CTR Actual:   ", output, 85);
+    print_hex("AVX2 CTR Expected: ", expected, 85);
+    printf("AVX2 CTR counter Actual:   %016llx\n",
+           (unsigned long long) counter);
+    printf("AVX2 CTR counter Expected: 0000000200000009\n\n");
+}
+
+void benchmark_blowfish()
+{
+    struct blowfish bf;
+    uint32_t key[2] = {0x01234567, 0x89ABCDEF};
+    static uint32_t data[2 * 131072];
+    clock_t start;
+    size_t i = 0;
+
+    blowfish_init(&bf, key, 2);
+
+    start = clock();
+    for (i = 0; i < 131072; i++) {
+        blowfish_encrypt(&bf, &data[2 * i], &data[2 * i + 1]);
+    }
+    printf("Benchmark: 1MB blowfish single:  %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    blowfish_encrypt_blocks(&bf, data, 131072);
+    printf("Benchmark: 1MB blowfish 4-way:   %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    blowfish_avx2_encrypt_blocks(&bf, data, 131072);
+    printf("Benchmark: 1MB blowfish AVX2:    %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
 int main()
 {
     test_schneier();
+    test_blowfish_blocks();
+    test_bcrypt();
+    test_blowfish_snapshot();
+    test_blowfish_avx2();
+    benchmark_blowfish();
     return 0;
 }
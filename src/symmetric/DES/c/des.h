@@ -101,6 +101,161 @@ const uint8_t des_primitive_function_p[32] = {
     22, 11,  4, 25
 };
 
+/*
+ * Combined S-box and P permutation tables
+ *
+ * des_sp[i][v] is P applied to the output of S-box i + 1 for the 6-bit input
+ * v, placed in its nibble of the 32-bit S-box output. The round function is
+ * then eight lookups xored together. Derived from des_primitive_functions
+ * and des_primitive_function_p.
+*/
+const uint32_t des_sp[8][64] = {
+    {
+        0x00808200, 0x00000000, 0x00008000, 0x00808202,
+        0x00808002, 0x00008202, 0x00000002, 0x00008000,
+        0x00000200, 0x00808200, 0x00808202, 0x00000200,
+        0x00800202, 0x00808002, 0x00800000, 0x00000002,
+        0x00000202, 0x00800200, 0x00800200, 0x00008200,
+        0x00008200, 0x00808000, 0x00808000, 0x00800202,
+        0x00008002, 0x00800002, 0x00800002, 0x00008002,
+        0x00000000, 0x00000202, 0x00008202, 0x00800000,
+        0x00008000, 0x00808202, 0x00000002, 0x00808000,
+        0x00808200, 0x00800000, 0x00800000, 0x00000200,
+        0x00808002, 0x00008000, 0x00008200, 0x00800002,
+        0x00000200, 0x00000002, 0x00800202, 0x00008202,
+        0x00808202, 0x00008002, 0x00808000, 0x00800202,
+        0x00800002, 0x00000202, 0x00008202, 0x00808200,
+        0x00000202, 0x00800200, 0x00800200, 0x00000000,
+        0x00008002, 0x00008200, 0x00000000, 0x00808002
+    },
+    {
+        0x40084010, 0x40004000, 0x00004000, 0x00084010,
+        0x00080000, 0x00000010, 0x40080010, 0x40004010,
+        0x40000010, 0x40084010, 0x40084000, 0x40000000,
+        0x40004000, 0x00080000, 0x00000010, 0x40080010,
+        0x00084000, 0x00080010, 0x40004010, 0x00000000,
+        0x40000000, 0x00004000, 0x00084010, 0x40080000,
+        0x00080010, 0x40000010, 0x00000000, 0x00084000,
+        0x00004010, 0x40084000, 0x40080000, 0x00004010,
+        0x00000000, 0x00084010, 0x40080010, 0x00080000,
+        0x40004010, 0x40080000, 0x40084000, 0x00004000,
+        0x40080000, 0x40004000, 0x00000010, 0x40084010,
+        0x00084010, 0x00000010, 0x00004000, 0x40000000,
+        0x00004010, 0x40084000, 0x00080000, 0x40000010,
+        0x00080010, 0x40004010, 0x40000010, 0x00080010,
+        0x00084000, 0x00000000, 0x40004000, 0x00004010,
+        0x40000000, 0x40080010, 0x40084010, 0x00084000
+    },
+    {
+        0x00000104, 0x04010100, 0x00000000, 0x04010004,
+        0x04000100, 0x00000000, 0x00010104, 0x04000100,
+        0x00010004, 0x04000004, 0x04000004, 0x00010000,
+        0x04010104, 0x00010004, 0x04010000, 0x00000104,
+        0x04000000, 0x00000004, 0x04010100, 0x00000100,
+        0x00010100, 0x04010000, 0x04010004, 0x00010104,
+        0x04000104, 0x00010100, 0x00010000, 0x04000104,
+        0x00000004, 0x04010104, 0x00000100, 0x04000000,
+        0x04010100, 0x04000000, 0x00010004, 0x00000104,
+        0x00010000, 0x04010100, 0x04000100, 0x00000000,
+        0x00000100, 0x00010004, 0x04010104, 0x04000100,
+        0x04000004, 0x00000100, 0x00000000, 0x04010004,
+        0x04000104, 0x00010000, 0x04000000, 0x04010104,
+        0x00000004, 0x00010104, 0x00010100, 0x04000004,
+        0x04010000, 0x04000104, 0x00000104, 0x04010000,
+        0x00010104, 0x00000004, 0x04010004, 0x00010100
+    },
+    {
+        0x80401000, 0x80001040, 0x80001040, 0x00000040,
+        0x00401040, 0x80400040, 0x80400000, 0x80001000,
+        0x00000000, 0x00401000, 0x00401000, 0x80401040,
+        0x80000040, 0x00000000, 0x00400040, 0x80400000,
+        0x80000000, 0x00001000, 0x00400000, 0x80401000,
+        0x00000040, 0x00400000, 0x80001000, 0x00001040,
+        0x80400040, 0x80000000, 0x00001040, 0x00400040,
+        0x00001000, 0x00401040, 0x80401040, 0x80000040,
+        0x00400040, 0x80400000, 0x00401000, 0x80401040,
+        0x80000040, 0x00000000, 0x00000000, 0x00401000,
+        0x00001040, 0x00400040, 0x80400040, 0x80000000,
+        0x80401000, 0x80001040, 0x80001040, 0x00000040,
+        0x80401040, 0x80000040, 0x80000000, 0x00001000,
+        0x80400000, 0x80001000, 0x00401040, 0x80400040,
+        0x80001000, 0x00001040, 0x00400000, 0x80401000,
+        0x00000040, 0x00400000, 0x00001000, 0x00401040
+    },
+    {
+        0x00000080, 0x01040080, 0x01040000, 0x21000080,
+        0x00040000, 0x00000080, 0x20000000, 0x01040000,
+        0x20040080, 0x00040000, 0x01000080, 0x20040080,
+        0x21000080, 0x21040000, 0x00040080, 0x20000000,
+        0x01000000, 0x20040000, 0x20040000, 0x00000000,
+        0x20000080, 0x21040080, 0x21040080, 0x01000080,
+        0x21040000, 0x20000080, 0x00000000, 0x21000000,
+        0x01040080, 0x01000000, 0x21000000, 0x00040080,
+        0x00040000, 0x21000080, 0x00000080, 0x01000000,
+        0x20000000, 0x01040000, 0x21000080, 0x20040080,
+        0x01000080, 0x20000000, 0x21040000, 0x01040080,
+        0x20040080, 0x00000080, 0x01000000, 0x21040000,
+        0x21040080, 0x00040080, 0x21000000, 0x21040080,
+        0x01040000, 0x00000000, 0x20040000, 0x21000000,
+        0x00040080, 0x01000080, 0x20000080, 0x00040000,
+        0x00000000, 0x20040000, 0x01040080, 0x20000080
+    },
+    {
+        0x10000008, 0x10200000, 0x00002000, 0x10202008,
+        0x10200000, 0x00000008, 0x10202008, 0x00200000,
+        0x10002000, 0x00202008, 0x00200000, 0x10000008,
+        0x00200008, 0x10002000, 0x10000000, 0x00002008,
+        0x00000000, 0x00200008, 0x10002008, 0x00002000,
+        0x00202000, 0x10002008, 0x00000008, 0x10200008,
+        0x10200008, 0x00000000, 0x00202008, 0x10202000,
+        0x00002008, 0x00202000, 0x10202000, 0x10000000,
+        0x10002000, 0x00000008, 0x10200008, 0x00202000,
+        0x10202008, 0x00200000, 0x00002008, 0x10000008,
+        0x00200000, 0x10002000, 0x10000000, 0x00002008,
+        0x10000008, 0x10202008, 0x00202000, 0x10200000,
+        0x00202008, 0x10202000, 0x00000000, 0x10200008,
+        0x00000008, 0x00002000, 0x10200000, 0x00202008,
+        0x00002000, 0x00200008, 0x10002008, 0x00000000,
+        0x10202000, 0x10000000, 0x00200008, 0x10002008
+    },
+    {
+        0x00100000, 0x02100001, 0x02000401, 0x00000000,
+        0x00000400, 0x02000401, 0x00100401, 0x02100400,
+        0x02100401, 0x00100000, 0x00000000, 0x02000001,
+        0x00000001, 0x02000000, 0x02100001, 0x00000401,
+        0x02000400, 0x00100401, 0x00100001, 0x02000400,
+        0x02000001, 0x02100000, 0x02100400, 0x00100001,
+        0x02100000, 0x00000400, 0x00000401, 0x02100401,
+        0x00100400, 0x00000001, 0x02000000, 0x00100400,
+        0x02000000, 0x00100400, 0x00100000, 0x02000401,
+        0x02000401, 0x02100001, 0x02100001, 0x00000001,
+        0x00100001, 0x02000000, 0x02000400, 0x00100000,
+        0x02100400, 0x00000401, 0x00100401, 0x02100400,
+        0x00000401, 0x02000001, 0x02100401, 0x02100000,
+        0x00100400, 0x00000000, 0x00000001, 0x02100401,
+        0x00000000, 0x00100401, 0x02100000, 0x00000400,
+        0x02000001, 0x02000400, 0x00000400, 0x00100001
+    },
+    {
+        0x08000820, 0x00000800, 0x00020000, 0x08020820,
+        0x08000000, 0x08000820, 0x00000020, 0x08000000,
+        0x00020020, 0x08020000, 0x08020820, 0x00020800,
+        0x08020800, 0x00020820, 0x00000800, 0x00000020,
+        0x08020000, 0x08000020, 0x08000800, 0x00000820,
+        0x00020800, 0x00020020, 0x08020020, 0x08020800,
+        0x00000820, 0x00000000, 0x00000000, 0x08020020,
+        0x08000020, 0x08000800, 0x00020820, 0x00020000,
+        0x00020820, 0x00020000, 0x08020800, 0x00000800,
+        0x00000020, 0x08020020, 0x00000800, 0x00020820,
+        0x08000800, 0x00000020, 0x08000020, 0x08020000,
+        0x08020020, 0x08000000, 0x00020000, 0x08000820,
+        0x00000000, 0x08020820, 0x00020020, 0x08000020,
+        0x08020000, 0x08000800, 0x08000820, 0x00000000,
+        0x08020820, 0x00020800, 0x00020800, 0x00000820,
+        0x00000820, 0x00020020, 0x08000000, 0x08020800
+    }
+};
+
 const uint8_t des_permuted_choice_1[64] = {
     57, 49,  41, 33,  25,  17,  9,
     1, 58,  50, 42,  34,  26, 18,
@@ -127,125 +282,643 @@ const uint8_t des_shift_sizes[16] = {
     1, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1
 };
 
+/*
+ * Byte-indexed key schedule tables
+ *
+ * des_pc1_c[n][v] and des_pc1_d[n][v] are the bits of C0 and D0 set by the
+ * value v of the n-th nibble of the key (most significant first), so PC-1
+ * is sixteen lookups. des_pc2_c[g][v] and des_pc2_d[g][v] are the bits of
+ * the round key set by the value v of the g-th 7-bit group of C or D (most
+ * significant first); PC-2 takes its first 24 bits from C and the last 24
+ * from D, so each round key is eight lookups. Derived from
+ * des_permuted_choice_1 and des_permuted_choice_2.
+*/
+const uint32_t des_pc1_c[16][16] = {
+    {
+        0x00000000, 0x00000000, 0x00000010, 0x00000010,
+        0x00001000, 0x00001000, 0x00001010, 0x00001010,
+        0x00100000, 0x00100000, 0x00100010, 0x00100010,
+        0x00101000, 0x00101000, 0x00101010, 0x00101010
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x00000020, 0x00000020,
+        0x00002000, 0x00002000, 0x00002020, 0x00002020,
+        0x00200000, 0x00200000, 0x00200020, 0x00200020,
+        0x00202000, 0x00202000, 0x00202020, 0x00202020
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x00000040, 0x00000040,
+        0x00004000, 0x00004000, 0x00004040, 0x00004040,
+        0x00400000, 0x00400000, 0x00400040, 0x00400040,
+        0x00404000, 0x00404000, 0x00404040, 0x00404040
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x00000080, 0x00000080,
+        0x00008000, 0x00008000, 0x00008080, 0x00008080,
+        0x00800000, 0x00800000, 0x00800080, 0x00800080,
+        0x00808000, 0x00808000, 0x00808080, 0x00808080
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000001, 0x00000100, 0x00000101,
+        0x00010000, 0x00010001, 0x00010100, 0x00010101,
+        0x01000000, 0x01000001, 0x01000100, 0x01000101,
+        0x01010000, 0x01010001, 0x01010100, 0x01010101
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000002, 0x00000200, 0x00000202,
+        0x00020000, 0x00020002, 0x00020200, 0x00020202,
+        0x02000000, 0x02000002, 0x02000200, 0x02000202,
+        0x02020000, 0x02020002, 0x02020200, 0x02020202
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000004, 0x00000400, 0x00000404,
+        0x00040000, 0x00040004, 0x00040400, 0x00040404,
+        0x04000000, 0x04000004, 0x04000400, 0x04000404,
+        0x04040000, 0x04040004, 0x04040400, 0x04040404
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000008, 0x00000800, 0x00000808,
+        0x00080000, 0x00080008, 0x00080800, 0x00080808,
+        0x08000000, 0x08000008, 0x08000800, 0x08000808,
+        0x08080000, 0x08080008, 0x08080800, 0x08080808
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    }
+};
+
+const uint32_t des_pc1_d[16][16] = {
+    {
+        0x00000000, 0x00000001, 0x00000000, 0x00000001,
+        0x00000000, 0x00000001, 0x00000000, 0x00000001,
+        0x00000000, 0x00000001, 0x00000000, 0x00000001,
+        0x00000000, 0x00000001, 0x00000000, 0x00000001
+    },
+    {
+        0x00000000, 0x00000000, 0x00100000, 0x00100000,
+        0x00001000, 0x00001000, 0x00101000, 0x00101000,
+        0x00000010, 0x00000010, 0x00100010, 0x00100010,
+        0x00001010, 0x00001010, 0x00101010, 0x00101010
+    },
+    {
+        0x00000000, 0x00000002, 0x00000000, 0x00000002,
+        0x00000000, 0x00000002, 0x00000000, 0x00000002,
+        0x00000000, 0x00000002, 0x00000000, 0x00000002,
+        0x00000000, 0x00000002, 0x00000000, 0x00000002
+    },
+    {
+        0x00000000, 0x00000000, 0x00200000, 0x00200000,
+        0x00002000, 0x00002000, 0x00202000, 0x00202000,
+        0x00000020, 0x00000020, 0x00200020, 0x00200020,
+        0x00002020, 0x00002020, 0x00202020, 0x00202020
+    },
+    {
+        0x00000000, 0x00000004, 0x00000000, 0x00000004,
+        0x00000000, 0x00000004, 0x00000000, 0x00000004,
+        0x00000000, 0x00000004, 0x00000000, 0x00000004,
+        0x00000000, 0x00000004, 0x00000000, 0x00000004
+    },
+    {
+        0x00000000, 0x00000000, 0x00400000, 0x00400000,
+        0x00004000, 0x00004000, 0x00404000, 0x00404000,
+        0x00000040, 0x00000040, 0x00400040, 0x00400040,
+        0x00004040, 0x00004040, 0x00404040, 0x00404040
+    },
+    {
+        0x00000000, 0x00000008, 0x00000000, 0x00000008,
+        0x00000000, 0x00000008, 0x00000000, 0x00000008,
+        0x00000000, 0x00000008, 0x00000000, 0x00000008,
+        0x00000000, 0x00000008, 0x00000000, 0x00000008
+    },
+    {
+        0x00000000, 0x00000000, 0x00800000, 0x00800000,
+        0x00008000, 0x00008000, 0x00808000, 0x00808000,
+        0x00000080, 0x00000080, 0x00800080, 0x00800080,
+        0x00008080, 0x00008080, 0x00808080, 0x00808080
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x01000000, 0x01000000,
+        0x00010000, 0x00010000, 0x01010000, 0x01010000,
+        0x00000100, 0x00000100, 0x01000100, 0x01000100,
+        0x00010100, 0x00010100, 0x01010100, 0x01010100
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x02000000, 0x02000000,
+        0x00020000, 0x00020000, 0x02020000, 0x02020000,
+        0x00000200, 0x00000200, 0x02000200, 0x02000200,
+        0x00020200, 0x00020200, 0x02020200, 0x02020200
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x04000000, 0x04000000,
+        0x00040000, 0x00040000, 0x04040000, 0x04040000,
+        0x00000400, 0x00000400, 0x04000400, 0x04000400,
+        0x00040400, 0x00040400, 0x04040400, 0x04040400
+    },
+    {
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000, 0x00000000, 0x00000000
+    },
+    {
+        0x00000000, 0x00000000, 0x08000000, 0x08000000,
+        0x00080000, 0x00080000, 0x08080000, 0x08080000,
+        0x00000800, 0x00000800, 0x08000800, 0x08000800,
+        0x00080800, 0x00080800, 0x08080800, 0x08080800
+    }
+};
+
+const uint32_t des_pc2_c[4][128] = {
+    {
+        0x00000000, 0x00000010, 0x00004000, 0x00004010,
+        0x00040000, 0x00040010, 0x00044000, 0x00044010,
+        0x00000100, 0x00000110, 0x00004100, 0x00004110,
+        0x00040100, 0x00040110, 0x00044100, 0x00044110,
+        0x00020000, 0x00020010, 0x00024000, 0x00024010,
+        0x00060000, 0x00060010, 0x00064000, 0x00064010,
+        0x00020100, 0x00020110, 0x00024100, 0x00024110,
+        0x00060100, 0x00060110, 0x00064100, 0x00064110,
+        0x00000001, 0x00000011, 0x00004001, 0x00004011,
+        0x00040001, 0x00040011, 0x00044001, 0x00044011,
+        0x00000101, 0x00000111, 0x00004101, 0x00004111,
+        0x00040101, 0x00040111, 0x00044101, 0x00044111,
+        0x00020001, 0x00020011, 0x00024001, 0x00024011,
+        0x00060001, 0x00060011, 0x00064001, 0x00064011,
+        0x00020101, 0x00020111, 0x00024101, 0x00024111,
+        0x00060101, 0x00060111, 0x00064101, 0x00064111,
+        0x00080000, 0x00080010, 0x00084000, 0x00084010,
+        0x000c0000, 0x000c0010, 0x000c4000, 0x000c4010,
+        0x00080100, 0x00080110, 0x00084100, 0x00084110,
+        0x000c0100, 0x000c0110, 0x000c4100, 0x000c4110,
+        0x000a0000, 0x000a0010, 0x000a4000, 0x000a4010,
+        0x000e0000, 0x000e0010, 0x000e4000, 0x000e4010,
+        0x000a0100, 0x000a0110, 0x000a4100, 0x000a4110,
+        0x000e0100, 0x000e0110, 0x000e4100, 0x000e4110,
+        0x00080001, 0x00080011, 0x00084001, 0x00084011,
+        0x000c0001, 0x000c0011, 0x000c4001, 0x000c4011,
+        0x00080101, 0x00080111, 0x00084101, 0x00084111,
+        0x000c0101, 0x000c0111, 0x000c4101, 0x000c4111,
+        0x000a0001, 0x000a0011, 0x000a4001, 0x000a4011,
+        0x000e0001, 0x000e0011, 0x000e4001, 0x000e4011,
+        0x000a0101, 0x000a0111, 0x000a4101, 0x000a4111,
+        0x000e0101, 0x000e0111, 0x000e4101, 0x000e4111
+    },
+    {
+        0x00000000, 0x00800000, 0x00000002, 0x00800002,
+        0x00000200, 0x00800200, 0x00000202, 0x00800202,
+        0x00200000, 0x00a00000, 0x00200002, 0x00a00002,
+        0x00200200, 0x00a00200, 0x00200202, 0x00a00202,
+        0x00001000, 0x00801000, 0x00001002, 0x00801002,
+        0x00001200, 0x00801200, 0x00001202, 0x00801202,
+        0x00201000, 0x00a01000, 0x00201002, 0x00a01002,
+        0x00201200, 0x00a01200, 0x00201202, 0x00a01202,
+        0x00000000, 0x00800000, 0x00000002, 0x00800002,
+        0x00000200, 0x00800200, 0x00000202, 0x00800202,
+        0x00200000, 0x00a00000, 0x00200002, 0x00a00002,
+        0x00200200, 0x00a00200, 0x00200202, 0x00a00202,
+        0x00001000, 0x00801000, 0x00001002, 0x00801002,
+        0x00001200, 0x00801200, 0x00001202, 0x00801202,
+        0x00201000, 0x00a01000, 0x00201002, 0x00a01002,
+        0x00201200, 0x00a01200, 0x00201202, 0x00a01202,
+        0x00000040, 0x00800040, 0x00000042, 0x00800042,
+        0x00000240, 0x00800240, 0x00000242, 0x00800242,
+        0x00200040, 0x00a00040, 0x00200042, 0x00a00042,
+        0x00200240, 0x00a00240, 0x00200242, 0x00a00242,
+        0x00001040, 0x00801040, 0x00001042, 0x00801042,
+        0x00001240, 0x00801240, 0x00001242, 0x00801242,
+        0x00201040, 0x00a01040, 0x00201042, 0x00a01042,
+        0x00201240, 0x00a01240, 0x00201242, 0x00a01242,
+        0x00000040, 0x00800040, 0x00000042, 0x00800042,
+        0x00000240, 0x00800240, 0x00000242, 0x00800242,
+        0x00200040, 0x00a00040, 0x00200042, 0x00a00042,
+        0x00200240, 0x00a00240, 0x00200242, 0x00a00242,
+        0x00001040, 0x00801040, 0x00001042, 0x00801042,
+        0x00001240, 0x00801240, 0x00001242, 0x00801242,
+        0x00201040, 0x00a01040, 0x00201042, 0x00a01042,
+        0x00201240, 0x00a01240, 0x00201242, 0x00a01242
+    },
+    {
+        0x00000000, 0x00002000, 0x00000004, 0x00002004,
+        0x00000400, 0x00002400, 0x00000404, 0x00002404,
+        0x00000000, 0x00002000, 0x00000004, 0x00002004,
+        0x00000400, 0x00002400, 0x00000404, 0x00002404,
+        0x00400000, 0x00402000, 0x00400004, 0x00402004,
+        0x00400400, 0x00402400, 0x00400404, 0x00402404,
+        0x00400000, 0x00402000, 0x00400004, 0x00402004,
+        0x00400400, 0x00402400, 0x00400404, 0x00402404,
+        0x00000020, 0x00002020, 0x00000024, 0x00002024,
+        0x00000420, 0x00002420, 0x00000424, 0x00002424,
+        0x00000020, 0x00002020, 0x00000024, 0x00002024,
+        0x00000420, 0x00002420, 0x00000424, 0x00002424,
+        0x00400020, 0x00402020, 0x00400024, 0x00402024,
+        0x00400420, 0x00402420, 0x00400424, 0x00402424,
+        0x00400020, 0x00402020, 0x00400024, 0x00402024,
+        0x00400420, 0x00402420, 0x00400424, 0x00402424,
+        0x00008000, 0x0000a000, 0x00008004, 0x0000a004,
+        0x00008400, 0x0000a400, 0x00008404, 0x0000a404,
+        0x00008000, 0x0000a000, 0x00008004, 0x0000a004,
+        0x00008400, 0x0000a400, 0x00008404, 0x0000a404,
+        0x00408000, 0x0040a000, 0x00408004, 0x0040a004,
+        0x00408400, 0x0040a400, 0x00408404, 0x0040a404,
+        0x00408000, 0x0040a000, 0x00408004, 0x0040a004,
+        0x00408400, 0x0040a400, 0x00408404, 0x0040a404,
+        0x00008020, 0x0000a020, 0x00008024, 0x0000a024,
+        0x00008420, 0x0000a420, 0x00008424, 0x0000a424,
+        0x00008020, 0x0000a020, 0x00008024, 0x0000a024,
+        0x00008420, 0x0000a420, 0x00008424, 0x0000a424,
+        0x00408020, 0x0040a020, 0x00408024, 0x0040a024,
+        0x00408420, 0x0040a420, 0x00408424, 0x0040a424,
+        0x00408020, 0x0040a020, 0x00408024, 0x0040a024,
+        0x00408420, 0x0040a420, 0x00408424, 0x0040a424
+    },
+    {
+        0x00000000, 0x00010000, 0x00000008, 0x00010008,
+        0x00000080, 0x00010080, 0x00000088, 0x00010088,
+        0x00000000, 0x00010000, 0x00000008, 0x00010008,
+        0x00000080, 0x00010080, 0x00000088, 0x00010088,
+        0x00100000, 0x00110000, 0x00100008, 0x00110008,
+        0x00100080, 0x00110080, 0x00100088, 0x00110088,
+        0x00100000, 0x00110000, 0x00100008, 0x00110008,
+        0x00100080, 0x00110080, 0x00100088, 0x00110088,
+        0x00000800, 0x00010800, 0x00000808, 0x00010808,
+        0x00000880, 0x00010880, 0x00000888, 0x00010888,
+        0x00000800, 0x00010800, 0x00000808, 0x00010808,
+        0x00000880, 0x00010880, 0x00000888, 0x00010888,
+        0x00100800, 0x00110800, 0x00100808, 0x00110808,
+        0x00100880, 0x00110880, 0x00100888, 0x00110888,
+        0x00100800, 0x00110800, 0x00100808, 0x00110808,
+        0x00100880, 0x00110880, 0x00100888, 0x00110888,
+        0x00000000, 0x00010000, 0x00000008, 0x00010008,
+        0x00000080, 0x00010080, 0x00000088, 0x00010088,
+        0x00000000, 0x00010000, 0x00000008, 0x00010008,
+        0x00000080, 0x00010080, 0x00000088, 0x00010088,
+        0x00100000, 0x00110000, 0x00100008, 0x00110008,
+        0x00100080, 0x00110080, 0x00100088, 0x00110088,
+        0x00100000, 0x00110000, 0x00100008, 0x00110008,
+        0x00100080, 0x00110080, 0x00100088, 0x00110088,
+        0x00000800, 0x00010800, 0x00000808, 0x00010808,
+        0x00000880, 0x00010880, 0x00000888, 0x00010888,
+        0x00000800, 0x00010800, 0x00000808, 0x00010808,
+        0x00000880, 0x00010880, 0x00000888, 0x00010888,
+        0x00100800, 0x00110800, 0x00100808, 0x00110808,
+        0x00100880, 0x00110880, 0x00100888, 0x00110888,
+        0x00100800, 0x00110800, 0x00100808, 0x00110808,
+        0x00100880, 0x00110880, 0x00100888, 0x00110888
+    }
+};
+
+const uint32_t des_pc2_d[4][128] = {
+    {
+        0x00000000, 0x00000000, 0x00000080, 0x00000080,
+        0x00002000, 0x00002000, 0x00002080, 0x00002080,
+        0x00000001, 0x00000001, 0x00000081, 0x00000081,
+        0x00002001, 0x00002001, 0x00002081, 0x00002081,
+        0x00200000, 0x00200000, 0x00200080, 0x00200080,
+        0x00202000, 0x00202000, 0x00202080, 0x00202080,
+        0x00200001, 0x00200001, 0x00200081, 0x00200081,
+        0x00202001, 0x00202001, 0x00202081, 0x00202081,
+        0x00020000, 0x00020000, 0x00020080, 0x00020080,
+        0x00022000, 0x00022000, 0x00022080, 0x00022080,
+        0x00020001, 0x00020001, 0x00020081, 0x00020081,
+        0x00022001, 0x00022001, 0x00022081, 0x00022081,
+        0x00220000, 0x00220000, 0x00220080, 0x00220080,
+        0x00222000, 0x00222000, 0x00222080, 0x00222080,
+        0x00220001, 0x00220001, 0x00220081, 0x00220081,
+        0x00222001, 0x00222001, 0x00222081, 0x00222081,
+        0x00000002, 0x00000002, 0x00000082, 0x00000082,
+        0x00002002, 0x00002002, 0x00002082, 0x00002082,
+        0x00000003, 0x00000003, 0x00000083, 0x00000083,
+        0x00002003, 0x00002003, 0x00002083, 0x00002083,
+        0x00200002, 0x00200002, 0x00200082, 0x00200082,
+        0x00202002, 0x00202002, 0x00202082, 0x00202082,
+        0x00200003, 0x00200003, 0x00200083, 0x00200083,
+        0x00202003, 0x00202003, 0x00202083, 0x00202083,
+        0x00020002, 0x00020002, 0x00020082, 0x00020082,
+        0x00022002, 0x00022002, 0x00022082, 0x00022082,
+        0x00020003, 0x00020003, 0x00020083, 0x00020083,
+        0x00022003, 0x00022003, 0x00022083, 0x00022083,
+        0x00220002, 0x00220002, 0x00220082, 0x00220082,
+        0x00222002, 0x00222002, 0x00222082, 0x00222082,
+        0x00220003, 0x00220003, 0x00220083, 0x00220083,
+        0x00222003, 0x00222003, 0x00222083, 0x00222083
+    },
+    {
+        0x00000000, 0x00000010, 0x00800000, 0x00800010,
+        0x00010000, 0x00010010, 0x00810000, 0x00810010,
+        0x00000200, 0x00000210, 0x00800200, 0x00800210,
+        0x00010200, 0x00010210, 0x00810200, 0x00810210,
+        0x00000000, 0x00000010, 0x00800000, 0x00800010,
+        0x00010000, 0x00010010, 0x00810000, 0x00810010,
+        0x00000200, 0x00000210, 0x00800200, 0x00800210,
+        0x00010200, 0x00010210, 0x00810200, 0x00810210,
+        0x00100000, 0x00100010, 0x00900000, 0x00900010,
+        0x00110000, 0x00110010, 0x00910000, 0x00910010,
+        0x00100200, 0x00100210, 0x00900200, 0x00900210,
+        0x00110200, 0x00110210, 0x00910200, 0x00910210,
+        0x00100000, 0x00100010, 0x00900000, 0x00900010,
+        0x00110000, 0x00110010, 0x00910000, 0x00910010,
+        0x00100200, 0x00100210, 0x00900200, 0x00900210,
+        0x00110200, 0x00110210, 0x00910200, 0x00910210,
+        0x00000004, 0x00000014, 0x00800004, 0x00800014,
+        0x00010004, 0x00010014, 0x00810004, 0x00810014,
+        0x00000204, 0x00000214, 0x00800204, 0x00800214,
+        0x00010204, 0x00010214, 0x00810204, 0x00810214,
+        0x00000004, 0x00000014, 0x00800004, 0x00800014,
+        0x00010004, 0x00010014, 0x00810004, 0x00810014,
+        0x00000204, 0x00000214, 0x00800204, 0x00800214,
+        0x00010204, 0x00010214, 0x00810204, 0x00810214,
+        0x00100004, 0x00100014, 0x00900004, 0x00900014,
+        0x00110004, 0x00110014, 0x00910004, 0x00910014,
+        0x00100204, 0x00100214, 0x00900204, 0x00900214,
+        0x00110204, 0x00110214, 0x00910204, 0x00910214,
+        0x00100004, 0x00100014, 0x00900004, 0x00900014,
+        0x00110004, 0x00110014, 0x00910004, 0x00910014,
+        0x00100204, 0x00100214, 0x00900204, 0x00900214,
+        0x00110204, 0x00110214, 0x00910204, 0x00910214
+    },
+    {
+        0x00000000, 0x00000400, 0x00001000, 0x00001400,
+        0x00080000, 0x00080400, 0x00081000, 0x00081400,
+        0x00000020, 0x00000420, 0x00001020, 0x00001420,
+        0x00080020, 0x00080420, 0x00081020, 0x00081420,
+        0x00004000, 0x00004400, 0x00005000, 0x00005400,
+        0x00084000, 0x00084400, 0x00085000, 0x00085400,
+        0x00004020, 0x00004420, 0x00005020, 0x00005420,
+        0x00084020, 0x00084420, 0x00085020, 0x00085420,
+        0x00000800, 0x00000c00, 0x00001800, 0x00001c00,
+        0x00080800, 0x00080c00, 0x00081800, 0x00081c00,
+        0x00000820, 0x00000c20, 0x00001820, 0x00001c20,
+        0x00080820, 0x00080c20, 0x00081820, 0x00081c20,
+        0x00004800, 0x00004c00, 0x00005800, 0x00005c00,
+        0x00084800, 0x00084c00, 0x00085800, 0x00085c00,
+        0x00004820, 0x00004c20, 0x00005820, 0x00005c20,
+        0x00084820, 0x00084c20, 0x00085820, 0x00085c20,
+        0x00000000, 0x00000400, 0x00001000, 0x00001400,
+        0x00080000, 0x00080400, 0x00081000, 0x00081400,
+        0x00000020, 0x00000420, 0x00001020, 0x00001420,
+        0x00080020, 0x00080420, 0x00081020, 0x00081420,
+        0x00004000, 0x00004400, 0x00005000, 0x00005400,
+        0x00084000, 0x00084400, 0x00085000, 0x00085400,
+        0x00004020, 0x00004420, 0x00005020, 0x00005420,
+        0x00084020, 0x00084420, 0x00085020, 0x00085420,
+        0x00000800, 0x00000c00, 0x00001800, 0x00001c00,
+        0x00080800, 0x00080c00, 0x00081800, 0x00081c00,
+        0x00000820, 0x00000c20, 0x00001820, 0x00001c20,
+        0x00080820, 0x00080c20, 0x00081820, 0x00081c20,
+        0x00004800, 0x00004c00, 0x00005800, 0x00005c00,
+        0x00084800, 0x00084c00, 0x00085800, 0x00085c00,
+        0x00004820, 0x00004c20, 0x00005820, 0x00005c20,
+        0x00084820, 0x00084c20, 0x00085820, 0x00085c20
+    },
+    {
+        0x00000000, 0x00000100, 0x00040000, 0x00040100,
+        0x00000000, 0x00000100, 0x00040000, 0x00040100,
+        0x00000040, 0x00000140, 0x00040040, 0x00040140,
+        0x00000040, 0x00000140, 0x00040040, 0x00040140,
+        0x00400000, 0x00400100, 0x00440000, 0x00440100,
+        0x00400000, 0x00400100, 0x00440000, 0x00440100,
+        0x00400040, 0x00400140, 0x00440040, 0x00440140,
+        0x00400040, 0x00400140, 0x00440040, 0x00440140,
+        0x00008000, 0x00008100, 0x00048000, 0x00048100,
+        0x00008000, 0x00008100, 0x00048000, 0x00048100,
+        0x00008040, 0x00008140, 0x00048040, 0x00048140,
+        0x00008040, 0x00008140, 0x00048040, 0x00048140,
+        0x00408000, 0x00408100, 0x00448000, 0x00448100,
+        0x00408000, 0x00408100, 0x00448000, 0x00448100,
+        0x00408040, 0x00408140, 0x00448040, 0x00448140,
+        0x00408040, 0x00408140, 0x00448040, 0x00448140,
+        0x00000008, 0x00000108, 0x00040008, 0x00040108,
+        0x00000008, 0x00000108, 0x00040008, 0x00040108,
+        0x00000048, 0x00000148, 0x00040048, 0x00040148,
+        0x00000048, 0x00000148, 0x00040048, 0x00040148,
+        0x00400008, 0x00400108, 0x00440008, 0x00440108,
+        0x00400008, 0x00400108, 0x00440008, 0x00440108,
+        0x00400048, 0x00400148, 0x00440048, 0x00440148,
+        0x00400048, 0x00400148, 0x00440048, 0x00440148,
+        0x00008008, 0x00008108, 0x00048008, 0x00048108,
+        0x00008008, 0x00008108, 0x00048008, 0x00048108,
+        0x00008048, 0x00008148, 0x00048048, 0x00048148,
+        0x00008048, 0x00008148, 0x00048048, 0x00048148,
+        0x00408008, 0x00408108, 0x00448008, 0x00448108,
+        0x00408008, 0x00408108, 0x00448008, 0x00448108,
+        0x00408048, 0x00408148, 0x00448048, 0x00448148,
+        0x00408048, 0x00408148, 0x00448048, 0x00448148
+    }
+};
+
 struct des {
     uint64_t skey[16];
 };
 
 extern inline uint32_t des_rotl28(uint32_t data, uint32_t count)
 {
-    return ((data << count) | (data >> (28 - count)));
+    return ((data << count) | (data >> (28 - count))) & 0xFFFFFFF;
+}
+
+static inline uint32_t des_rotl32(uint32_t data, uint32_t count)
+{
+    return ((data << count) | (data >> (32 - count)));
 }
 
 static inline void des_choice_1_permute(uint32_t* C, uint32_t* D,
                                         uint64_t key)
 {
-    uint64_t result = 0;
-    size_t pos = 0;
+    uint32_t c = 0;
+    uint32_t d = 0;
+    size_t n = 0;
 
-    for (pos = 0; pos < 56; pos++) {
-        result = result << 1;
-        result += (key >> (64 - des_permuted_choice_1[pos])) & 1;
+    for (n = 0; n < 16; n++) {
+        c = c | des_pc1_c[n][(key >> (60 - 4 * n)) & 0xf];
+        d = d | des_pc1_d[n][(key >> (60 - 4 * n)) & 0xf];
     }
 
-    *C = (uint32_t) (result >> 28) & 0xFFFFFF;
-    *D = (uint32_t) result & 0xFFFFFFF;
+    *C = c;
+    *D = d;
 }
 
 static inline void des_choice_2_permute(uint64_t* output, uint32_t C,
                                         uint32_t D)
 {
-    uint64_t input = ((uint64_t) C << 28) ^ ((uint64_t) D);
-    uint64_t result = 0;
-    size_t pos = 0;
+    uint32_t c = des_pc2_c[0][(C >> 21) & 0x7f] |
+                 des_pc2_c[1][(C >> 14) & 0x7f] |
+                 des_pc2_c[2][(C >>  7) & 0x7f] |
+                 des_pc2_c[3][(C >>  0) & 0x7f];
+    uint32_t d = des_pc2_d[0][(D >> 21) & 0x7f] |
+                 des_pc2_d[1][(D >> 14) & 0x7f] |
+                 des_pc2_d[2][(D >>  7) & 0x7f] |
+                 des_pc2_d[3][(D >>  0) & 0x7f];
 
-    for (pos = 0; pos < 48; pos++) {
-        result = result << 1;
-        result += (input >> (56 - des_permuted_choice_2[pos])) & 1;
-    }
+    *output = ((uint64_t) c << 24) | ((uint64_t) d);
+}
 
-    *output = result;
+/*
+ * des des_swap_move
+ *
+ * Exchanges the bits of a selected by mask (after shifting a right by shift)
+ * with the bits of b selected by mask.
+*/
+static inline void des_swap_move(uint32_t* a, uint32_t* b, uint32_t shift,
+                                 uint32_t mask)
+{
+    uint32_t tmp = (((*a) >> shift) ^ (*b)) & mask;
+    *b = (*b) ^ tmp;
+    *a = (*a) ^ (tmp << shift);
 }
 
+/*
+ * des des_initial_permute
+ *
+ * The initial permutation IP (des_initial_permutation_shifts) as a network
+ * of five swap-moves: IP is a transpose of the 8x8 bit matrix of the block
+ * combined with a fixed reordering of rows and columns, both of which
+ * decompose into exchanges of 4, 16, 2, 8 and 1 bit wide groups.
+*/
 static inline void des_initial_permute(uint32_t* left, uint32_t* right,
                                        uint64_t input)
 {
-    uint64_t result = 0;
-    size_t pos = 0;
+    uint32_t l = (uint32_t) (input >> 32);
+    uint32_t r = (uint32_t) input;
 
-    for (pos = 0; pos < 64; pos++) {
-        result = result << 1;
-        result += (input >> (64 - des_initial_permutation_shifts[pos])) & 1;
-    }
+    des_swap_move(&l, &r, 4, 0x0f0f0f0f);
+    des_swap_move(&l, &r, 16, 0x0000ffff);
+    des_swap_move(&r, &l, 2, 0x33333333);
+    des_swap_move(&r, &l, 8, 0x00ff00ff);
+    des_swap_move(&l, &r, 1, 0x55555555);
 
-    *left = (uint32_t) (result >> 32);
-    *right = (uint32_t) result;
+    *left = l;
+    *right = r;
 }
 
+/*
+ * des des_inverse_permute
+ *
+ * The final permutation IP^-1 (des_inverse_permutation_shifts); the
+ * swap-moves of des_initial_permute applied in reverse order.
+*/
 static inline void des_inverse_permute(uint64_t* output, uint32_t left,
                                        uint32_t right)
 {
-    uint64_t input = ((uint64_t) left << 32) ^ ((uint64_t) right);
-    uint64_t result = 0;
-    size_t pos = 0;
-
-    for (pos = 0; pos < 64; pos++) {
-        result = result << 1;
-        result += (input >> (64 - des_inverse_permutation_shifts[pos])) & 1;
-    }
+    des_swap_move(&left, &right, 1, 0x55555555);
+    des_swap_move(&right, &left, 8, 0x00ff00ff);
+    des_swap_move(&right, &left, 2, 0x33333333);
+    des_swap_move(&left, &right, 16, 0x0000ffff);
+    des_swap_move(&left, &right, 4, 0x0f0f0f0f);
 
-    *output = result;
+    *output = ((uint64_t) left << 32) ^ ((uint64_t) right);
 }
 
-static inline uint32_t des_permute_p(uint32_t input)
+/*
+ * des des_f
+ *
+ * The cipher function f. S-box i + 1 reads six consecutive bits of the E
+ * expansion of R, which are bits 4i to 4i + 5 of R (1-indexed, wrapping
+ * around); rotating R left by 4i + 5 brings them to the bottom. The matching
+ * six bits of the 48-bit round key are xored in and the combined S-box and P
+ * table gives the contribution of that S-box to f.
+*/
+static inline uint32_t des_f(uint32_t input, uint64_t key)
 {
-    uint32_t result = 0;
-    size_t pos = 0;
-
-    for (pos = 0; pos < 32; pos++) {
-        result = result << 1;
-        result += (input >> (32 - des_primitive_function_p[pos])) & 1;
-    }
-
-    return result;
+    return des_sp[0][(des_rotl32(input,  5) ^ (key >> 42)) & 0x3f] ^
+           des_sp[1][(des_rotl32(input,  9) ^ (key >> 36)) & 0x3f] ^
+           des_sp[2][(des_rotl32(input, 13) ^ (key >> 30)) & 0x3f] ^
+           des_sp[3][(des_rotl32(input, 17) ^ (key >> 24)) & 0x3f] ^
+           des_sp[4][(des_rotl32(input, 21) ^ (key >> 18)) & 0x3f] ^
+           des_sp[5][(des_rotl32(input, 25) ^ (key >> 12)) & 0x3f] ^
+           des_sp[6][(des_rotl32(input, 29) ^ (key >>  6)) & 0x3f] ^
+           des_sp[7][(des_rotl32(input,  1) ^ (key >>  0)) & 0x3f];
 }
 
-static inline uint64_t des_expand(uint32_t input)
+/*
+ * des des_load64
+ *
+ * Reads a block from eight bytes in big-endian (FIPS 46-3 bit) order.
+*/
+static inline uint64_t des_load64(const uint8_t* data)
 {
-    uint64_t result = 0;
-    size_t pos = 0;
-
-    for (pos = 0; pos < 48; pos++) {
-        result = result << 1;
-        result += (input >> (32 - des_expand_shifts[pos])) & 1;
-    }
-
-    return result;
+    return ((uint64_t) data[0] << 56) ^ ((uint64_t) data[1] << 48) ^
+           ((uint64_t) data[2] << 40) ^ ((uint64_t) data[3] << 32) ^
+           ((uint64_t) data[4] << 24) ^ ((uint64_t) data[5] << 16) ^
+           ((uint64_t) data[6] <<  8) ^ ((uint64_t) data[7] <<  0);
 }
 
-static inline uint32_t des_f(uint32_t input, uint64_t key)
+/*
+ * des des_store64
+ *
+ * Writes a block to eight bytes in big-endian order; inverse of des_load64.
+*/
+static inline void des_store64(uint8_t* data, uint64_t block)
 {
-    size_t pos = 0;
-    uint64_t expanded_input = des_expand(input);
-    uint32_t result = 0;
-
-    uint8_t data;
-    uint8_t col;
-    uint8_t row;
-
-    expanded_input = expanded_input ^ key;
-
-    for (pos = 0; pos < 8; pos++) {
-        result = result << 4;
-        data = (uint8_t) (expanded_input >> (48 - (6 * (pos + 1)))) & 0x3f;
-        col = (data & 0x1e) >> 1;
-        row = ((data & 0x20) >> 4) ^ (data & 0x01);
-
-        result += des_primitive_functions[pos][row * 16 + col];
-    }
-
-    result = des_permute_p(result);
-
-    return result;
+    data[0] = (uint8_t) (block >> 56);
+    data[1] = (uint8_t) (block >> 48);
+    data[2] = (uint8_t) (block >> 40);
+    data[3] = (uint8_t) (block >> 32);
+    data[4] = (uint8_t) (block >> 24);
+    data[5] = (uint8_t) (block >> 16);
+    data[6] = (uint8_t) (block >>  8);
+    data[7] = (uint8_t) (block >>  0);
 }
 
 static inline void des_init(struct des* d, uint64_t key)
@@ -269,23 +942,61 @@ static inline void des_init(struct des* d, uint64_t key)
     des_choice_2_permute(&(d->skey[15]), C, D);
 }
 
+/*
+ * des des_encrypt_rounds
+ *
+ * Runs the 16 rounds of encryption in the permuted domain, i.e. without IP
+ * and IP^-1. left and right hold L0 and R0 on input and the preoutput block
+ * R16 and L16 on output, so calls may be chained (as in triple DES) with a
+ * single des_initial_permute before and des_inverse_permute after.
+*/
+static inline void des_encrypt_rounds(struct des* d, uint32_t* left,
+                                      uint32_t* right)
+{
+    uint32_t l = *left;
+    uint32_t r = *right;
+    size_t a = 0;
+
+    for (a = 0; a < 16; a += 2) {
+        l = l ^ des_f(r, d->skey[a]);
+        r = r ^ des_f(l, d->skey[a + 1]);
+    }
+
+    *left = r;
+    *right = l;
+}
+
+/*
+ * des des_decrypt_rounds
+ *
+ * Inverse of des_encrypt_rounds: the 16 rounds with the key schedule used in
+ * reverse order. Same conventions for left and right.
+*/
+static inline void des_decrypt_rounds(struct des* d, uint32_t* left,
+                                      uint32_t* right)
+{
+    uint32_t l = *left;
+    uint32_t r = *right;
+    size_t a = 0;
+
+    for (a = 16; a > 0; a -= 2) {
+        l = l ^ des_f(r, d->skey[a - 1]);
+        r = r ^ des_f(l, d->skey[a - 2]);
+    }
+
+    *left = r;
+    *right = l;
+}
+
 static inline uint64_t des_encrypt_block(struct des* d, uint64_t input)
 {
     uint32_t left;
     uint32_t right;
-    uint32_t tmp;
     uint64_t result;
-    size_t a = 0;
 
     des_initial_permute(&left, &right, input);
-
-    for (a = 0; a < 16; a++) {
-        tmp = right;
-        right = left ^ des_f(right, d->skey[a]);
-        left = tmp;
-    }
-
-    des_inverse_permute(&result, right, left);
+    des_encrypt_rounds(d, &left, &right);
+    des_inverse_permute(&result, left, right);
 
     return result;
 }
@@ -294,21 +1005,182 @@ static inline uint64_t des_decrypt_block(struct des* d, uint64_t input)
 {
     uint32_t left;
     uint32_t right;
-    uint32_t tmp;
     uint64_t result;
-    size_t a = 0;
 
     des_initial_permute(&left, &right, input);
+    des_decrypt_rounds(d, &left, &right);
+    des_inverse_permute(&result, left, right);
+
+    return result;
+}
+
+/*
+ * des des_rounds4
+ *
+ * des_encrypt_rounds (decrypt = 0) or des_decrypt_rounds on four
+ * independent blocks at once, interleaved so that their table lookups
+ * overlap. Same conventions for left and right, which hold four words each.
+*/
+static inline void des_rounds4(struct des* d, uint32_t* left,
+                               uint32_t* right, int decrypt)
+{
+    size_t a = 0;
+    size_t j = 0;
+    uint32_t t = 0;
+
+    for (a = 0; a < 16; a += 2) {
+        uint64_t k0 = d->skey[decrypt ? 15 - a : a];
+        uint64_t k1 = d->skey[decrypt ? 14 - a : a + 1];
 
-    for (a = 16; a > 0; a--) {
-        tmp = right;
-        right = left ^ des_f(right, d->skey[a - 1]);
-        left = tmp;
+        for (j = 0; j < 4; j++) {
+            left[j] = left[j] ^ des_f(right[j], k0);
+        }
+        for (j = 0; j < 4; j++) {
+            right[j] = right[j] ^ des_f(left[j], k1);
+        }
     }
 
-    des_inverse_permute(&result, right, left);
+    for (j = 0; j < 4; j++) {
+        t = left[j];
+        left[j] = right[j];
+        right[j] = t;
+    }
+}
 
-    return result;
+/*
+ * des des_crypt4
+ *
+ * Encrypts (decrypt = 0) or decrypts the four blocks in place.
+*/
+static inline void des_crypt4(struct des* d, uint64_t* blocks, int decrypt)
+{
+    size_t j = 0;
+    uint32_t left[4];
+    uint32_t right[4];
+
+    for (j = 0; j < 4; j++) {
+        des_initial_permute(&left[j], &right[j], blocks[j]);
+    }
+
+    des_rounds4(d, left, right, decrypt);
+
+    for (j = 0; j < 4; j++) {
+        des_inverse_permute(&blocks[j], left[j], right[j]);
+    }
+}
+
+/*
+ * des des_cbc_encrypt
+ *
+ * Encrypts len bytes from input into output in CBC mode; input and output
+ * may be the same buffer. iv holds the initialization vector on entry and
+ * the last ciphertext block on return, so a message may be processed in
+ * several calls. len must be a multiple of 8; a trailing partial block is
+ * ignored.
+*/
+static inline void des_cbc_encrypt(struct des* d, uint64_t* iv,
+                                   const uint8_t* input, uint8_t* output,
+                                   size_t len)
+{
+    size_t i = 0;
+    uint64_t chain = *iv;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        chain = des_encrypt_block(d, des_load64(input + i) ^ chain);
+        des_store64(output + i, chain);
+    }
+
+    *iv = chain;
+}
+
+/*
+ * des des_cbc_decrypt
+ *
+ * Inverse of des_cbc_encrypt, with the same conventions. Decryption of
+ * different blocks is independent, so four are processed at a time.
+*/
+static inline void des_cbc_decrypt(struct des* d, uint64_t* iv,
+                                   const uint8_t* input, uint8_t* output,
+                                   size_t len)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint64_t chain = *iv;
+    uint64_t cipher[4];
+    uint64_t plain[4];
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        for (j = 0; j < 4; j++) {
+            cipher[j] = des_load64(input + i + 8 * j);
+            plain[j] = cipher[j];
+        }
+
+        des_crypt4(d, plain, 1);
+
+        for (j = 0; j < 4; j++) {
+            des_store64(output + i + 8 * j, plain[j] ^ chain);
+            chain = cipher[j];
+        }
+    }
+
+    for (; i + 8 <= len; i += 8) {
+        cipher[0] = des_load64(input + i);
+        des_store64(output + i, des_decrypt_block(d, cipher[0]) ^ chain);
+        chain = cipher[0];
+    }
+
+    *iv = chain;
+}
+
+/*
+ * des des_ctr_xor
+ *
+ * Encrypts or decrypts len bytes from input into output in CTR mode; input
+ * and output may be the same buffer. counter is the 64-bit counter block,
+ * incremented (modulo 2^64) once per block; on return it holds the counter
+ * for the block following the last one used. len need not be a multiple of
+ * 8, but a message may only be split across calls at block boundaries.
+*/
+static inline void des_ctr_xor(struct des* d, uint64_t* counter,
+                               const uint8_t* input, uint8_t* output,
+                               size_t len)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint64_t ctr = *counter;
+    uint64_t pad[4];
+    uint8_t tail[8];
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        for (j = 0; j < 4; j++) {
+            pad[j] = ctr + j;
+        }
+
+        des_crypt4(d, pad, 0);
+
+        for (j = 0; j < 4; j++) {
+            des_store64(output + i + 8 * j,
+                        des_load64(input + i + 8 * j) ^ pad[j]);
+        }
+
+        ctr = ctr + 4;
+    }
+
+    for (; i < len; i += 8) {
+        pad[0] = des_encrypt_block(d, ctr);
+        ctr = ctr + 1;
+
+        if (i + 8 <= len) {
+            des_store64(output + i, des_load64(input + i) ^ pad[0]);
+        } else {
+            des_store64(tail, pad[0]);
+            for (j = 0; i + j < len; j++) {
+                output[i + j] = input[i + j] ^ tail[j];
+            }
+        }
+    }
+
+    *counter = ctr;
 }
 
 #endif
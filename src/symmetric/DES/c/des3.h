@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Implementation of the triple des (TDEA) encryption algorithm per NIST SP
+ * 800-67, in the EDE form with three (keying option 1) or two (keying
+ * option 2) independent keys. See docs for the specification.
+ *
+ * A block is encrypted as E_K3(D_K2(E_K1(P))). The final permutation of each
+ * stage cancels against the initial permutation of the next, so only one IP
+ * and one IP^-1 are applied per block and the 48 rounds run back to back.
+*/
+
+#pragma once
+#ifndef CC_DES3_H
+#define CC_DES3_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "des.h"
+
+/*
+ * struct des3
+ *
+ * struct des k1, k2, k3 -- internal; key schedules of the three stages
+*/
+struct des3 {
+    struct des k1;
+    struct des k2;
+    struct des k3;
+};
+
+/*
+ * des3 des3_init
+ *
+ * Three-key TDEA (EDE3).
+*/
+static inline void des3_init(struct des3* d, uint64_t key1, uint64_t key2,
+                             uint64_t key3)
+{
+    des_init(&(d->k1), key1);
+    des_init(&(d->k2), key2);
+    des_init(&(d->k3), key3);
+}
+
+/*
+ * des3 des3_init_2key
+ *
+ * Two-key TDEA (EDE2): K3 = K1.
+*/
+static inline void des3_init_2key(struct des3* d, uint64_t key1,
+                                  uint64_t key2)
+{
+    des3_init(d, key1, key2, key1);
+}
+
+static inline uint64_t des3_encrypt_block(struct des3* d, uint64_t input)
+{
+    uint32_t left;
+    uint32_t right;
+    uint64_t result;
+
+    des_initial_permute(&left, &right, input);
+    des_encrypt_rounds(&(d->k1), &left, &right);
+    des_decrypt_rounds(&(d->k2), &left, &right);
+    des_encrypt_rounds(&(d->k3), &left, &right);
+    des_inverse_permute(&result, left, right);
+
+    return result;
+}
+
+static inline uint64_t des3_decrypt_block(struct des3* d, uint64_t input)
+{
+    uint32_t left;
+    uint32_t right;
+    uint64_t result;
+
+    des_initial_permute(&left, &right, input);
+    des_decrypt_rounds(&(d->k3), &left, &right);
+    des_encrypt_rounds(&(d->k2), &left, &right);
+    des_decrypt_rounds(&(d->k1), &left, &right);
+    des_inverse_permute(&result, left, right);
+
+    return result;
+}
+
+/*
+ * des3 des3_crypt4
+ *
+ * Encrypts (decrypt = 0) or decrypts the four blocks in place, with the
+ * rounds of the four interleaved.
+*/
+static inline void des3_crypt4(struct des3* d, uint64_t* blocks, int decrypt)
+{
+    size_t j = 0;
+    uint32_t left[4];
+    uint32_t right[4];
+
+    for (j = 0; j < 4; j++) {
+        des_initial_permute(&left[j], &right[j], blocks[j]);
+    }
+
+    if (decrypt) {
+        des_rounds4(&(d->k3), left, right, 1);
+        des_rounds4(&(d->k2), left, right, 0);
+        des_rounds4(&(d->k1), left, right, 1);
+    } else {
+        des_rounds4(&(d->k1), left, right, 0);
+        des_rounds4(&(d->k2), left, right, 1);
+        des_rounds4(&(d->k3), left, right, 0);
+    }
+
+    for (j = 0; j < 4; j++) {
+        des_inverse_permute(&blocks[j], left[j], right[j]);
+    }
+}
+
+/*
+ * des3 des3_ecb_encrypt
+ *
+ * Encrypts len bytes from input into output in ECB mode; input and output
+ * may be the same buffer. len must be a multiple of 8; a trailing partial
+ * block is ignored.
+*/
+static inline void des3_ecb_encrypt(struct des3* d, const uint8_t* input,
+                                    uint8_t* output, size_t len)
+{
+    size_t i = 0;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        des_store64(output + i, des3_encrypt_block(d, des_load64(input + i)));
+    }
+}
+
+static inline void des3_ecb_decrypt(struct des3* d, const uint8_t* input,
+                                    uint8_t* output, size_t len)
+{
+    size_t i = 0;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        des_store64(output + i, des3_decrypt_block(d, des_load64(input + i)));
+    }
+}
+
+/*
+ * des3 des3_cbc_encrypt
+ *
+ * Encrypts len bytes from input into output in CBC mode; input and output
+ * may be the same buffer. iv holds the initialization vector on entry and
+ * the last ciphertext block on return, so a message may be processed in
+ * several calls. len must be a multiple of 8; a trailing partial block is
+ * ignored.
+*/
+static inline void des3_cbc_encrypt(struct des3* d, uint64_t* iv,
+                                    const uint8_t* input, uint8_t* output,
+                                    size_t len)
+{
+    size_t i = 0;
+    uint64_t chain = *iv;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        chain = des3_encrypt_block(d, des_load64(input + i) ^ chain);
+        des_store64(output + i, chain);
+    }
+
+    *iv = chain;
+}
+
+static inline void des3_cbc_decrypt(struct des3* d, uint64_t* iv,
+                                    const uint8_t* input, uint8_t* output,
+                                    size_t len)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint64_t chain = *iv;
+    uint64_t cipher[4];
+    uint64_t plain[4];
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        for (j = 0; j < 4; j++) {
+            cipher[j] = des_load64(input + i + 8 * j);
+            plain[j] = cipher[j];
+        }
+
+        des3_crypt4(d, plain, 1);
+
+        for (j = 0; j < 4; j++) {
+            des_store64(output + i + 8 * j, plain[j] ^ chain);
+            chain = cipher[j];
+        }
+    }
+
+    for (; i + 8 <= len; i += 8) {
+        cipher[0] = des_load64(input + i);
+        des_store64(output + i, des3_decrypt_block(d, cipher[0]) ^ chain);
+        chain = cipher[0];
+    }
+
+    *iv = chain;
+}
+
+/*
+ * des3 des3_ctr_xor
+ *
+ * CTR mode with the conventions of des_ctr_xor.
+*/
+static inline void des3_ctr_xor(struct des3* d, uint64_t* counter,
+                                const uint8_t* input, uint8_t* output,
+                                size_t len)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint64_t ctr = *counter;
+    uint64_t pad[4];
+    uint8_t tail[8];
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        for (j = 0; j < 4; j++) {
+            pad[j] = ctr + j;
+        }
+
+        des3_crypt4(d, pad, 0);
+
+        for (j = 0; j < 4; j++) {
+            des_store64(output + i + 8 * j,
+                        des_load64(input + i + 8 * j) ^ pad[j]);
+        }
+
+        ctr = ctr + 4;
+    }
+
+    for (; i < len; i += 8) {
+        pad[0] = des3_encrypt_block(d, ctr);
+        ctr = ctr + 1;
+
+        if (i + 8 <= len) {
+            des_store64(output + i, des_load64(input + i) ^ pad[0]);
+        } else {
+            des_store64(tail, pad[0]);
+            for (j = 0; i + j < len; j++) {
+                output[i + j] = input[i + j] ^ tail[j];
+            }
+        }
+    }
+
+    *counter = ctr;
+}
+
+#endif
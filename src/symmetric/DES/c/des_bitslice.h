@@ -0,0 +1,941 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Bitsliced implementation of the des encryption algorithm per FIPS46-3,
+ * after Biham's "A Fast New DES Implementation in Software". See docs for
+ * the specification.
+ *
+ * Many independent blocks are processed at once: bit j of every block is
+ * held in one machine word, one block per bit position, and the S-boxes are
+ * evaluated as boolean circuits over those words. The bit permutations
+ * (IP, E, P, IP^-1) are free, as they only select words. With GCC or Clang
+ * the word is a 256-bit vector, giving DES_BITSLICE_BLOCKS = 256 blocks per
+ * batch; it is one AVX2 register when the host has AVX2, which is checked
+ * at runtime, and two SSE2 registers otherwise. Other compilers use 64-bit
+ * integers and 64 blocks. No memory access depends on the data or the key.
+ *
+ * The key schedule is taken from a regular struct des:
+ *
+ *     struct des d;
+ *     struct des_bitslice b;
+ *     des_init(&d, key);
+ *     des_bitslice_init(&b, &d);
+ *     des_bitslice_ecb_encrypt(&b, plaintext, ciphertext, len);
+ *
+ * The per-batch cost is fixed, so this only pays off for bulk ECB or CTR
+ * work; use des_encrypt_block for single blocks and CBC encryption.
+*/
+
+#pragma once
+#ifndef CC_DES_BITSLICE_H
+#define CC_DES_BITSLICE_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "des.h"
+
+#ifdef __GNUC__
+typedef uint64_t des_bs_word __attribute__((vector_size(32)));
+#define DES_BITSLICE_WORDS 4
+#define DES_BITSLICE_INLINE inline __attribute__((always_inline))
+#else
+typedef uint64_t des_bs_word;
+#define DES_BITSLICE_WORDS 1
+#define DES_BITSLICE_INLINE inline
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_DES_BITSLICE_AVX2 1
+#endif
+
+#define DES_BITSLICE_BLOCKS (64 * DES_BITSLICE_WORDS)
+
+/*
+ * struct des_bitslice
+ *
+ * uint64_t skey[16][48] -- internal; round key bits, each all zeros or all
+ *                          ones
+*/
+struct des_bitslice {
+    uint64_t skey[16][48];
+};
+
+/*
+ * S-box circuits
+ *
+ * S-box k reads its six input bits a1 to a6 (FIPS order; a1 and a6 select
+ * the row) as bits 4 k - 1 to 4 k + 4 of right, wrapping around, xored with
+ * its six round key bits; that is E. Its four output bits, most significant
+ * first, are xored into out1 to out4, which the caller points at the words
+ * P sends them to. The circuits use AND, OR, XOR, NOT and AND-NOT gates,
+ * 53 to 59 per S-box and 447 in all. They were generated from
+ * des_primitive_functions with Kwan's method: each output is split on an
+ * input bit into two smaller functions that may disagree where the split
+ * makes the value irrelevant, and gates already built for other outputs
+ * are reused.
+*/
+static DES_BITSLICE_INLINE void des_bitslice_s1(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[31] ^ key[0];
+    des_bs_word a2 = right[0] ^ key[1];
+    des_bs_word a3 = right[1] ^ key[2];
+    des_bs_word a4 = right[2] ^ key[3];
+    des_bs_word a5 = right[3] ^ key[4];
+    des_bs_word a6 = right[4] ^ key[5];
+    des_bs_word t1 = a4 ^ a5;
+    des_bs_word t2 = a6 ^ t1;
+    des_bs_word t3 = a3 & ~a4;
+    des_bs_word t4 = t3 | a5;
+    des_bs_word t5 = t2 & t4;
+    des_bs_word t6 = a1 ^ a4;
+    des_bs_word t7 = t2 ^ t6;
+    des_bs_word t8 = t7 & ~a3;
+    des_bs_word t9 = t5 | t8;
+    des_bs_word t10 = ~t3;
+    des_bs_word t11 = a4 ^ t4;
+    des_bs_word t12 = t7 | a3;
+    des_bs_word t13 = t11 & t12;
+    des_bs_word t14 = a1 & t13;
+    des_bs_word t15 = t10 ^ t14;
+    des_bs_word t16 = t15 & ~a2;
+    des_bs_word t17 = t9 ^ t16;
+    des_bs_word t18 = t2 & ~a1;
+    des_bs_word t19 = t15 ^ t18;
+    des_bs_word t20 = a5 & ~t2;
+    des_bs_word t21 = t19 & ~t20;
+    des_bs_word t22 = t1 & t17;
+    des_bs_word t23 = t5 ^ t22;
+    des_bs_word t24 = t23 & ~a3;
+    des_bs_word t25 = t21 ^ t24;
+    des_bs_word t26 = t3 | t19;
+    des_bs_word t27 = t10 | t20;
+    des_bs_word t28 = a1 & t27;
+    des_bs_word t29 = t26 ^ t28;
+    des_bs_word t30 = a4 & ~a3;
+    des_bs_word t31 = t29 | t30;
+    des_bs_word t32 = a2 & t31;
+    des_bs_word t33 = t25 ^ t32;
+    des_bs_word t34 = t15 & ~t8;
+    des_bs_word t35 = ~t31;
+    des_bs_word t36 = t35 ^ t34;
+    des_bs_word t37 = a6 & t31;
+    des_bs_word t38 = a1 & t37;
+    des_bs_word t39 = t36 | t38;
+    des_bs_word t40 = t11 | t35;
+    des_bs_word t41 = t6 | t39;
+    des_bs_word t42 = t8 ^ t41;
+    des_bs_word t43 = a5 & t42;
+    des_bs_word t44 = t40 ^ t43;
+    des_bs_word t45 = t44 & ~a2;
+    des_bs_word t46 = t39 ^ t45;
+    des_bs_word t47 = t17 ^ t33;
+    des_bs_word t48 = t39 ^ t47;
+    des_bs_word t49 = t16 | t21;
+    des_bs_word t50 = t47 ^ t49;
+    des_bs_word t51 = a5 & t50;
+    des_bs_word t52 = t48 ^ t51;
+    des_bs_word t53 = t24 ^ t51;
+    des_bs_word t54 = t36 | t52;
+    des_bs_word t55 = a1 ^ t54;
+    des_bs_word t56 = t55 & ~a2;
+    des_bs_word t57 = t53 ^ t56;
+    des_bs_word t58 = t57 & ~a4;
+    des_bs_word t59 = t52 ^ t58;
+
+    *out1 = *out1 ^ t17;
+    *out2 = *out2 ^ t33;
+    *out3 = *out3 ^ t46;
+    *out4 = *out4 ^ t59;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s2(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[3] ^ key[0];
+    des_bs_word a2 = right[4] ^ key[1];
+    des_bs_word a3 = right[5] ^ key[2];
+    des_bs_word a4 = right[6] ^ key[3];
+    des_bs_word a5 = right[7] ^ key[4];
+    des_bs_word a6 = right[8] ^ key[5];
+    des_bs_word t1 = a4 ^ a5;
+    des_bs_word t2 = ~a1;
+    des_bs_word t3 = t1 ^ t2;
+    des_bs_word t4 = ~a3;
+    des_bs_word t5 = a4 & ~t1;
+    des_bs_word t6 = t4 & ~t5;
+    des_bs_word t7 = a6 & t6;
+    des_bs_word t8 = t3 ^ t7;
+    des_bs_word t9 = a4 & ~a6;
+    des_bs_word t10 = t4 ^ t9;
+    des_bs_word t11 = a5 & ~a6;
+    des_bs_word t12 = a1 & t11;
+    des_bs_word t13 = t10 | t12;
+    des_bs_word t14 = a2 & t13;
+    des_bs_word t15 = t8 ^ t14;
+    des_bs_word t16 = a6 ^ t4;
+    des_bs_word t17 = t16 ^ a1;
+    des_bs_word t18 = a3 | a6;
+    des_bs_word t19 = t18 & ~a1;
+    des_bs_word t20 = a4 ^ t19;
+    des_bs_word t21 = a2 & t20;
+    des_bs_word t22 = t17 ^ t21;
+    des_bs_word t23 = t2 | t13;
+    des_bs_word t24 = t3 & ~t12;
+    des_bs_word t25 = t24 & ~a2;
+    des_bs_word t26 = t23 ^ t25;
+    des_bs_word t27 = a5 & t26;
+    des_bs_word t28 = t22 ^ t27;
+    des_bs_word t29 = t15 & ~t22;
+    des_bs_word t30 = t17 & ~a4;
+    des_bs_word t31 = t29 | t30;
+    des_bs_word t32 = a3 | t12;
+    des_bs_word t33 = t32 & ~a2;
+    des_bs_word t34 = t31 ^ t33;
+    des_bs_word t35 = a4 ^ t3;
+    des_bs_word t36 = a3 & t5;
+    des_bs_word t37 = t35 | t36;
+    des_bs_word t38 = a4 | t17;
+    des_bs_word t39 = a2 & ~t38;
+    des_bs_word t40 = t37 & ~t39;
+    des_bs_word t41 = a6 & t40;
+    des_bs_word t42 = t34 ^ t41;
+    des_bs_word t43 = t13 ^ t33;
+    des_bs_word t44 = a4 ^ t31;
+    des_bs_word t45 = t44 ^ t14;
+    des_bs_word t46 = t45 & ~a3;
+    des_bs_word t47 = t43 ^ t46;
+    des_bs_word t48 = t8 ^ t10;
+    des_bs_word t49 = t3 ^ t41;
+    des_bs_word t50 = t20 & ~a2;
+    des_bs_word t51 = t49 | t50;
+    des_bs_word t52 = t51 & ~a1;
+    des_bs_word t53 = t48 ^ t52;
+    des_bs_word t54 = t53 & ~a5;
+    des_bs_word t55 = t47 ^ t54;
+
+    *out1 = *out1 ^ t28;
+    *out2 = *out2 ^ t15;
+    *out3 = *out3 ^ t55;
+    *out4 = *out4 ^ t42;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s3(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[7] ^ key[0];
+    des_bs_word a2 = right[8] ^ key[1];
+    des_bs_word a3 = right[9] ^ key[2];
+    des_bs_word a4 = right[10] ^ key[3];
+    des_bs_word a5 = right[11] ^ key[4];
+    des_bs_word a6 = right[12] ^ key[5];
+    des_bs_word t1 = a2 ^ a6;
+    des_bs_word t2 = t1 ^ a1;
+    des_bs_word t3 = a3 ^ t1;
+    des_bs_word t4 = a2 & t3;
+    des_bs_word t5 = a4 ^ t4;
+    des_bs_word t6 = t1 & ~a3;
+    des_bs_word t7 = a1 & t6;
+    des_bs_word t8 = t5 ^ t7;
+    des_bs_word t9 = a4 & t8;
+    des_bs_word t10 = t2 ^ t9;
+    des_bs_word t11 = t8 & ~a6;
+    des_bs_word t12 = t11 ^ a3;
+    des_bs_word t13 = a3 ^ a4;
+    des_bs_word t14 = a1 & t13;
+    des_bs_word t15 = t12 | t14;
+    des_bs_word t16 = t15 & ~a5;
+    des_bs_word t17 = t10 ^ t16;
+    des_bs_word t18 = a6 & ~t4;
+    des_bs_word t19 = a4 & a1;
+    des_bs_word t20 = t18 | t19;
+    des_bs_word t21 = a1 & t20;
+    des_bs_word t22 = t3 ^ t21;
+    des_bs_word t23 = a1 & ~t4;
+    des_bs_word t24 = t13 & ~a1;
+    des_bs_word t25 = t23 | t24;
+    des_bs_word t26 = t25 & ~a5;
+    des_bs_word t27 = t22 ^ t26;
+    des_bs_word t28 = ~t26;
+    des_bs_word t29 = t28 | t19;
+    des_bs_word t30 = t2 & ~a4;
+    des_bs_word t31 = t30 & ~a6;
+    des_bs_word t32 = t29 ^ t31;
+    des_bs_word t33 = a5 & ~t25;
+    des_bs_word t34 = t32 & ~t33;
+    des_bs_word t35 = t2 & ~t26;
+    des_bs_word t36 = a3 & t16;
+    des_bs_word t37 = t35 ^ t36;
+    des_bs_word t38 = t10 ^ t15;
+    des_bs_word t39 = a1 & t38;
+    des_bs_word t40 = t37 | t39;
+    des_bs_word t41 = t40 & ~a2;
+    des_bs_word t42 = t34 ^ t41;
+    des_bs_word t43 = t2 & ~a2;
+    des_bs_word t44 = t5 ^ t43;
+    des_bs_word t45 = t28 ^ t44;
+    des_bs_word t46 = t45 & ~a4;
+    des_bs_word t47 = a2 ^ t46;
+    des_bs_word t48 = t47 & ~a1;
+    des_bs_word t49 = t44 ^ t48;
+    des_bs_word t50 = t33 | t38;
+    des_bs_word t51 = a6 & ~a2;
+    des_bs_word t52 = t50 | t51;
+    des_bs_word t53 = a5 & t52;
+    des_bs_word t54 = t49 ^ t53;
+
+    *out1 = *out1 ^ t54;
+    *out2 = *out2 ^ t17;
+    *out3 = *out3 ^ t42;
+    *out4 = *out4 ^ t27;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s4(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[11] ^ key[0];
+    des_bs_word a2 = right[12] ^ key[1];
+    des_bs_word a3 = right[13] ^ key[2];
+    des_bs_word a4 = right[14] ^ key[3];
+    des_bs_word a5 = right[15] ^ key[4];
+    des_bs_word a6 = right[16] ^ key[5];
+    des_bs_word t1 = a1 ^ a2;
+    des_bs_word t2 = ~a6;
+    des_bs_word t3 = t2 ^ t1;
+    des_bs_word t4 = a2 | a6;
+    des_bs_word t5 = a4 & t4;
+    des_bs_word t6 = t3 ^ t5;
+    des_bs_word t7 = a1 ^ t3;
+    des_bs_word t8 = ~t1;
+    des_bs_word t9 = t8 & ~a4;
+    des_bs_word t10 = t7 | t9;
+    des_bs_word t11 = a3 & t10;
+    des_bs_word t12 = t6 ^ t11;
+    des_bs_word t13 = t10 & ~a4;
+    des_bs_word t14 = t2 ^ t13;
+    des_bs_word t15 = a1 | t5;
+    des_bs_word t16 = a2 & ~t3;
+    des_bs_word t17 = t15 & ~t16;
+    des_bs_word t18 = a3 & t17;
+    des_bs_word t19 = t14 ^ t18;
+    des_bs_word t20 = t19 & ~a5;
+    des_bs_word t21 = t12 ^ t20;
+    des_bs_word t22 = a5 ^ t7;
+    des_bs_word t23 = t21 ^ t22;
+    des_bs_word t24 = a5 | t8;
+    des_bs_word t25 = a2 ^ t24;
+    des_bs_word t26 = t25 & ~a4;
+    des_bs_word t27 = t23 ^ t26;
+    des_bs_word t28 = a5 | t26;
+    des_bs_word t29 = t9 ^ t28;
+    des_bs_word t30 = a1 & ~a2;
+    des_bs_word t31 = t29 | t30;
+    des_bs_word t32 = a3 & t31;
+    des_bs_word t33 = t27 ^ t32;
+    des_bs_word t34 = t7 & ~t12;
+    des_bs_word t35 = t10 ^ t34;
+    des_bs_word t36 = t11 ^ t19;
+    des_bs_word t37 = t36 & ~a2;
+    des_bs_word t38 = t15 ^ t37;
+    des_bs_word t39 = a5 & t38;
+    des_bs_word t40 = t35 ^ t39;
+    des_bs_word t41 = a4 ^ t24;
+    des_bs_word t42 = t16 | a4;
+    des_bs_word t43 = t41 & t42;
+    des_bs_word t44 = a3 & t43;
+    des_bs_word t45 = t40 | t44;
+    des_bs_word t46 = t7 ^ t45;
+    des_bs_word t47 = a3 & ~a5;
+    des_bs_word t48 = t46 ^ t47;
+    des_bs_word t49 = t25 | t32;
+    des_bs_word t50 = a4 & t49;
+    des_bs_word t51 = t48 ^ t50;
+    des_bs_word t52 = a6 ^ t34;
+    des_bs_word t53 = t45 ^ t52;
+    des_bs_word t54 = a5 & t53;
+    des_bs_word t55 = t44 ^ t54;
+    des_bs_word t56 = t55 & ~a1;
+    des_bs_word t57 = t51 ^ t56;
+
+    *out1 = *out1 ^ t57;
+    *out2 = *out2 ^ t45;
+    *out3 = *out3 ^ t33;
+    *out4 = *out4 ^ t21;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s5(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[15] ^ key[0];
+    des_bs_word a2 = right[16] ^ key[1];
+    des_bs_word a3 = right[17] ^ key[2];
+    des_bs_word a4 = right[18] ^ key[3];
+    des_bs_word a5 = right[19] ^ key[4];
+    des_bs_word a6 = right[20] ^ key[5];
+    des_bs_word t1 = a1 ^ a5;
+    des_bs_word t2 = a3 | t1;
+    des_bs_word t3 = t2 & ~a6;
+    des_bs_word t4 = t1 ^ t3;
+    des_bs_word t5 = a5 | t3;
+    des_bs_word t6 = a3 ^ t5;
+    des_bs_word t7 = t6 & ~a1;
+    des_bs_word t8 = a1 ^ t7;
+    des_bs_word t9 = a4 & t8;
+    des_bs_word t10 = t4 ^ t9;
+    des_bs_word t11 = a4 | t6;
+    des_bs_word t12 = t9 ^ t11;
+    des_bs_word t13 = a6 & ~a3;
+    des_bs_word t14 = a4 ^ t13;
+    des_bs_word t15 = t14 & ~a5;
+    des_bs_word t16 = t12 | t15;
+    des_bs_word t17 = a2 & t16;
+    des_bs_word t18 = t10 ^ t17;
+    des_bs_word t19 = a6 ^ t12;
+    des_bs_word t20 = a4 | t3;
+    des_bs_word t21 = a1 & ~t20;
+    des_bs_word t22 = t19 & ~t21;
+    des_bs_word t23 = a6 ^ t10;
+    des_bs_word t24 = a3 & t23;
+    des_bs_word t25 = t22 ^ t24;
+    des_bs_word t26 = t12 | t21;
+    des_bs_word t27 = t8 ^ t26;
+    des_bs_word t28 = a1 ^ a3;
+    des_bs_word t29 = a6 & t28;
+    des_bs_word t30 = t27 | t29;
+    des_bs_word t31 = a2 & t30;
+    des_bs_word t32 = t25 ^ t31;
+    des_bs_word t33 = t4 | t32;
+    des_bs_word t34 = t28 ^ t33;
+    des_bs_word t35 = a1 ^ a2;
+    des_bs_word t36 = t23 ^ t35;
+    des_bs_word t37 = t36 & ~a4;
+    des_bs_word t38 = t34 ^ t37;
+    des_bs_word t39 = t6 | t33;
+    des_bs_word t40 = t22 & ~t31;
+    des_bs_word t41 = t40 | t24;
+    des_bs_word t42 = a6 & ~t41;
+    des_bs_word t43 = t39 & ~t42;
+    des_bs_word t44 = t43 & ~a5;
+    des_bs_word t45 = t38 ^ t44;
+    des_bs_word t46 = a2 & ~t40;
+    des_bs_word t47 = t28 ^ t46;
+    des_bs_word t48 = a6 & t26;
+    des_bs_word t49 = t47 ^ t48;
+    des_bs_word t50 = a2 & t41;
+    des_bs_word t51 = ~t31;
+    des_bs_word t52 = t51 ^ t50;
+    des_bs_word t53 = t32 & ~t47;
+    des_bs_word t54 = t23 ^ t53;
+    des_bs_word t55 = t54 & ~a1;
+    des_bs_word t56 = t52 ^ t55;
+    des_bs_word t57 = t56 & ~a5;
+    des_bs_word t58 = t49 ^ t57;
+
+    *out1 = *out1 ^ t45;
+    *out2 = *out2 ^ t32;
+    *out3 = *out3 ^ t58;
+    *out4 = *out4 ^ t18;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s6(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[19] ^ key[0];
+    des_bs_word a2 = right[20] ^ key[1];
+    des_bs_word a3 = right[21] ^ key[2];
+    des_bs_word a4 = right[22] ^ key[3];
+    des_bs_word a5 = right[23] ^ key[4];
+    des_bs_word a6 = right[24] ^ key[5];
+    des_bs_word t1 = a1 | a5;
+    des_bs_word t2 = a2 ^ t1;
+    des_bs_word t3 = a1 ^ a5;
+    des_bs_word t4 = a3 & t3;
+    des_bs_word t5 = t2 ^ t4;
+    des_bs_word t6 = a3 | t2;
+    des_bs_word t7 = t3 ^ t6;
+    des_bs_word t8 = t7 & ~a4;
+    des_bs_word t9 = t5 ^ t8;
+    des_bs_word t10 = a1 & t6;
+    des_bs_word t11 = a5 | t2;
+    des_bs_word t12 = t7 ^ t11;
+    des_bs_word t13 = a4 & t12;
+    des_bs_word t14 = t10 | t13;
+    des_bs_word t15 = a6 & t14;
+    des_bs_word t16 = t9 ^ t15;
+    des_bs_word t17 = ~t7;
+    des_bs_word t18 = a3 | a5;
+    des_bs_word t19 = t18 & ~a4;
+    des_bs_word t20 = t17 ^ t19;
+    des_bs_word t21 = a2 & t18;
+    des_bs_word t22 = t9 ^ t21;
+    des_bs_word t23 = a5 & ~a4;
+    des_bs_word t24 = t22 | t23;
+    des_bs_word t25 = a1 ^ a4;
+    des_bs_word t26 = t25 & ~a2;
+    des_bs_word t27 = t24 | t26;
+    des_bs_word t28 = a6 & t27;
+    des_bs_word t29 = t20 ^ t28;
+    des_bs_word t30 = a3 ^ a4;
+    des_bs_word t31 = t7 ^ t30;
+    des_bs_word t32 = t3 & t23;
+    des_bs_word t33 = t5 ^ t32;
+    des_bs_word t34 = a2 & t33;
+    des_bs_word t35 = t31 ^ t34;
+    des_bs_word t36 = t9 | t20;
+    des_bs_word t37 = t27 ^ t36;
+    des_bs_word t38 = t24 ^ t31;
+    des_bs_word t39 = t38 & ~a1;
+    des_bs_word t40 = t37 | t39;
+    des_bs_word t41 = a6 & t40;
+    des_bs_word t42 = t35 ^ t41;
+    des_bs_word t43 = a2 ^ t14;
+    des_bs_word t44 = t31 ^ t43;
+    des_bs_word t45 = t39 & ~a4;
+    des_bs_word t46 = t44 ^ t45;
+    des_bs_word t47 = t12 | t20;
+    des_bs_word t48 = t4 ^ t47;
+    des_bs_word t49 = t2 | t19;
+    des_bs_word t50 = t49 & ~a1;
+    des_bs_word t51 = t48 | t50;
+    des_bs_word t52 = t51 & ~a6;
+    des_bs_word t53 = t46 ^ t52;
+
+    *out1 = *out1 ^ t29;
+    *out2 = *out2 ^ t53;
+    *out3 = *out3 ^ t42;
+    *out4 = *out4 ^ t16;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s7(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[23] ^ key[0];
+    des_bs_word a2 = right[24] ^ key[1];
+    des_bs_word a3 = right[25] ^ key[2];
+    des_bs_word a4 = right[26] ^ key[3];
+    des_bs_word a5 = right[27] ^ key[4];
+    des_bs_word a6 = right[28] ^ key[5];
+    des_bs_word t1 = a5 ^ a6;
+    des_bs_word t2 = t1 ^ a3;
+    des_bs_word t3 = t2 ^ a1;
+    des_bs_word t4 = a3 | a5;
+    des_bs_word t5 = a1 & a6;
+    des_bs_word t6 = t4 | t5;
+    des_bs_word t7 = a4 & t6;
+    des_bs_word t8 = t3 ^ t7;
+    des_bs_word t9 = ~a3;
+    des_bs_word t10 = a4 & ~a5;
+    des_bs_word t11 = a1 & t8;
+    des_bs_word t12 = t10 ^ t11;
+    des_bs_word t13 = a6 & t12;
+    des_bs_word t14 = t9 ^ t13;
+    des_bs_word t15 = a2 & t14;
+    des_bs_word t16 = t8 ^ t15;
+    des_bs_word t17 = a2 & ~a4;
+    des_bs_word t18 = t3 ^ t17;
+    des_bs_word t19 = a1 | t17;
+    des_bs_word t20 = t19 & ~a3;
+    des_bs_word t21 = t16 ^ t20;
+    des_bs_word t22 = a6 & t21;
+    des_bs_word t23 = t18 ^ t22;
+    des_bs_word t24 = a4 & ~a2;
+    des_bs_word t25 = t15 ^ t18;
+    des_bs_word t26 = a6 & t16;
+    des_bs_word t27 = t25 ^ t26;
+    des_bs_word t28 = a1 & t27;
+    des_bs_word t29 = t24 ^ t28;
+    des_bs_word t30 = t29 & ~a5;
+    des_bs_word t31 = t23 ^ t30;
+    des_bs_word t32 = t7 & ~a3;
+    des_bs_word t33 = t2 | t32;
+    des_bs_word t34 = t8 & ~t13;
+    des_bs_word t35 = t27 & ~a4;
+    des_bs_word t36 = t34 ^ t35;
+    des_bs_word t37 = a1 & t36;
+    des_bs_word t38 = t33 ^ t37;
+    des_bs_word t39 = a4 & ~t13;
+    des_bs_word t40 = a6 & ~a4;
+    des_bs_word t41 = t40 ^ t9;
+    des_bs_word t42 = t41 & ~a1;
+    des_bs_word t43 = t39 ^ t42;
+    des_bs_word t44 = t43 & ~a2;
+    des_bs_word t45 = t38 ^ t44;
+    des_bs_word t46 = a2 ^ t18;
+    des_bs_word t47 = t36 & ~a6;
+    des_bs_word t48 = t46 ^ t47;
+    des_bs_word t49 = a3 ^ t27;
+    des_bs_word t50 = t49 & ~a5;
+    des_bs_word t51 = t35 | t50;
+    des_bs_word t52 = t41 & ~t22;
+    des_bs_word t53 = a2 & t52;
+    des_bs_word t54 = t51 ^ t53;
+    des_bs_word t55 = a1 & t54;
+    des_bs_word t56 = t48 ^ t55;
+
+    *out1 = *out1 ^ t56;
+    *out2 = *out2 ^ t45;
+    *out3 = *out3 ^ t31;
+    *out4 = *out4 ^ t16;
+}
+
+static DES_BITSLICE_INLINE void des_bitslice_s8(const des_bs_word* right,
+        const uint64_t* key,
+        des_bs_word* out1, des_bs_word* out2,
+        des_bs_word* out3, des_bs_word* out4)
+{
+    des_bs_word a1 = right[27] ^ key[0];
+    des_bs_word a2 = right[28] ^ key[1];
+    des_bs_word a3 = right[29] ^ key[2];
+    des_bs_word a4 = right[30] ^ key[3];
+    des_bs_word a5 = right[31] ^ key[4];
+    des_bs_word a6 = right[0] ^ key[5];
+    des_bs_word t1 = a4 ^ a6;
+    des_bs_word t2 = a3 & ~a2;
+    des_bs_word t3 = t1 ^ t2;
+    des_bs_word t4 = ~a3;
+    des_bs_word t5 = a2 & ~a4;
+    des_bs_word t6 = t4 ^ t5;
+    des_bs_word t7 = t6 & ~a5;
+    des_bs_word t8 = t3 ^ t7;
+    des_bs_word t9 = a2 ^ t1;
+    des_bs_word t10 = a4 & t9;
+    des_bs_word t11 = t2 | t10;
+    des_bs_word t12 = a3 | a6;
+    des_bs_word t13 = t12 ^ t5;
+    des_bs_word t14 = a5 & t13;
+    des_bs_word t15 = t11 ^ t14;
+    des_bs_word t16 = a1 & t15;
+    des_bs_word t17 = t8 ^ t16;
+    des_bs_word t18 = a5 ^ t6;
+    des_bs_word t19 = a4 | t7;
+    des_bs_word t20 = a6 & t19;
+    des_bs_word t21 = t18 ^ t20;
+    des_bs_word t22 = t10 & ~a5;
+    des_bs_word t23 = a6 & ~a3;
+    des_bs_word t24 = t22 ^ t23;
+    des_bs_word t25 = t24 & ~a2;
+    des_bs_word t26 = t21 ^ t25;
+    des_bs_word t27 = a5 | t3;
+    des_bs_word t28 = t27 ^ t22;
+    des_bs_word t29 = t8 & t25;
+    des_bs_word t30 = t28 ^ t29;
+    des_bs_word t31 = a1 & t30;
+    des_bs_word t32 = t26 ^ t31;
+    des_bs_word t33 = t11 ^ t17;
+    des_bs_word t34 = a2 | t26;
+    des_bs_word t35 = a1 & t34;
+    des_bs_word t36 = t5 ^ t35;
+    des_bs_word t37 = t36 & ~a6;
+    des_bs_word t38 = t33 ^ t37;
+    des_bs_word t39 = a1 ^ a3;
+    des_bs_word t40 = t13 ^ t33;
+    des_bs_word t41 = a6 & t40;
+    des_bs_word t42 = t39 ^ t41;
+    des_bs_word t43 = a5 & t42;
+    des_bs_word t44 = t38 ^ t43;
+    des_bs_word t45 = t8 ^ t28;
+    des_bs_word t46 = t23 & ~t18;
+    des_bs_word t47 = a2 & t46;
+    des_bs_word t48 = t45 ^ t47;
+    des_bs_word t49 = t28 & ~a5;
+    des_bs_word t50 = t34 ^ t49;
+    des_bs_word t51 = t42 | t49;
+    des_bs_word t52 = a6 & t51;
+    des_bs_word t53 = t50 ^ t52;
+    des_bs_word t54 = t53 & ~a1;
+    des_bs_word t55 = t48 ^ t54;
+
+    *out1 = *out1 ^ t44;
+    *out2 = *out2 ^ t17;
+    *out3 = *out3 ^ t55;
+    *out4 = *out4 ^ t32;
+}
+
+/*
+ * des_bitslice des_bitslice_init
+ *
+ * Expands the round keys of d into per-bit masks.
+*/
+static inline void des_bitslice_init(struct des_bitslice* b,
+                                     const struct des* d)
+{
+    size_t r = 0;
+    size_t i = 0;
+
+    for (r = 0; r < 16; r++) {
+        for (i = 0; i < 48; i++) {
+            b->skey[r][i] = 0 - ((d->skey[r] >> (47 - i)) & 1);
+        }
+    }
+}
+
+/*
+ * des_bitslice des_bitslice_transpose
+ *
+ * Transposes the 64x64 bit matrix held in each 64-bit lane of data in
+ * place: afterwards bit i of data[j] is bit j of the former data[i], both
+ * counted from the least significant. The transform is its own inverse.
+*/
+static DES_BITSLICE_INLINE void des_bitslice_transpose(des_bs_word* data)
+{
+    size_t j = 32;
+    size_t k = 0;
+    uint64_t m = 0x00000000FFFFFFFFull;
+    des_bs_word t;
+
+    for (j = 32; j != 0; j = j >> 1, m = m ^ (m << j)) {
+        for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            t = ((data[k] >> j) ^ data[k | j]) & m;
+            data[k] = data[k] ^ (t << j);
+            data[k | j] = data[k | j] ^ t;
+        }
+    }
+}
+
+/*
+ * des_bitslice des_bitslice_f
+ *
+ * One round: left ^= f(right, key). E is folded into the S-box inputs and P
+ * into the choice of outputs.
+*/
+static DES_BITSLICE_INLINE void des_bitslice_f(des_bs_word* left,
+        const des_bs_word* right,
+        const uint64_t* key)
+{
+    des_bitslice_s1(right, key, &left[8], &left[16], &left[22], &left[30]);
+    des_bitslice_s2(right, key + 6, &left[12], &left[27], &left[1],
+                    &left[17]);
+    des_bitslice_s3(right, key + 12, &left[23], &left[15], &left[29],
+                    &left[5]);
+    des_bitslice_s4(right, key + 18, &left[25], &left[19], &left[9],
+                    &left[0]);
+    des_bitslice_s5(right, key + 24, &left[7], &left[13], &left[24],
+                    &left[2]);
+    des_bitslice_s6(right, key + 30, &left[3], &left[28], &left[10],
+                    &left[18]);
+    des_bitslice_s7(right, key + 36, &left[31], &left[11], &left[21],
+                    &left[6]);
+    des_bitslice_s8(right, key + 42, &left[4], &left[26], &left[14],
+                    &left[20]);
+}
+
+/*
+ * des_bitslice des_bitslice_core
+ *
+ * Encrypts (decrypt = 0) or decrypts DES_BITSLICE_BLOCKS blocks from input
+ * into output; the two may alias. Always inlined, so that each caller below
+ * is compiled for its own target.
+*/
+static DES_BITSLICE_INLINE void des_bitslice_core(
+    const struct des_bitslice* b, const uint64_t* input, uint64_t* output,
+    int decrypt)
+{
+    size_t i = 0;
+    size_t g = 0;
+    size_t r = 0;
+    des_bs_word block[64];
+    des_bs_word left[32];
+    des_bs_word right[32];
+
+    // Lane g of block[] holds input blocks 64 g to 64 g + 63, so that one
+    // transpose slices all of them; block[63 - j] is then bit j of each.
+    for (g = 0; g < DES_BITSLICE_WORDS; g++) {
+        for (i = 0; i < 64; i++) {
+            memcpy((uint8_t*) &block[i] + 8 * g, &input[64 * g + i], 8);
+        }
+    }
+
+    des_bitslice_transpose(block);
+
+    for (i = 0; i < 32; i++) {
+        left[i] = block[64 - des_initial_permutation_shifts[i]];
+        right[i] = block[64 - des_initial_permutation_shifts[32 + i]];
+    }
+
+    for (r = 0; r < 16; r += 2) {
+        des_bitslice_f(left, right, b->skey[decrypt ? 15 - r : r]);
+        des_bitslice_f(right, left, b->skey[decrypt ? 14 - r : r + 1]);
+    }
+
+    // The preoutput block is R16 L16.
+    for (i = 0; i < 64; i++) {
+        size_t j = des_inverse_permutation_shifts[i] - 1;
+
+        block[63 - i] = j < 32 ? right[j] : left[j - 32];
+    }
+
+    des_bitslice_transpose(block);
+
+    for (g = 0; g < DES_BITSLICE_WORDS; g++) {
+        for (i = 0; i < 64; i++) {
+            memcpy(&output[64 * g + i], (uint8_t*) &block[i] + 8 * g, 8);
+        }
+    }
+}
+
+static inline void des_bitslice_crypt_portable(const struct des_bitslice* b,
+        const uint64_t* input,
+        uint64_t* output, int decrypt)
+{
+    des_bitslice_core(b, input, output, decrypt);
+}
+
+#ifdef CC_DES_BITSLICE_AVX2
+__attribute__((target("avx2")))
+static inline void des_bitslice_crypt_avx2(const struct des_bitslice* b,
+        const uint64_t* input,
+        uint64_t* output, int decrypt)
+{
+    des_bitslice_core(b, input, output, decrypt);
+}
+#endif
+
+static inline int des_bitslice_avx2_supported()
+{
+#ifdef CC_DES_BITSLICE_AVX2
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * des_bitslice des_bitslice_crypt
+ *
+ * Encrypts (decrypt = 0) or decrypts DES_BITSLICE_BLOCKS blocks from input
+ * into output; the two may alias. Uses AVX2 when the host has it, and
+ * otherwise the same circuits on whatever the compiler targets by default
+ * (a pair of SSE2 registers on x86-64).
+*/
+static inline void des_bitslice_crypt(const struct des_bitslice* b,
+                                      const uint64_t* input,
+                                      uint64_t* output, int decrypt)
+{
+#ifdef CC_DES_BITSLICE_AVX2
+    if (des_bitslice_avx2_supported()) {
+        des_bitslice_crypt_avx2(b, input, output, decrypt);
+        return;
+    }
+#endif
+
+    des_bitslice_crypt_portable(b, input, output, decrypt);
+}
+
+static inline void des_bitslice_encrypt_blocks(const struct des_bitslice* b,
+        const uint64_t* input,
+        uint64_t* output)
+{
+    des_bitslice_crypt(b, input, output, 0);
+}
+
+static inline void des_bitslice_decrypt_blocks(const struct des_bitslice* b,
+        const uint64_t* input,
+        uint64_t* output)
+{
+    des_bitslice_crypt(b, input, output, 1);
+}
+
+static inline void des_bitslice_ecb(const struct des_bitslice* b,
+                                    const uint8_t* input, uint8_t* output,
+                                    size_t len, int decrypt)
+{
+    size_t i = 0;
+    size_t n = 0;
+    size_t count = 0;
+    uint64_t blocks[DES_BITSLICE_BLOCKS];
+
+    for (n = 0; n + 8 <= len; n += 8 * count) {
+        count = (len - n) / 8;
+        if (count > DES_BITSLICE_BLOCKS) {
+            count = DES_BITSLICE_BLOCKS;
+        }
+
+        for (i = 0; i < DES_BITSLICE_BLOCKS; i++) {
+            blocks[i] = i < count ? des_load64(input + n + 8 * i) : 0;
+        }
+
+        des_bitslice_crypt(b, blocks, blocks, decrypt);
+
+        for (i = 0; i < count; i++) {
+            des_store64(output + n + 8 * i, blocks[i]);
+        }
+    }
+}
+
+/*
+ * des_bitslice des_bitslice_ecb_encrypt
+ *
+ * Encrypts len bytes from input into output in ECB mode; input and output
+ * may be the same buffer. len must be a multiple of 8; a trailing partial
+ * block is ignored. A short final batch is padded internally and costs as
+ * much as a full one.
+*/
+static inline void des_bitslice_ecb_encrypt(const struct des_bitslice* b,
+        const uint8_t* input,
+        uint8_t* output, size_t len)
+{
+    des_bitslice_ecb(b, input, output, len, 0);
+}
+
+static inline void des_bitslice_ecb_decrypt(const struct des_bitslice* b,
+        const uint8_t* input,
+        uint8_t* output, size_t len)
+{
+    des_bitslice_ecb(b, input, output, len, 1);
+}
+
+/*
+ * des_bitslice des_bitslice_ctr_xor
+ *
+ * Encrypts or decrypts len bytes from input into output in CTR mode; input
+ * and output may be the same buffer. counter is the 64-bit counter block,
+ * incremented (modulo 2^64) once per block; on return it holds the counter
+ * for the block following the last one used. len need not be a multiple of
+ * 8, but a message may only be split across calls at block boundaries.
+*/
+static inline void des_bitslice_ctr_xor(const struct des_bitslice* b,
+                                        uint64_t* counter,
+                                        const uint8_t* input,
+                                        uint8_t* output, size_t len)
+{
+    size_t i = 0;
+    size_t n = 0;
+    uint64_t blocks[DES_BITSLICE_BLOCKS];
+    uint8_t pad[8];
+
+    while (n < len) {
+        for (i = 0; i < DES_BITSLICE_BLOCKS; i++) {
+            blocks[i] = *counter + i;
+        }
+
+        des_bitslice_crypt(b, blocks, blocks, 0);
+
+        for (i = 0; i < DES_BITSLICE_BLOCKS && n < len; i++) {
+            size_t j = 0;
+
+            des_store64(pad, blocks[i]);
+            for (j = 0; j < 8 && n < len; j++, n++) {
+                output[n] = input[n] ^ pad[j];
+            }
+
+            *counter = *counter + 1;
+        }
+    }
+}
+
+#endif
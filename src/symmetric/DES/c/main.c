@@ -5,8 +5,290 @@
 **/
 
 #include "des.h"
+#include "des3.h"
+#include "des_bitslice.h"
 #include "stdio.h"
 #include "inttypes.h"
+#include "time.h"
+
+void test_des_kat()
+{
+    struct des d;
+    uint64_t key = 0x133457799BBCDFF1ull;
+    uint64_t plain = 0x0123456789ABCDEFull;
+    uint64_t expected = 0x85E813540F0AB405ull;
+
+    // Every bit of both key halves matters here, unlike the key above.
+    des_init(&d, key);
+
+    printf("Key:       %" PRIx64 "\n", key);
+    printf("Plaintext: %" PRIx64 "\n", plain);
+    printf("Actual:    %" PRIx64 "\n", des_encrypt_block(&d, plain));
+    printf("Expected:  %" PRIx64 "\n", expected);
+    printf("Decrypted: %" PRIx64 "\n", des_decrypt_block(&d, expected));
+}
+
+void print_hex(const char* label, const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+
+    printf("%s", label);
+    for (i = 0; i < len; i++) {
+        printf("%02x", data[i]);
+    }
+    printf("\n");
+}
+
+void test_des3()
+{
+    struct des3 d;
+    uint64_t key1 = 0x0123456789ABCDEFull;
+    uint64_t key2 = 0x23456789ABCDEF01ull;
+    uint64_t key3 = 0x456789ABCDEF0123ull;
+    uint64_t iv = 0xF69F2445DF4F9B17ull;
+    const uint8_t plain[24] = "The qufck brown fox jump";
+    const uint8_t expected_ede3[24] = {
+        0xa8, 0x26, 0xfd, 0x8c, 0xe5, 0x3b, 0x85, 0x5f,
+        0xcc, 0xe2, 0x1c, 0x81, 0x12, 0x25, 0x6f, 0xe6,
+        0x68, 0xd5, 0xc0, 0x5d, 0xd9, 0xb6, 0xb9, 0x00
+    };
+    const uint8_t expected_ede2[24] = {
+        0xc4, 0x48, 0x62, 0xf7, 0x0c, 0xf2, 0xfb, 0xdc,
+        0x90, 0x77, 0xd0, 0x90, 0x9f, 0xa9, 0x1b, 0x88,
+        0x4c, 0xab, 0xd6, 0x1f, 0xc5, 0x8e, 0x0c, 0xbb
+    };
+    const uint8_t expected_cbc[24] = {
+        0xa5, 0xc2, 0x82, 0xba, 0xd0, 0xde, 0x37, 0x74,
+        0xbe, 0xcd, 0x2e, 0x04, 0x38, 0x6b, 0x58, 0x9f,
+        0xb5, 0x05, 0x7d, 0x85, 0x52, 0xfc, 0x43, 0x36
+    };
+    uint8_t output[24];
+
+    des3_init(&d, key1, key2, key3);
+    des3_ecb_encrypt(&d, plain, output, sizeof(output));
+    print_hex("3DES EDE3 ECB Actual:   ", output, sizeof(output));
+    print_hex("3DES EDE3 ECB Expected: ", expected_ede3, sizeof(output));
+    des3_ecb_decrypt(&d, output, output, sizeof(output));
+    print_hex("3DES EDE3 ECB Decrypted: ", output, sizeof(output));
+
+    des3_cbc_encrypt(&d, &iv, plain, output, sizeof(output));
+    print_hex("3DES EDE3 CBC Actual:   ", output, sizeof(output));
+    print_hex("3DES EDE3 CBC Expected: ", expected_cbc, sizeof(output));
+    iv = 0xF69F2445DF4F9B17ull;
+    des3_cbc_decrypt(&d, &iv, output, output, sizeof(output));
+    print_hex("3DES EDE3 CBC Decrypted: ", output, sizeof(output));
+
+    des3_init_2key(&d, key1, key2);
+    des3_ecb_encrypt(&d, plain, output, sizeof(output));
+    print_hex("3DES EDE2 ECB Actual:   ", output, sizeof(output));
+    print_hex("3DES EDE2 ECB Expected: ", expected_ede2, sizeof(output));
+}
+
+void test_des_modes()
+{
+    struct des d;
+    struct des3 d3;
+    uint64_t iv = 0x1234567890ABCDEFull;
+    uint64_t counter = 0xFFFFFFFFFFFFFFFEull;
+    const uint8_t plain[43] = "Now is the time for all good men to help us";
+    const uint8_t expected_cbc[40] = {
+        0xe5, 0xc7, 0xcd, 0xde, 0x87, 0x2b, 0xf2, 0x7c,
+        0x43, 0xe9, 0x34, 0x00, 0x8c, 0x38, 0x9c, 0x0f,
+        0x68, 0x37, 0x88, 0x49, 0x9a, 0x7c, 0x05, 0xf6,
+        0xf1, 0x1a, 0xc1, 0x61, 0x78, 0xc4, 0xaf, 0x21,
+        0x8b, 0xc4, 0x86, 0xec, 0x62, 0x5d, 0xef, 0x07
+    };
+    const uint8_t expected_cbc3[40] = {
+        0xf3, 0xc0, 0xff, 0x02, 0x6c, 0x02, 0x30, 0x89,
+        0x65, 0x6f, 0xbb, 0x16, 0x9d, 0xef, 0x7e, 0xdb,
+        0x30, 0xba, 0x36, 0x07, 0x5d, 0x6f, 0x01, 0x76,
+        0x15, 0xc8, 0x2a, 0xd9, 0x3f, 0xca, 0x17, 0x6c,
+        0x96, 0x98, 0x63, 0x48, 0x12, 0x38, 0x65, 0xb4
+    };
+    uint8_t expected_ctr[43];
+    uint8_t pad[8];
+    uint8_t output[43];
+    size_t i = 0;
+
+    des_init(&d, 0x0123456789ABCDEFull);
+    des3_init(&d3, 0x0123456789ABCDEFull, 0x23456789ABCDEF01ull,
+              0x456789ABCDEF0123ull);
+
+    des_cbc_encrypt(&d, &iv, plain, output, 40);
+    print_hex("DES CBC Actual:    ", output, 40);
+    print_hex("DES CBC Expected:  ", expected_cbc, 40);
+    iv = 0x1234567890ABCDEFull;
+    des_cbc_decrypt(&d, &iv, output, output, 40);
+    print_hex("DES CBC Decrypted: ", output, 40);
+
+    for (i = 0; i < sizeof(plain); i++) {
+        des_store64(pad, des_encrypt_block(&d, counter + i / 8));
+        expected_ctr[i] = plain[i] ^ pad[i % 8];
+    }
+    des_ctr_xor(&d, &counter, plain, output, sizeof(plain));
+    print_hex("DES CTR Actual:    ", output, sizeof(plain));
+    print_hex("DES CTR Expected:  ", expected_ctr, sizeof(plain));
+    counter = 0xFFFFFFFFFFFFFFFEull;
+    des_ctr_xor(&d, &counter, output, output, sizeof(plain));
+    print_hex("DES CTR Decrypted: ", output, sizeof(plain));
+
+    iv = 0x1234567890ABCDEFull;
+    des3_cbc_encrypt(&d3, &iv, plain, output, 40);
+    print_hex("3DES CBC Actual:    ", output, 40);
+    print_hex("3DES CBC Expected:  ", expected_cbc3, 40);
+    iv = 0x1234567890ABCDEFull;
+    des3_cbc_decrypt(&d3, &iv, output, output, 40);
+    print_hex("3DES CBC Decrypted: ", output, 40);
+
+    for (i = 0; i < sizeof(plain); i++) {
+        des_store64(pad, des3_encrypt_block(&d3, counter + i / 8));
+        expected_ctr[i] = plain[i] ^ pad[i % 8];
+    }
+    des3_ctr_xor(&d3, &counter, plain, output, sizeof(plain));
+    print_hex("3DES CTR Actual:    ", output, sizeof(plain));
+    print_hex("3DES CTR Expected:  ", expected_ctr, sizeof(plain));
+}
+
+void benchmark_des_modes()
+{
+    struct des d;
+    static uint8_t buffer[1024 * 1024];
+    uint64_t iv = 0;
+    clock_t start;
+
+    des_init(&d, 0x0123456789ABCDEFull);
+
+    start = clock();
+    des_cbc_encrypt(&d, &iv, buffer, buffer, sizeof(buffer));
+    printf("Benchmark: 1MB des CBC encrypt:   %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    des_cbc_decrypt(&d, &iv, buffer, buffer, sizeof(buffer));
+    printf("Benchmark: 1MB des CBC decrypt:   %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    des_ctr_xor(&d, &iv, buffer, buffer, sizeof(buffer));
+    printf("Benchmark: 1MB des CTR:           %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+void test_des_bitslice()
+{
+    struct des d;
+    struct des_bitslice b;
+    uint8_t buffer[8 * (2 * DES_BITSLICE_BLOCKS + 5) + 3];
+    uint8_t output[sizeof(buffer)];
+    uint64_t counter = 0xF0F1F2F3F4F5F6F7ull;
+    uint64_t batch[DES_BITSLICE_BLOCKS];
+    size_t blocks = (sizeof(buffer)) / 8;
+    size_t matches = 0;
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t) (i * 37 + 11);
+    }
+
+    des_init(&d, 0x0123456789ABCDEFull);
+    des_bitslice_init(&b, &d);
+
+    des_bitslice_ecb_encrypt(&b, buffer, output, sizeof(buffer));
+    for (i = 0; i < blocks; i++) {
+        if (des_load64(output + 8 * i) ==
+                des_encrypt_block(&d, des_load64(buffer + 8 * i))) {
+            matches++;
+        }
+    }
+    printf("Bitslice ECB Actual:   %zu blocks match\n", matches);
+    printf("Bitslice ECB Expected: %zu blocks match\n", blocks);
+
+    matches = 0;
+    des_bitslice_ecb_decrypt(&b, output, output, sizeof(buffer));
+    for (i = 0; i < 8 * blocks; i++) {
+        matches += output[i] == buffer[i];
+    }
+    printf("Bitslice ECB Decrypted: %zu of %zu bytes\n", matches, 8 * blocks);
+
+    matches = 0;
+    des_bitslice_ctr_xor(&b, &counter, buffer, output, sizeof(buffer));
+    for (i = 0; i < sizeof(buffer); i++) {
+        uint8_t pad[8];
+
+        des_store64(pad, des_encrypt_block(&d, 0xF0F1F2F3F4F5F6F7ull +
+                                           i / 8));
+        matches += output[i] == (buffer[i] ^ pad[i % 8]);
+    }
+    printf("Bitslice CTR Actual:   %zu bytes match\n", matches);
+    printf("Bitslice CTR Expected: %zu bytes match\n", sizeof(buffer));
+
+    // The modes above take the AVX2 path when the host has it; check the
+    // portable one as well.
+    matches = 0;
+    for (i = 0; i < DES_BITSLICE_BLOCKS; i++) {
+        batch[i] = des_load64(buffer + 8 * i);
+    }
+    des_bitslice_crypt_portable(&b, batch, batch, 0);
+    for (i = 0; i < DES_BITSLICE_BLOCKS; i++) {
+        if (batch[i] == des_encrypt_block(&d, des_load64(buffer + 8 * i))) {
+            matches++;
+        }
+    }
+    printf("Bitslice portable Actual:   %zu blocks match\n", matches);
+    printf("Bitslice portable Expected: %zu blocks match\n",
+           (size_t) DES_BITSLICE_BLOCKS);
+    printf("Bitslice AVX2: %s\n",
+           des_bitslice_avx2_supported() ? "yes" : "no");
+}
+
+void benchmark_des_key_setup()
+{
+    struct des d;
+    uint64_t block = 0;
+    clock_t start;
+    size_t i = 0;
+
+    start = clock();
+    for (i = 0; i < 1024 * 1024; i++) {
+        des_init(&d, block ^ i);
+        block = des_encrypt_block(&d, block);
+    }
+    printf("Benchmark: 1M des key setup + block: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+void benchmark_des_bitslice()
+{
+    struct des d;
+    struct des_bitslice b;
+    static uint8_t buffer[1024 * 1024];
+    static uint64_t blocks[1024 * 1024 / 8];
+    clock_t start;
+    size_t i = 0;
+
+    des_init(&d, 0x0123456789ABCDEFull);
+    des_bitslice_init(&b, &d);
+
+    start = clock();
+    for (i = 0; i < sizeof(buffer); i += 8) {
+        des_store64(buffer + i,
+                    des_encrypt_block(&d, des_load64(buffer + i)));
+    }
+    printf("Benchmark: 1MB des ECB block:     %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    des_bitslice_ecb_encrypt(&b, buffer, buffer, sizeof(buffer));
+    printf("Benchmark: 1MB des ECB bitslice:  %f seconds (%d lanes)\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC, DES_BITSLICE_BLOCKS);
+
+    start = clock();
+    for (i = 0; i < sizeof(blocks) / 8; i += DES_BITSLICE_BLOCKS) {
+        des_bitslice_crypt_portable(&b, blocks + i, blocks + i, 0);
+    }
+    printf("Benchmark: 1MB des bitslice portable: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+}
 
 int main()
 {
@@ -23,5 +305,13 @@ int main()
     printf("Expected:  %" PRIx64 "\n", expected);
     printf("Decrypted: %" PRIx64 "\n", des_decrypt_block(&d, expected));
 
+    test_des_kat();
+    test_des3();
+    test_des_modes();
+    test_des_bitslice();
+    benchmark_des_key_setup();
+    benchmark_des_modes();
+    benchmark_des_bitslice();
+
     return 0;
 }
@@ -5,8 +5,11 @@
 **/
 
 #include "rc2.h"
+#include "rc2_avx2.h"
 #include "stdio.h"
 #include "stdint.h"
+#include "string.h"
+#include "time.h"
 
 void test_rfc_8()
 {
@@ -218,6 +221,200 @@ void test_rfc_other()
     printf("\n\n");
 }
 
+void test_rc2_block()
+{
+    size_t count = 0;
+    size_t i = 0;
+
+    struct rc2 r;
+    uint8_t key[5][16] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+        {0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {0x88, 0xbc, 0xa9, 0x0e, 0x90, 0x87, 0x5a},
+        {
+            0x88, 0xbc, 0xa9, 0x0e, 0x90, 0x87, 0x5a, 0x7f,
+            0x0f, 0x79, 0xc3, 0x84, 0x62, 0x7b, 0xaf, 0xb2
+        }
+    };
+    size_t keylen[5] = {8, 8, 8, 7, 16};
+    size_t effective[5] = {63, 64, 64, 64, 128};
+
+    uint16_t plaintexts[5][4] = {
+        {0x0000, 0x0000, 0x0000, 0x0000},
+        {0xffff, 0xffff, 0xffff, 0xffff},
+        {0x0010, 0x0000, 0x0000, 0x0100},
+        {0x0000, 0x0000, 0x0000, 0x0000},
+        {0x0000, 0x0000, 0x0000, 0x0000}
+    };
+
+    uint16_t ciphertexts[5][4] = {
+        {0xb7eb, 0xf973, 0x2793, 0xff8e},
+        {0x8b27, 0xe427, 0x2f2e, 0x490d},
+        {0x6430, 0xdf9e, 0xe79b, 0xc2d2},
+        {0xcf6c, 0x0843, 0x4c97, 0x7f26},
+        {0x6922, 0x2a55, 0xf8b0, 0xa65c}
+    };
+
+    uint16_t block[4];
+
+    for (count = 0; count < 5; count++) {
+        rc2_init(&r, key[count], keylen[count], effective[count]);
+
+        rc2_encrypt_block(&r, plaintexts[count], block);
+        printf("Block encrypt Actual:   ");
+        for (i = 0; i < 4; i++) {
+            printf("%04x", block[i]);
+        }
+        printf("\n");
+        printf("Block encrypt Expected: ");
+        for (i = 0; i < 4; i++) {
+            printf("%04x", ciphertexts[count][i]);
+        }
+        printf("\n");
+
+        rc2_decrypt_block(&r, block, block);
+        printf("Block decrypt Actual:   ");
+        for (i = 0; i < 4; i++) {
+            printf("%04x", block[i]);
+        }
+        printf("\n");
+        printf("Block decrypt Expected: ");
+        for (i = 0; i < 4; i++) {
+            printf("%04x", plaintexts[count][i]);
+        }
+        printf("\n\n");
+    }
+}
+
+void print_hex(const char* label, const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+
+    printf("%s", label);
+    for (i = 0; i < len; i++) {
+        printf("%02x", data[i]);
+    }
+    printf("\n");
+}
+
+void test_rc2_avx2()
+{
+    struct rc2 r;
+    uint8_t key[16] = {
+        0x88, 0xbc, 0xa9, 0x0e, 0x90, 0x87, 0x5a, 0x7f,
+        0x0f, 0x79, 0xc3, 0x84, 0x62, 0x7b, 0xaf, 0xb2
+    };
+    uint8_t iv[8] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint8_t ciphertext[168] = {
+        0x20, 0x46, 0x34, 0x5a, 0xc7, 0x58, 0xd0, 0xce,
+        0x58, 0x92, 0x4c, 0x9c, 0xdf, 0x93, 0x2e, 0xa9,
+        0x8c, 0x7e, 0x43, 0x57, 0x59, 0x31, 0xca, 0x03,
+        0xe5, 0x26, 0x4f, 0x11, 0x7f, 0x4e, 0xfe, 0x9f,
+        0xf3, 0xdd, 0x3a, 0xe6, 0x7a, 0x13, 0x54, 0xcc,
+        0x18, 0x2a, 0x16, 0x6a, 0xd7, 0x26, 0xe9, 0xee,
+        0x20, 0x09, 0x9b, 0xc5, 0xbd, 0x7f, 0x23, 0x19,
+        0x0d, 0x71, 0xb2, 0xd2, 0x00, 0xc8, 0x98, 0xb6,
+        0x03, 0x7b, 0x86, 0xae, 0x39, 0xf6, 0xc3, 0xd3,
+        0xdb, 0xe1, 0x59, 0x13, 0x26, 0xbf, 0x82, 0x0a,
+        0x01, 0x10, 0xdc, 0xa6, 0x4a, 0xdc, 0x3a, 0x3f,
+        0xdb, 0x93, 0xe9, 0x45, 0x4e, 0x23, 0x7c, 0xd9,
+        0x78, 0x93, 0x20, 0xca, 0x5b, 0xfb, 0xcc, 0xe5,
+        0x13, 0x45, 0xe6, 0x24, 0xbe, 0x10, 0x54, 0x40,
+        0x4a, 0x3c, 0xcb, 0x4b, 0x06, 0xa9, 0x8d, 0xb1,
+        0xdd, 0x73, 0xbb, 0xce, 0x04, 0x6e, 0xb7, 0xd9,
+        0x24, 0xdf, 0x70, 0xff, 0xe2, 0x0c, 0x6f, 0xf2,
+        0x62, 0x46, 0x1a, 0xe5, 0x88, 0x9f, 0x72, 0xc8,
+        0x0f, 0x06, 0x85, 0x9f, 0x1d, 0x96, 0x6d, 0x15,
+        0x72, 0x08, 0xf0, 0x1c, 0x35, 0x74, 0x9f, 0x5c,
+        0x45, 0x9b, 0xdd, 0x0f, 0x39, 0x48, 0xf1, 0xe7
+    };
+    uint8_t plaintext[168];
+    uint8_t output[168];
+    uint16_t data[4 * 37];
+    uint16_t reference[4 * 37];
+    size_t matches = 0;
+    size_t i = 0;
+
+    printf("AVX2 supported: %d\n", rc2_avx2_supported());
+    rc2_init(&r, key, 16, 128);
+
+    for (i = 0; i < 4 * 37; i++) {
+        data[i] = (uint16_t) (i * 0x9E37u);
+    }
+    for (i = 0; i < 37; i++) {
+        rc2_encrypt_block(&r, data + 4 * i, reference + 4 * i);
+    }
+
+    rc2_avx2_encrypt_blocks(&r, data, 37);
+    for (i = 0; i < 4 * 37; i++) {
+        matches += data[i] == reference[i];
+    }
+    printf("AVX2 blocks Actual:   %zu words match\n", matches);
+    printf("AVX2 blocks Expected: %d words match\n", 4 * 37);
+
+    matches = 0;
+    rc2_avx2_decrypt_blocks(&r, data, 37);
+    for (i = 0; i < 4 * 37; i++) {
+        matches += data[i] == (uint16_t) (i * 0x9E37u);
+    }
+    printf("AVX2 blocks decrypted: %zu words match\n", matches);
+
+    for (i = 0; i < 168; i++) {
+        plaintext[i] = (uint8_t) (i * 29 + 3);
+    }
+
+    rc2_avx2_cbc_decrypt(&r, iv, ciphertext, output, 168);
+    print_hex("AVX2 CBC Actual:   ", output, 168);
+    print_hex("AVX2 CBC Expected: ", plaintext, 168);
+    print_hex("AVX2 CBC iv Actual:   ", iv, 8);
+    print_hex("AVX2 CBC iv Expected: ", ciphertext + 160, 8);
+
+    rc2_avx2_ecb_encrypt(&r, plaintext, output, 168);
+    rc2_avx2_ecb_decrypt(&r, output, output, 168);
+    printf("AVX2 ECB round trip: %d\n\n",
+           memcmp(output, plaintext, 168) == 0);
+}
+
+void benchmark_rc2()
+{
+    struct rc2 r;
+    uint8_t key[8] = {0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint16_t block[4] = {0x0010, 0x0000, 0x0000, 0x0100};
+    static uint16_t data[4 * 256];
+    clock_t start;
+    size_t i = 0;
+
+    rc2_init(&r, key, 8, 64);
+
+    start = clock();
+    for (i = 0; i < 131072; i++) {
+        rc2_encrypt(&r, block);
+        block[0] = r.R[0];
+        block[1] = r.R[1];
+        block[2] = r.R[2];
+        block[3] = r.R[3];
+    }
+    printf("Benchmark: 1MB rc2 reference: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < 131072; i++) {
+        rc2_encrypt_block(&r, block, block);
+    }
+    printf("Benchmark: 1MB rc2 block:     %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < 131072; i += 256) {
+        rc2_avx2_encrypt_blocks(&r, data, 256);
+    }
+    printf("Benchmark: 1MB rc2 AVX2:      %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+    printf("Benchmark: final block %04x%04x%04x%04x\n", block[0], block[1],
+           block[2], block[3]);
+}
+
 int main()
 {
     printf("8 Byte Keys:\n");
@@ -227,5 +424,10 @@ int main()
     printf("\n\nVariable Byte Keys:\n");
     test_rfc_other();
 
+    printf("\n\nBlock Functions:\n");
+    test_rc2_block();
+    test_rc2_avx2();
+    benchmark_rc2();
+
     return 0;
 }
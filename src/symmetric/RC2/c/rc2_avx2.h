@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2016 Alexander Scheel
+ *
+ * Sixteen-lane AVX2 implementation of the RC2 encryption algorithm, for
+ * bulk ECB and CBC decryption.
+ *
+ * RC2 works entirely on 16-bit words, so each 256-bit register holds the
+ * same word R[i] of sixteen independent blocks. Mixing rounds are plain
+ * vector adds, ands and rotates with the key word broadcast; the
+ * data-dependent key lookups of the mashing rounds are done with
+ * vpgatherdd. The key is the regular struct rc2 from rc2_init and is only
+ * read.
+ *
+ * The bulk functions below select the AVX2 path at runtime and otherwise,
+ * and for the blocks left over after the last group of sixteen, fall back to
+ * rc2_encrypt_block and rc2_decrypt_block; they can be called on any host.
+ * CC_RC2_AVX2 is defined when the AVX2 path is built (x86 with GCC or
+ * Clang).
+*/
+
+#pragma once
+#ifndef CC_RC2_AVX2_H
+#define CC_RC2_AVX2_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "rc2.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CC_RC2_AVX2 1
+
+#include "immintrin.h"
+
+/*
+ * Byte orders for rc2_avx2_transpose: within each 128-bit lane, gather the
+ * words of two blocks by word index, and the inverse.
+*/
+const uint8_t rc2_avx2_split[32] = {
+    0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+    0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15
+};
+
+const uint8_t rc2_avx2_join[32] = {
+    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15
+};
+
+/*
+ * rc2_avx2 rc2_avx2_transpose
+ *
+ * Transposes the 4x4 matrix of 32-bit elements in each 128-bit lane of
+ * R[0..3]. Applied after rc2_avx2_split, it takes four registers of four
+ * consecutive blocks each to one register per word; applied again and
+ * followed by rc2_avx2_join, it takes them back.
+*/
+__attribute__((target("avx2")))
+extern inline void rc2_avx2_transpose(__m256i* R)
+{
+    __m256i t0 = _mm256_unpacklo_epi32(R[0], R[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(R[0], R[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(R[2], R[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(R[2], R[3]);
+
+    R[0] = _mm256_unpacklo_epi64(t0, t2);
+    R[1] = _mm256_unpackhi_epi64(t0, t2);
+    R[2] = _mm256_unpacklo_epi64(t1, t3);
+    R[3] = _mm256_unpackhi_epi64(t1, t3);
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i rc2_avx2_rotl16(__m256i data, int count)
+{
+    return _mm256_or_si256(_mm256_slli_epi16(data, count),
+                           _mm256_srli_epi16(data, 16 - count));
+}
+
+__attribute__((target("avx2")))
+extern inline __m256i rc2_avx2_rotr16(__m256i data, int count)
+{
+    return _mm256_or_si256(_mm256_srli_epi16(data, count),
+                           _mm256_slli_epi16(data, 16 - count));
+}
+
+/*
+ * rc2_avx2 rc2_avx2_composite
+ *
+ * (R[i-1] & R[i-2]) + (~R[i-1] & R[i-3]) of the mix and r-mix operations,
+ * given a = R[i-1], b = R[i-2] and c = R[i-3].
+*/
+__attribute__((target("avx2")))
+extern inline __m256i rc2_avx2_composite(__m256i a, __m256i b, __m256i c)
+{
+    return _mm256_add_epi16(_mm256_and_si256(a, b),
+                            _mm256_andnot_si256(a, c));
+}
+
+/*
+ * rc2_avx2 rc2_avx2_lookup
+ *
+ * K[index & 63] for each of the sixteen lanes of index. The gathers read
+ * 32 bits at K + 2 * (index & 63) and keep the low half, so the lookup of
+ * K[63] also reads the two bytes after the key; they lie within struct rc2.
+*/
+__attribute__((target("avx2")))
+extern inline __m256i rc2_avx2_lookup(const uint16_t* K, __m256i index)
+{
+    __m256i i = _mm256_and_si256(index, _mm256_set1_epi16(63));
+    __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(i));
+    __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(i, 1));
+    __m256i mask = _mm256_set1_epi32(0xFFFF);
+
+    lo = _mm256_and_si256(_mm256_i32gather_epi32((const int*) K, lo, 2),
+                          mask);
+    hi = _mm256_and_si256(_mm256_i32gather_epi32((const int*) K, hi, 2),
+                          mask);
+
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+}
+
+__attribute__((target("avx2")))
+extern inline void rc2_avx2_mix_round(__m256i* R, const uint16_t* K)
+{
+    R[0] = _mm256_add_epi16(R[0], _mm256_set1_epi16((short) K[0]));
+    R[0] = _mm256_add_epi16(R[0], rc2_avx2_composite(R[3], R[2], R[1]));
+    R[0] = rc2_avx2_rotl16(R[0], 1);
+    R[1] = _mm256_add_epi16(R[1], _mm256_set1_epi16((short) K[1]));
+    R[1] = _mm256_add_epi16(R[1], rc2_avx2_composite(R[0], R[3], R[2]));
+    R[1] = rc2_avx2_rotl16(R[1], 2);
+    R[2] = _mm256_add_epi16(R[2], _mm256_set1_epi16((short) K[2]));
+    R[2] = _mm256_add_epi16(R[2], rc2_avx2_composite(R[1], R[0], R[3]));
+    R[2] = rc2_avx2_rotl16(R[2], 3);
+    R[3] = _mm256_add_epi16(R[3], _mm256_set1_epi16((short) K[3]));
+    R[3] = _mm256_add_epi16(R[3], rc2_avx2_composite(R[2], R[1], R[0]));
+    R[3] = rc2_avx2_rotl16(R[3], 5);
+}
+
+__attribute__((target("avx2")))
+extern inline void rc2_avx2_mash_round(__m256i* R, const uint16_t* K)
+{
+    R[0] = _mm256_add_epi16(R[0], rc2_avx2_lookup(K, R[3]));
+    R[1] = _mm256_add_epi16(R[1], rc2_avx2_lookup(K, R[0]));
+    R[2] = _mm256_add_epi16(R[2], rc2_avx2_lookup(K, R[1]));
+    R[3] = _mm256_add_epi16(R[3], rc2_avx2_lookup(K, R[2]));
+}
+
+__attribute__((target("avx2")))
+extern inline void rc2_avx2_r_mix_round(__m256i* R, const uint16_t* K)
+{
+    R[3] = rc2_avx2_rotr16(R[3], 5);
+    R[3] = _mm256_sub_epi16(R[3], _mm256_set1_epi16((short) K[3]));
+    R[3] = _mm256_sub_epi16(R[3], rc2_avx2_composite(R[2], R[1], R[0]));
+    R[2] = rc2_avx2_rotr16(R[2], 3);
+    R[2] = _mm256_sub_epi16(R[2], _mm256_set1_epi16((short) K[2]));
+    R[2] = _mm256_sub_epi16(R[2], rc2_avx2_composite(R[1], R[0], R[3]));
+    R[1] = rc2_avx2_rotr16(R[1], 2);
+    R[1] = _mm256_sub_epi16(R[1], _mm256_set1_epi16((short) K[1]));
+    R[1] = _mm256_sub_epi16(R[1], rc2_avx2_composite(R[0], R[3], R[2]));
+    R[0] = rc2_avx2_rotr16(R[0], 1);
+    R[0] = _mm256_sub_epi16(R[0], _mm256_set1_epi16((short) K[0]));
+    R[0] = _mm256_sub_epi16(R[0], rc2_avx2_composite(R[3], R[2], R[1]));
+}
+
+__attribute__((target("avx2")))
+extern inline void rc2_avx2_r_mash_round(__m256i* R, const uint16_t* K)
+{
+    R[3] = _mm256_sub_epi16(R[3], rc2_avx2_lookup(K, R[2]));
+    R[2] = _mm256_sub_epi16(R[2], rc2_avx2_lookup(K, R[1]));
+    R[1] = _mm256_sub_epi16(R[1], rc2_avx2_lookup(K, R[0]));
+    R[0] = _mm256_sub_epi16(R[0], rc2_avx2_lookup(K, R[3]));
+}
+
+/*
+ * rc2_avx2 rc2_avx2_crypt16
+ *
+ * Encrypts (decrypt = 0) or decrypts the sixteen blocks whose words are in
+ * R[0..3], in place; the round sequence is that of rc2_encrypt_block.
+*/
+__attribute__((target("avx2")))
+extern inline void rc2_avx2_crypt16(const struct rc2* r, __m256i* R,
+                                    int decrypt)
+{
+    const uint16_t* K = r->key.K;
+    size_t j = 0;
+
+    if (decrypt) {
+        for (j = 64; j > 0; j -= 4) {
+            rc2_avx2_r_mix_round(R, K + j - 4);
+            if (j == 48 || j == 24) {
+                rc2_avx2_r_mash_round(R, K);
+            }
+        }
+    } else {
+        for (j = 0; j < 64; j += 4) {
+            rc2_avx2_mix_round(R, K + j);
+            if (j == 16 || j == 40) {
+                rc2_avx2_mash_round(R, K);
+            }
+        }
+    }
+}
+
+/*
+ * rc2_avx2 rc2_avx2_crypt_blocks
+ *
+ * Encrypts (decrypt = 0) or decrypts the blocks of data (four words each,
+ * as for rc2_encrypt_block) in groups of sixteen. Returns the number of
+ * blocks processed, count rounded down to a multiple of sixteen.
+*/
+__attribute__((target("avx2")))
+extern inline size_t rc2_avx2_crypt_blocks(const struct rc2* r,
+        uint16_t* data, size_t count,
+        int decrypt)
+{
+    size_t i = 0;
+    size_t j = 0;
+    __m256i split = _mm256_loadu_si256((const __m256i*) rc2_avx2_split);
+    __m256i join = _mm256_loadu_si256((const __m256i*) rc2_avx2_join);
+    __m256i R[4];
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        for (j = 0; j < 4; j++) {
+            R[j] = _mm256_loadu_si256((const __m256i*) (data + 4 * i +
+                                      16 * j));
+            R[j] = _mm256_shuffle_epi8(R[j], split);
+        }
+
+        rc2_avx2_transpose(R);
+        rc2_avx2_crypt16(r, R, decrypt);
+        rc2_avx2_transpose(R);
+
+        for (j = 0; j < 4; j++) {
+            _mm256_storeu_si256((__m256i*) (data + 4 * i + 16 * j),
+                                _mm256_shuffle_epi8(R[j], join));
+        }
+    }
+
+    return i;
+}
+#endif
+
+extern inline int rc2_avx2_supported()
+{
+#ifdef CC_RC2_AVX2
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * rc2_avx2 rc2_avx2_encrypt_blocks
+ *
+ * Encrypts count blocks of four words each in place: sixteen at a time
+ * with AVX2 when available, the rest with rc2_encrypt_block.
+*/
+extern inline void rc2_avx2_encrypt_blocks(const struct rc2* r,
+        uint16_t* data, size_t count)
+{
+    size_t i = 0;
+
+#ifdef CC_RC2_AVX2
+    if (rc2_avx2_supported()) {
+        i = rc2_avx2_crypt_blocks(r, data, count, 0);
+    }
+#endif
+
+    for (; i < count; i++) {
+        rc2_encrypt_block(r, data + 4 * i, data + 4 * i);
+    }
+}
+
+extern inline void rc2_avx2_decrypt_blocks(const struct rc2* r,
+        uint16_t* data, size_t count)
+{
+    size_t i = 0;
+
+#ifdef CC_RC2_AVX2
+    if (rc2_avx2_supported()) {
+        i = rc2_avx2_crypt_blocks(r, data, count, 1);
+    }
+#endif
+
+    for (; i < count; i++) {
+        rc2_decrypt_block(r, data + 4 * i, data + 4 * i);
+    }
+}
+
+/*
+ * rc2_avx2 rc2_avx2_load
+ *
+ * Reads the little endian words of count blocks from bytes into words.
+*/
+extern inline void rc2_avx2_load(uint16_t* words, const uint8_t* bytes,
+                                 size_t count)
+{
+    size_t i = 0;
+
+    for (i = 0; i < 4 * count; i++) {
+        words[i] = (uint16_t) (bytes[2 * i] | (bytes[2 * i + 1] << 8));
+    }
+}
+
+extern inline void rc2_avx2_store(uint8_t* bytes, const uint16_t* words,
+                                  size_t count)
+{
+    size_t i = 0;
+
+    for (i = 0; i < 4 * count; i++) {
+        bytes[2 * i + 0] = (uint8_t) (words[i] >> 0);
+        bytes[2 * i + 1] = (uint8_t) (words[i] >> 8);
+    }
+}
+
+extern inline void rc2_avx2_ecb(const struct rc2* r, const uint8_t* input,
+                                uint8_t* output, size_t len, int decrypt)
+{
+    size_t n = 0;
+    size_t count = 0;
+    uint16_t data[4 * 32];
+
+    for (n = 0; n + 8 <= len; n += 8 * count) {
+        count = (len - n) / 8;
+        if (count > 32) {
+            count = 32;
+        }
+
+        rc2_avx2_load(data, input + n, count);
+
+        if (decrypt) {
+            rc2_avx2_decrypt_blocks(r, data, count);
+        } else {
+            rc2_avx2_encrypt_blocks(r, data, count);
+        }
+
+        rc2_avx2_store(output + n, data, count);
+    }
+}
+
+/*
+ * rc2_avx2 rc2_avx2_ecb_encrypt
+ *
+ * Encrypts len bytes from input into output in ECB mode; input and output
+ * may be the same buffer. Blocks are read and written as four little endian
+ * words, as in RFC 2268. len must be a multiple of 8; a trailing partial
+ * block is ignored.
+*/
+extern inline void rc2_avx2_ecb_encrypt(const struct rc2* r,
+                                        const uint8_t* input,
+                                        uint8_t* output, size_t len)
+{
+    rc2_avx2_ecb(r, input, output, len, 0);
+}
+
+extern inline void rc2_avx2_ecb_decrypt(const struct rc2* r,
+                                        const uint8_t* input,
+                                        uint8_t* output, size_t len)
+{
+    rc2_avx2_ecb(r, input, output, len, 1);
+}
+
+/*
+ * rc2_avx2 rc2_avx2_cbc_decrypt
+ *
+ * Decrypts len bytes from input into output in CBC mode; input and output
+ * may be the same buffer. iv holds the 8-byte initialization vector on entry
+ * and the last ciphertext block on return, so a message may be processed in
+ * several calls. len must be a multiple of 8; a trailing partial block is
+ * ignored. CBC encryption is inherently serial; use rc2_encrypt_block for
+ * it.
+*/
+extern inline void rc2_avx2_cbc_decrypt(const struct rc2* r, uint8_t* iv,
+                                        const uint8_t* input,
+                                        uint8_t* output, size_t len)
+{
+    size_t i = 0;
+    size_t n = 0;
+    size_t count = 0;
+    uint8_t chain[8 * 33];
+    uint16_t data[4 * 32];
+
+    for (i = 0; i < 8; i++) {
+        chain[i] = iv[i];
+    }
+
+    for (n = 0; n + 8 <= len; n += 8 * count) {
+        count = (len - n) / 8;
+        if (count > 32) {
+            count = 32;
+        }
+
+        // chain holds the previous ciphertext block and this batch.
+        for (i = 0; i < 8 * count; i++) {
+            chain[8 + i] = input[n + i];
+        }
+
+        rc2_avx2_load(data, input + n, count);
+        rc2_avx2_decrypt_blocks(r, data, count);
+        rc2_avx2_store(output + n, data, count);
+
+        for (i = 0; i < 8 * count; i++) {
+            output[n + i] = output[n + i] ^ chain[i];
+        }
+        for (i = 0; i < 8; i++) {
+            chain[i] = chain[8 * count + i];
+        }
+    }
+
+    for (i = 0; i < 8; i++) {
+        iv[i] = chain[i];
+    }
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "stdio.h"
 #include "string.h"
 #include "stdint.h"
+#include "time.h"
 
 void test_rfc_6229()
 {
@@ -43,8 +44,207 @@ void test_rfc_6229()
     }
 }
 
+void test_rc4_crypt()
+{
+    struct rc4 r;
+    uint8_t key[5] = {0x01, 0x02, 0x03, 0x04, 0x05};
+    uint8_t expected[32] = {
+        0xb2, 0x39, 0x63, 0x05, 0xf0, 0x3d, 0xc0, 0x27,
+        0xcc, 0xc3, 0x52, 0x4a, 0x0a, 0x11, 0x18, 0xa8,
+        0x69, 0x82, 0x94, 0x4f, 0x18, 0xfc, 0x82, 0xd5,
+        0x89, 0xc4, 0x03, 0xa4, 0x7a, 0x0d, 0x09, 0x19
+    };
+    uint8_t zero[32];
+    uint8_t output[32];
+    size_t i = 0;
+
+    memset(zero, 0, sizeof(zero));
+
+    // Split at odd offsets so that the unrolled body and the tail both
+    // continue the keystream of the previous call.
+    rc4_init(&r, key, 5);
+    rc4_crypt(&r, zero, output, 3);
+    rc4_crypt(&r, zero + 3, output + 3, 22);
+    rc4_crypt(&r, zero + 25, output + 25, 7);
+
+    printf("rc4_crypt Actual:   ");
+    for (i = 0; i < 32; i++) {
+        printf("%02x", output[i]);
+    }
+    printf("\n");
+    printf("rc4_crypt Expected: ");
+    for (i = 0; i < 32; i++) {
+        printf("%02x", expected[i]);
+    }
+    printf("\n");
+
+    rc4_init(&r, key, 5);
+    rc4_crypt(&r, output, output, 32);
+    printf("rc4_crypt round trip: %d\n\n", memcmp(output, zero, 32) == 0);
+}
+
+void test_rc4_streams()
+{
+    struct rc4 contexts[6];
+    struct rc4 reference;
+    struct rc4* r[6];
+    uint8_t key[6][8];
+    uint8_t buffers[6][100];
+    uint8_t expected[6][100];
+    const uint8_t* input[6];
+    uint8_t* output[6];
+    size_t len[6] = {100, 37, 64, 99, 1, 80};
+    size_t matches = 0;
+    size_t total = 0;
+    size_t s = 0;
+    size_t i = 0;
+
+    for (s = 0; s < 6; s++) {
+        for (i = 0; i < 8; i++) {
+            key[s][i] = (uint8_t) (s * 8 + i + 1);
+        }
+        for (i = 0; i < 100; i++) {
+            buffers[s][i] = (uint8_t) (s + i);
+        }
+
+        rc4_init(&reference, key[s], 8);
+        rc4_crypt(&reference, buffers[s], expected[s], len[s]);
+
+        rc4_init(&contexts[s], key[s], 8);
+        r[s] = &contexts[s];
+        input[s] = buffers[s];
+        output[s] = buffers[s];
+        total += len[s];
+    }
+
+    rc4_crypt_streams(r, input, output, len, 6);
+
+    for (s = 0; s < 6; s++) {
+        for (i = 0; i < len[s]; i++) {
+            matches += buffers[s][i] == expected[s][i];
+        }
+    }
+
+    printf("rc4_crypt_streams Actual:   %zu bytes match\n", matches);
+    printf("rc4_crypt_streams Expected: %zu bytes match\n\n", total);
+}
+
+void test_rc4_drop()
+{
+    struct rc4 r;
+    struct rc4 clones[3];
+    uint8_t key[5] = {0x01, 0x02, 0x03, 0x04, 0x05};
+    size_t drop[2] = {768, 3072};
+    uint8_t expected[2][16] = {
+        {
+            0xeb, 0x62, 0x63, 0x8d, 0x4f, 0x0b, 0xa1, 0xfe,
+            0x9f, 0xca, 0x20, 0xe0, 0x5b, 0xf8, 0xff, 0x2b
+        },
+        {
+            0xec, 0x0e, 0x11, 0xc4, 0x79, 0xdc, 0x32, 0x9d,
+            0xc8, 0xda, 0x79, 0x68, 0xfe, 0x96, 0x56, 0x81
+        }
+    };
+    uint8_t zero[16];
+    uint8_t output[3][16];
+    size_t t = 0;
+    size_t i = 0;
+
+    memset(zero, 0, sizeof(zero));
+
+    for (t = 0; t < 2; t++) {
+        rc4_init_drop(&r, key, 5, drop[t]);
+        rc4_crypt(&r, zero, output[0], 16);
+
+        printf("RC4-drop[%zu] Actual:   ", drop[t]);
+        for (i = 0; i < 16; i++) {
+            printf("%02x", output[0][i]);
+        }
+        printf("\n");
+        printf("RC4-drop[%zu] Expected: ", drop[t]);
+        for (i = 0; i < 16; i++) {
+            printf("%02x", expected[t][i]);
+        }
+        printf("\n");
+    }
+
+    rc4_init_drop(&r, key, 5, 768);
+    for (t = 0; t < 3; t++) {
+        rc4_clone(&clones[t], &r);
+        rc4_crypt(&clones[t], zero, output[t], 16);
+    }
+    printf("rc4_clone Actual:   %d %d %d\n",
+           memcmp(output[0], expected[0], 16) == 0,
+           memcmp(output[1], expected[0], 16) == 0,
+           memcmp(output[2], expected[0], 16) == 0);
+    printf("rc4_clone Expected: 1 1 1\n\n");
+}
+
+void benchmark_rc4()
+{
+    struct rc4 r;
+    uint8_t key[5] = {0x01, 0x02, 0x03, 0x04, 0x05};
+    static uint8_t data[1048576];
+    struct rc4 streams[4];
+    struct rc4* r4[4];
+    const uint8_t* input[4];
+    uint8_t* output[4];
+    size_t len[4];
+    clock_t start;
+    size_t i = 0;
+
+    rc4_init(&r, key, 5);
+    start = clock();
+    for (i = 0; i < 16; i++) {
+        rc4_stream(&r, data, sizeof(data));
+    }
+    printf("Benchmark: 16MB rc4_stream: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    rc4_init(&r, key, 5);
+    start = clock();
+    for (i = 0; i < 16; i++) {
+        rc4_crypt(&r, data, data, sizeof(data));
+    }
+    printf("Benchmark: 16MB rc4_crypt:  %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    for (i = 0; i < 4; i++) {
+        rc4_init(&streams[i], key, 5);
+        r4[i] = &streams[i];
+        input[i] = data + i * (sizeof(data) / 4);
+        output[i] = data + i * (sizeof(data) / 4);
+        len[i] = sizeof(data) / 4;
+    }
+    start = clock();
+    for (i = 0; i < 16; i++) {
+        rc4_crypt_streams(r4, input, output, len, 4);
+    }
+    printf("Benchmark: 16MB rc4_crypt_streams (4 streams): %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < 4096; i++) {
+        rc4_init_drop(&r, key, 5, 3072);
+    }
+    printf("Benchmark: 4096 rc4-drop[3072] inits: %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < 4096; i++) {
+        rc4_clone(&streams[i % 4], &r);
+    }
+    printf("Benchmark: 4096 rc4_clone:            %f seconds\n",
+           (double) (clock() - start) / CLOCKS_PER_SEC);
+    printf("Benchmark: last byte %02x\n\n", data[sizeof(data) - 1]);
+}
+
 int main()
 {
     test_rfc_6229();
+    test_rc4_crypt();
+    test_rc4_streams();
+    test_rc4_drop();
+    benchmark_rc4();
     return 0;
 }
@@ -11,6 +11,7 @@
 
 #include "stdlib.h"
 #include "stdint.h"
+#include "string.h"
 
 struct rc4 {
     uint8_t S[256];
@@ -60,5 +61,199 @@ extern inline void rc4_stream(struct rc4* r, uint8_t* data, size_t len)
     }
 }
 
+/*
+ * rc4 rc4_next
+ *
+ * Advances the generator one step and returns the next keystream byte. S
+ * is the state and i, j the indices, held by the caller in locals; the
+ * uint8_t arithmetic provides the reduction modulo 256.
+*/
+extern inline uint8_t rc4_next(uint8_t* S, uint8_t* i, uint8_t* j)
+{
+    uint8_t a;
+    uint8_t b;
+
+    *i = (uint8_t) (*i + 1);
+    a = S[*i];
+    *j = (uint8_t) (*j + a);
+    b = S[*j];
+
+    S[*i] = b;
+    S[*j] = a;
+
+    return S[(uint8_t) (a + b)];
+}
+
+/*
+ * rc4 rc4_crypt
+ *
+ * Encrypts or decrypts len bytes from input into output by XORing in the
+ * keystream; input and output may be the same buffer. Successive calls
+ * continue the same keystream, as do calls to rc4_stream.
+*/
+extern inline void rc4_crypt(struct rc4* r, const uint8_t* input,
+                             uint8_t* output, size_t len)
+{
+    uint8_t* S = r->S;
+    uint8_t i = (uint8_t) r->x;
+    uint8_t j = (uint8_t) r->y;
+    size_t n = 0;
+
+    for (n = 0; n + 4 <= len; n += 4) {
+        output[n + 0] = input[n + 0] ^ rc4_next(S, &i, &j);
+        output[n + 1] = input[n + 1] ^ rc4_next(S, &i, &j);
+        output[n + 2] = input[n + 2] ^ rc4_next(S, &i, &j);
+        output[n + 3] = input[n + 3] ^ rc4_next(S, &i, &j);
+    }
+
+    for (; n < len; n++) {
+        output[n] = input[n] ^ rc4_next(S, &i, &j);
+    }
+
+    r->x = i;
+    r->y = j;
+}
+
+/*
+ * rc4 rc4_crypt4
+ *
+ * rc4_crypt on four independent contexts at once: streams k = 0..3 each
+ * process len bytes from input[k] into output[k] with r[k]. The four
+ * generators are advanced in lockstep, so the dependency chains through
+ * S[i] and S[j] of the four overlap. Everything is copied to locals first:
+ * the byte stores could otherwise alias the pointer arrays and force a
+ * reload of every pointer after each byte. The contexts must be distinct.
+*/
+extern inline void rc4_crypt4(struct rc4** r, const uint8_t** input,
+                              uint8_t** output, size_t len)
+{
+    uint8_t* S0 = r[0]->S;
+    uint8_t* S1 = r[1]->S;
+    uint8_t* S2 = r[2]->S;
+    uint8_t* S3 = r[3]->S;
+    uint8_t i0 = (uint8_t) r[0]->x;
+    uint8_t i1 = (uint8_t) r[1]->x;
+    uint8_t i2 = (uint8_t) r[2]->x;
+    uint8_t i3 = (uint8_t) r[3]->x;
+    uint8_t j0 = (uint8_t) r[0]->y;
+    uint8_t j1 = (uint8_t) r[1]->y;
+    uint8_t j2 = (uint8_t) r[2]->y;
+    uint8_t j3 = (uint8_t) r[3]->y;
+    const uint8_t* in0 = input[0];
+    const uint8_t* in1 = input[1];
+    const uint8_t* in2 = input[2];
+    const uint8_t* in3 = input[3];
+    uint8_t* out0 = output[0];
+    uint8_t* out1 = output[1];
+    uint8_t* out2 = output[2];
+    uint8_t* out3 = output[3];
+    size_t n = 0;
+
+    for (n = 0; n < len; n++) {
+        out0[n] = in0[n] ^ rc4_next(S0, &i0, &j0);
+        out1[n] = in1[n] ^ rc4_next(S1, &i1, &j1);
+        out2[n] = in2[n] ^ rc4_next(S2, &i2, &j2);
+        out3[n] = in3[n] ^ rc4_next(S3, &i3, &j3);
+    }
+
+    r[0]->x = i0;
+    r[1]->x = i1;
+    r[2]->x = i2;
+    r[3]->x = i3;
+    r[0]->y = j0;
+    r[1]->y = j1;
+    r[2]->y = j2;
+    r[3]->y = j3;
+}
+
+/*
+ * rc4 rc4_crypt_streams
+ *
+ * Runs rc4_crypt for count independent streams: stream k processes len[k]
+ * bytes from input[k] into output[k] with context r[k]. Streams are taken
+ * four at a time with rc4_crypt4 for as long as all four have data left;
+ * the remainder of each stream, and any streams left over from the last
+ * group, go through rc4_crypt. The contexts must be distinct.
+*/
+extern inline void rc4_crypt_streams(struct rc4** r, const uint8_t** input,
+                                     uint8_t** output, const size_t* len,
+                                     size_t count)
+{
+    size_t common = 0;
+    size_t s = 0;
+    size_t k = 0;
+
+    for (s = 0; s + 4 <= count; s += 4) {
+        common = len[s];
+        for (k = 1; k < 4; k++) {
+            if (len[s + k] < common) {
+                common = len[s + k];
+            }
+        }
+
+        rc4_crypt4(r + s, input + s, output + s, common);
+
+        for (k = 0; k < 4; k++) {
+            rc4_crypt(r[s + k], input[s + k] + common,
+                      output[s + k] + common, len[s + k] - common);
+        }
+    }
+
+    for (; s < count; s++) {
+        rc4_crypt(r[s], input[s], output[s], len[s]);
+    }
+}
+
+/*
+ * rc4 rc4_discard
+ *
+ * Advances the generator by n bytes without producing them. Only the swap
+ * is performed; the output lookup S[S[i] + S[j]] and all output writes are
+ * skipped.
+*/
+extern inline void rc4_discard(struct rc4* r, size_t n)
+{
+    uint8_t* S = r->S;
+    uint8_t i = (uint8_t) r->x;
+    uint8_t j = (uint8_t) r->y;
+    uint8_t a;
+    size_t k = 0;
+
+    for (k = 0; k < n; k++) {
+        i = (uint8_t) (i + 1);
+        a = S[i];
+        j = (uint8_t) (j + a);
+        S[i] = S[j];
+        S[j] = a;
+    }
+
+    r->x = i;
+    r->y = j;
+}
+
+/*
+ * rc4 rc4_init_drop
+ *
+ * RC4-drop[n]: rc4_init followed by discarding the first drop bytes of
+ * keystream, e.g. 768 or 3072.
+*/
+extern inline void rc4_init_drop(struct rc4* r, uint8_t* key, size_t keylen,
+                                 size_t drop)
+{
+    rc4_init(r, key, keylen);
+    rc4_discard(r, drop);
+}
+
+/*
+ * rc4 rc4_clone
+ *
+ * Copies the complete generator state of src into dst, so that both
+ * continue with the same keystream. Used to key (and drop) once and fan the
+ * resulting state out to several contexts.
+*/
+extern inline void rc4_clone(struct rc4* dst, const struct rc4* src)
+{
+    memcpy(dst, src, sizeof(struct rc4));
+}
 
 #endif